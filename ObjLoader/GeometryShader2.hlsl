@@ -1,4 +1,11 @@
 
+cbuffer constants : register(b0)
+{
+	float4x4	pvt;
+	float4		positionOffset;
+	float4		positionScale;
+	float4		viewportScale;
+};
 
 struct VOUT
 {
@@ -17,7 +24,7 @@ struct PIN
 [maxvertexcount(4)]
 void main(triangle VOUT input[3], inout TriangleStream<PIN> OutputStream)
 {
-	float2 WIN_SCALE = float2(800, 600);
+	float2 WIN_SCALE = viewportScale.xy;
 	
 	float2 p0 = WIN_SCALE * input[0].pos.xy / input[0].pos.w;
 	float2 p1 = WIN_SCALE * input[1].pos.xy / input[1].pos.w;
@@ -1,6 +1,9 @@
 cbuffer constants : register(b0)
 {
 	float4x4	pvt;
+	float4		positionOffset;	// Compact vertices: decoded = offset + unorm * scale
+	float4		positionScale;	// Float vertices: offset = 0, scale = 1
+	float4		viewportScale;	// xy: NDC to edge distance units, the viewport size
 };
 
 struct VOUT
@@ -10,8 +13,19 @@ struct VOUT
 };
 
 
+float3 DecodePosition(float3 pos)
+{
+	return positionOffset.xyz + pos * positionScale.xyz;
+}
+
+// Per instance 3x4 transform rows from slot 1, identity for draws that are not instanced
+float3 InstancePosition(float3 pos, float4 row0, float4 row1, float4 row2)
+{
+	const float4 p = float4(pos, 1);
+	return float3(dot(row0, p), dot(row1, p), dot(row2, p));
+}
 
-VOUT main(float3 pos : POSITION, uint idx : SV_VertexID) 
+VOUT main(float3 pos : POSITION, float4 row0 : INSTANCE0, float4 row1 : INSTANCE1, float4 row2 : INSTANCE2, uint idx : SV_VertexID) 
 {
 	float3 UVW[] =
 	{
@@ -21,7 +35,7 @@ VOUT main(float3 pos : POSITION, uint idx : SV_VertexID)
 	};
 
 	VOUT OUT;
-	OUT.pos			= mul(pvt, float4(pos, 1));
+	OUT.pos			= mul(pvt, float4(InstancePosition(DecodePosition(pos), row0, row1, row2), 1));
 	OUT.UVW			= UVW[idx % 3];
 	
 	return OUT;
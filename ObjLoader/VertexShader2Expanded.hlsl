@@ -0,0 +1,77 @@
+
+
+cbuffer constants : register(b0)
+{
+	float4x4	pvt;
+	float4		positionOffset;
+	float4		positionScale;
+	float4		viewportScale;
+};
+
+// Wireframe without GeometryShader2, see ExpandTriangles in Wireframe.hpp.
+// Every vertex carries its whole triangle and SV_VertexID % 3 picks the corner.
+struct VIN
+{
+	float3 p0 : POSITION0;
+	float3 p1 : POSITION1;
+	float3 p2 : POSITION2;
+	float4 row0 : INSTANCE0;
+	float4 row1 : INSTANCE1;
+	float4 row2 : INSTANCE2;
+};
+
+struct PIN
+{
+	float4 pos : SV_Position;
+	float3 dist : DISTANCE;
+};
+
+
+float3 DecodePosition(float3 pos)
+{
+	return positionOffset.xyz + pos * positionScale.xyz;
+}
+
+float3 InstancePosition(float3 pos, const VIN IN)
+{
+	const float4 p = float4(pos, 1);
+	return float3(dot(IN.row0, p), dot(IN.row1, p), dot(IN.row2, p));
+}
+
+PIN main(const VIN IN, uint idx : SV_VertexID)
+{
+	const float4 clip[3] =
+	{
+		mul(pvt, float4(InstancePosition(DecodePosition(IN.p0), IN), 1)),
+		mul(pvt, float4(InstancePosition(DecodePosition(IN.p1), IN), 1)),
+		mul(pvt, float4(InstancePosition(DecodePosition(IN.p2), IN), 1)),
+	};
+
+	// Same edge distances as GeometryShader2
+	float2 WIN_SCALE = viewportScale.xy;
+
+	float2 p0 = WIN_SCALE * clip[0].xy / clip[0].w;
+	float2 p1 = WIN_SCALE * clip[1].xy / clip[1].w;
+	float2 p2 = WIN_SCALE * clip[2].xy / clip[2].w;
+
+	float2 v0 = p2 - p1;
+	float2 v1 = p2 - p0;
+	float2 v2 = p1 - p0;
+
+	float area = abs(v1.x * v2.y - v1.y * v2.x);
+
+	const uint corner = idx % 3;
+
+	PIN OUT;
+	OUT.pos		= clip[corner];
+	OUT.dist	= float3(0, 0, 0);
+
+	if (corner == 0)
+		OUT.dist.x = area / length(v0);
+	else if (corner == 1)
+		OUT.dist.y = area / length(v1);
+	else
+		OUT.dist.z = area / length(v2);
+
+	return OUT;
+}
\ No newline at end of file
@@ -1,47 +1,104 @@
 #include "SimpleDX11.hpp"
+#include "AsyncLoading.hpp"
+#include "Batching.hpp"
+#include "Bounds.hpp"
+#include "BVH.hpp"
+#include "CommandBuffer.hpp"
+#include "ConstantRing.hpp"
+#include "Culling.hpp"
+#include "D3D11Commands.hpp"
+#include "D3D11StateCache.hpp"
+#include "FrameGraph.hpp"
+#include "Instancing.hpp"
+#include "MeshCleanup.hpp"
+#include "MergedGeometry.hpp"
+#include "Meshlets.hpp"
+#include "Normals.hpp"
+#include "ParallelCommands.hpp"
+#include "Simplify.hpp"
+#include "SpatialSort.hpp"
+#include "Tangents.hpp"
+#include "Threading.hpp"
+#include "TransientTextures.hpp"
+#include "UploadRing.hpp"
+#include "VertexQuantization.hpp"
+#include "Wireframe.hpp"
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
 #include <cstdint>
+#include <cstdio>
 #include <filesystem>
 #include <fstream>
+#include <string_view>
 
+struct LODRange
+{
+    uint32_t    startIndex  = 0;
+    uint32_t    indexCount  = 0;
+    float       error       = 0.0f;
+};
+
+// Bounds live in a BoundsTable, row i belongs to drawables[i]
 struct Drawable
 {
-    ~Drawable()
+    int32_t                 baseVertex = 0;
+    std::vector<LODRange>   lods;       // lods[0] is full resolution, ranges into the merged index buffer
+};
+
+int main(int argv, const char* argvs[])
+{
+    const auto startTime = std::chrono::high_resolution_clock::now();
+
+    auto API = CreateDX(1024, 1024);
+
+    // Until the model is on the GPU the window presents cleared frames, steps taking longer
+    // than a frame run in the background and buffers are created on the upload thread
+    AsyncLoader loader;
+    double      windowTime      = 0.0;      // until the first cleared frame, i.e. CreateDX
+    double      longestStall    = 0.0;      // longest time between two frames until the model is drawn
+    size_t      loadingFrames   = 0;
+    auto        lastPresent     = startTime;
+
+    auto PresentLoading = [&]()
     {
-        if (indexBuffer)
-            indexBuffer->Release();
+        MSG msg;
 
-        indexBuffer = nullptr;
-        indexCount = 0;
-    }
+        while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+        {
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+        }
 
-    Drawable() = default;
+        // Resizes wait for the frame loop, until then the swap chain stretches
+        const float clearColor[4] = { 0.1f, 0.1f, 0.1f, 1.0f };
+        API.context->ClearRenderTargetView(API.GetBackBufferView(), clearColor);
+        API.swapChain->Present(1, 0);
 
-    Drawable(ID3D11Buffer* in_buffer, size_t in_size) :
-        indexBuffer{ in_buffer },
-        indexCount{ in_size } {}
+        const auto now = std::chrono::high_resolution_clock::now();
 
-    Drawable(const Drawable& rhs) = delete;
-    Drawable& operator = (const Drawable& rhs) = delete;
+        if (loadingFrames++ == 0)
+            windowTime = std::chrono::duration<double, std::milli>(now - startTime).count();
+        else
+            longestStall = std::max(longestStall, std::chrono::duration<double, std::milli>(now - lastPresent).count());
 
-    Drawable(Drawable&& rhs) :
-        indexBuffer{ std::exchange(rhs.indexBuffer, nullptr) },
-        indexCount{ std::exchange(rhs.indexCount, 0) } { }
+        lastPresent = now;
+    };
 
-    Drawable& operator = (Drawable&& rhs)
+    auto Load = [&](auto&& step)
     {
-        indexBuffer = std::exchange(rhs.indexBuffer, nullptr);
-        indexCount = std::exchange(rhs.indexCount, 0);
-    }
+        return loader.Wait(loader.Run(step), PresentLoading);
+    };
 
-    ID3D11Buffer* indexBuffer = nullptr;
-    size_t          indexCount = 0;
-};
+    // 16 bit indices when they fit, the copy moves along with the upload
+    auto UploadIndices = [&](const auto& mesh)
+    {
+        if (mesh.Fits16BitIndices())
+            return loader.Upload([&API, indices = mesh.Indices16()] { return API.CreateIndexBuffer(indices.data(), indices.size() * sizeof(uint16_t)); });
 
-int main(int argv, const char* argvs[])
-{
-    auto API = CreateDX(1024, 1024);
+        return loader.Upload([&API, &mesh] { return API.CreateIndexBuffer(mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t)); });
+    };
+
+    PresentLoading();
 
     // Load Obj file
     tinyobj::attrib_t                   attrib;
@@ -56,33 +113,305 @@ int main(int argv, const char* argvs[])
         if (!fileStream.is_open())
             return -1;
 
-        if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, &fileStream))
+        // mtllib paths resolve against the OBJ's directory
+        tinyobj::MaterialFileReader materialReader{ std::filesystem::path{ argvs[1] }.parent_path().string() };
+
+        if (!Load([&] { return tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, &fileStream, &materialReader); }))
             return -1;
     }
 
-    const auto& shape = shapes.front();
-    auto vertexBuffer = API.CreateVertexBuffer(attrib.vertices.data(), attrib.vertices.size() * sizeof(float));
+    // ObjLoader model.obj --report adds measurements the renderer has no use for. They run
+    // once the model is drawn, so the loading time covers the load path only.
+    const bool report = argv > 2 && std::string_view{ argvs[2] } == "--report";
 
-    std::vector<Drawable> drawables;
+    const size_t vertexCount = attrib.vertices.size() / 3;
 
-    for (const auto& shape : shapes)
+    ThreadPool                          threads;
+    std::vector<Drawable>               drawables;
+    std::vector<std::vector<uint32_t>>  shapeIndices;
+    std::vector<std::vector<uint32_t>>  shapeTexcoords;     // per corner, same winding as shapeIndices
+
+    // Corners flipped to the renderer's winding, texcoords kept per corner alongside
+    Load([&]
+    {
+        for (const auto& shape : shapes)
+        {
+            auto& indices   = shapeIndices.emplace_back();
+            auto& texcoords = shapeTexcoords.emplace_back();
+            indices.reserve(shape.mesh.indices.size());
+            texcoords.reserve(shape.mesh.indices.size());
+
+            const auto end = shape.mesh.indices.size();
+            for (size_t i = 0; i < end; i += 3)
+            {
+                indices.push_back(shape.mesh.indices[i + 0].vertex_index);
+                indices.push_back(shape.mesh.indices[i + 2].vertex_index);
+                indices.push_back(shape.mesh.indices[i + 1].vertex_index);
+
+                texcoords.push_back((uint32_t)shape.mesh.indices[i + 0].texcoord_index);
+                texcoords.push_back((uint32_t)shape.mesh.indices[i + 2].texcoord_index);
+                texcoords.push_back((uint32_t)shape.mesh.indices[i + 1].texcoord_index);
+            }
+        }
+    });
+
+    // Weld positions closer than a millionth of the model size and drop the triangles that collapse or repeat
+    {
+        const auto   aabb       = Load([&] { return ComputeAABB(attrib.vertices.data(), vertexCount); });
+        const float  epsilon    = aabb.Empty() ? 0.0f : 1e-6f * Length(aabb.Extents());
+
+        CleanupStats stats;
+
+        const auto cleanupBegin = std::chrono::high_resolution_clock::now();
+
+        Load([&]
+        {
+            const auto remap = WeldPositions(threads, attrib.vertices.data(), vertexCount, epsilon, stats);
+
+            for (size_t i = 0; i < shapes.size(); i++)
+            {
+                auto& mesh = shapes[i].mesh;
+
+                const auto kept = CleanupTriangles(attrib.vertices.data(), remap, shapeIndices[i], epsilon, stats);
+
+                ApplyTriangleOrder(kept, shapeTexcoords[i], 3);
+                ApplyTriangleOrder(kept, mesh.material_ids);
+                ApplyTriangleOrder(kept, mesh.smoothing_group_ids);
+            }
+        });
+
+        const auto cleanupEnd = std::chrono::high_resolution_clock::now();
+
+        printf("cleanup: welded %zu of %zu vertices, removed %zu degenerate and %zu duplicate of %zu triangles in %.3f ms\n",
+            stats.welded, stats.vertices, stats.degenerate, stats.duplicates, stats.triangles,
+            std::chrono::duration<double, std::milli>(cleanupEnd - cleanupBegin).count());
+    }
+
+    // Optional spatial pre-pass, Morton order then vertex cache order within each material run
+    const bool spatialSort = true;
+
+    // Locality of the file's order, compared after loading
+    IndexLocality localityBefore;
+
+    if (spatialSort && report)
     {
-        std::vector<uint16_t> pointIndices;
-        pointIndices.reserve(shape.mesh.indices.size());
+        Load([&]
+        {
+            for (const auto& indices : shapeIndices)
+                localityBefore += AnalyzeLocality(attrib.vertices.data(), indices.data(), indices.size());
+        });
+    }
 
-        const auto end = shape.mesh.indices.size();
-        for (size_t i = 0; i < end; i += 3)
+    if (spatialSort)
+    {
+        const auto sortBegin = std::chrono::high_resolution_clock::now();
+
+        Load([&]
         {
-            pointIndices.push_back(shape.mesh.indices[i + 0].vertex_index);
-            pointIndices.push_back(shape.mesh.indices[i + 2].vertex_index);
-            pointIndices.push_back(shape.mesh.indices[i + 1].vertex_index);
+            for (size_t i = 0; i < shapes.size(); i++)
+            {
+                auto& mesh = shapes[i].mesh;
+
+                const std::vector<uint32_t> triangleMaterials(mesh.material_ids.begin(), mesh.material_ids.end());
+                const auto order = SpatialTriangleOrder(threads, attrib.vertices.data(), shapeIndices[i].data(), shapeIndices[i].size(), triangleMaterials);
+
+                ApplyTriangleOrder(order, shapeIndices[i], 3);
+                ApplyTriangleOrder(order, shapeTexcoords[i], 3);
+                ApplyTriangleOrder(order, mesh.material_ids);
+                ApplyTriangleOrder(order, mesh.smoothing_group_ids);
+            }
+        });
+
+        const auto sortEnd = std::chrono::high_resolution_clock::now();
+
+        printf("spatial sort in %.3f ms\n", std::chrono::duration<double, std::milli>(sortEnd - sortBegin).count());
+    }
+
+    const auto lodBegin = std::chrono::high_resolution_clock::now();
+    const auto lodChains = Load([&] { return BuildLODChains(threads, attrib.vertices.data(), vertexCount, shapeIndices); });
+    const auto lodEnd   = std::chrono::high_resolution_clock::now();
+
+    printf("LOD chains built in %.2f ms\n", std::chrono::duration<double, std::milli>(lodEnd - lodBegin).count());
+
+    // Merge every shape and LOD into one vertex and one index buffer
+    std::vector<std::vector<std::span<const uint32_t>>> shapeIndexLists;
+
+    for (const auto& chain : lodChains)
+    {
+        auto& lists = shapeIndexLists.emplace_back();
+
+        for (const auto& level : chain)
+            lists.push_back(level.indices);
+    }
+
+    const auto geometry = Load([&] { return MergeShapes(attrib.vertices.data(), vertexCount, shapeIndexLists); });
+
+    std::vector<VertexRange>    shapeRanges;
+    std::vector<IndexedRange>   subMeshes;      // runs of faces sharing a material, at full resolution
+
+    Load([&]
+    {
+        for (size_t i = 0; i < shapes.size(); i++)
+        {
+            const auto& merged = geometry.shapes[i];
+
+            std::vector<LODRange> lods;
+
+            for (size_t level = 0; level < merged.ranges.size(); level++)
+                lods.push_back({ merged.ranges[level].startIndex, merged.ranges[level].indexCount, lodChains[i][level].error });
+
+            drawables.push_back({ merged.baseVertex, std::move(lods) });
+            shapeRanges.push_back({ (uint32_t)merged.baseVertex, merged.vertexCount });
+
+            const auto& materialIds = shapes[i].mesh.material_ids;
+
+            for (size_t face = 0; face < materialIds.size();)
+            {
+                size_t end = face + 1;
+                while (end < materialIds.size() && materialIds[end] == materialIds[face])
+                    end++;
+
+                subMeshes.push_back({ merged.ranges[0].startIndex + uint32_t(3 * face), uint32_t(3 * (end - face)), merged.baseVertex });
+                face = end;
+            }
         }
+    });
+
+    // Bounding volumes, cheap enough to redo whenever the geometry changes
+    const auto boundsBegin      = std::chrono::high_resolution_clock::now();
+    const auto shapeBounds      = Load([&] { return ComputeBounds(threads, geometry.positions.data(), shapeRanges); });
+    const auto subMeshBounds    = Load([&] { return ComputeBounds(threads, geometry.positions.data(), geometry.indices.data(), subMeshes); });
+    const auto boundsEnd        = std::chrono::high_resolution_clock::now();
+
+    printf("bounds for %zu shapes and %zu sub-meshes in %.3f ms\n",
+        shapeBounds.Size(), subMeshBounds.Size(), std::chrono::duration<double, std::milli>(boundsEnd - boundsBegin).count());
+
+    // Buffers upload as soon as their data is final and are collected before the frame loop
+    const DXGI_FORMAT indexFormat = geometry.Fits16BitIndices() ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+    auto              indexUpload = UploadIndices(geometry);
+
+    // Faces of every shape regrouped by material, one draw per material at full resolution
+    std::vector<std::span<const int>> faceMaterials;
+    for (const auto& shape : shapes)
+        faceMaterials.push_back(shape.mesh.material_ids);
+
+    const auto          batches             = Load([&] { return BatchByMaterial(geometry, faceMaterials); });
+    const DXGI_FORMAT   batchIndexFormat    = batches.Fits16BitIndices() ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+    auto                batchIndexUpload    = UploadIndices(batches);
 
-        auto indexBuffer = API.CreateIndexBuffer(pointIndices.data(), pointIndices.size() * sizeof(uint16_t));
+    printf("material batching: %zu materials, draws per frame: %zu per shape, %zu per shape and material -> %zu batched\n",
+        materials.size(), geometry.shapes.size(), CountMaterialRuns(faceMaterials), batches.batches.size());
 
-        drawables.emplace_back(indexBuffer, pointIndices.size());
+    // Shapes that are translated copies share one prototype mesh, drawn instanced
+    std::vector<std::span<const uint32_t>> shapeIndexSpans(shapeIndices.begin(), shapeIndices.end());
+
+    const auto instancingBegin  = std::chrono::high_resolution_clock::now();
+    auto       instanceGroups   = Load([&] { return FindInstances(attrib.vertices.data(), shapeIndexSpans, faceMaterials, 1e-6f * Length(ComputeAABB(attrib.vertices.data(), vertexCount).Extents())); });
+
+    std::vector<std::vector<std::span<const uint32_t>>> prototypeIndexLists;
+    for (const auto& group : instanceGroups)
+        prototypeIndexLists.push_back(shapeIndexLists[group.prototype]);
+
+    const auto instancedGeometry = Load([&] { return MergeShapes(attrib.vertices.data(), vertexCount, prototypeIndexLists); });
+
+    std::vector<Drawable>       prototypes;
+    std::vector<VertexRange>    prototypeRanges;
+
+    Load([&]
+    {
+        for (size_t g = 0; g < instanceGroups.size(); g++)
+        {
+            const auto& merged = instancedGeometry.shapes[g];
+
+            std::vector<LODRange> lods;
+            for (size_t level = 0; level < merged.ranges.size(); level++)
+                lods.push_back({ merged.ranges[level].startIndex, merged.ranges[level].indexCount, lodChains[instanceGroups[g].prototype][level].error });
+
+            prototypes.push_back({ merged.baseVertex, std::move(lods) });
+            prototypeRanges.push_back({ (uint32_t)merged.baseVertex, merged.vertexCount });
+        }
+    });
+
+    const auto prototypeBounds  = Load([&] { return ComputeBounds(threads, instancedGeometry.positions.data(), prototypeRanges); });
+    const auto instanceBounds   = Load([&] { return ComputeInstanceBounds(instanceGroups, prototypeBounds); });
+
+    const auto instancingEnd = std::chrono::high_resolution_clock::now();
+
+    const DXGI_FORMAT   instancedIndexFormat    = instancedGeometry.Fits16BitIndices() ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+    auto                instancedIndexUpload    = UploadIndices(instancedGeometry);
+
+    printf("instancing: %zu shapes -> %zu meshes, vertices %zu -> %zu, draws per frame at most %zu -> %zu, found in %.3f ms\n",
+        shapes.size(), instanceGroups.size(), geometry.positions.size() / 3, instancedGeometry.positions.size() / 3,
+        geometry.shapes.size(), instancedGeometry.shapes.size(),
+        std::chrono::duration<double, std::milli>(instancingEnd - instancingBegin).count());
+
+    // Vertex format, compact vertices store 16 bit positions relative to the merged geometry bounds
+    const bool compactVertices = true;
+
+    const size_t                mergedVertices  = geometry.positions.size() / 3;
+    const PositionQuantization  quantization    = compactVertices ? PositionQuantization::FromAABB(Load([&] { return ComputeAABB(geometry.positions.data(), mergedVertices); })) : PositionQuantization{};
+    const UINT                  vertexStride    = compactVertices ? 8 : 12;
+    const DXGI_FORMAT           vertexFormat    = compactVertices ? DXGI_FORMAT_R16G16B16A16_UNORM : DXGI_FORMAT_R32G32B32_FLOAT;
+
+    std::vector<uint16_t> encoded;
+
+    if (compactVertices)
+    {
+        encoded.resize(4 * mergedVertices);
+        Load([&] { EncodePositions(geometry.positions.data(), mergedVertices, quantization, encoded.data()); });
+
+        printf("compact vertices: %zu -> %zu bytes\n", geometry.positions.size() * sizeof(float), encoded.size() * sizeof(uint16_t));
     }
 
+    const void*     vertexData      = compactVertices ? (const void*)encoded.data() : (const void*)geometry.positions.data();
+    auto            vertexUpload    = loader.Upload([&] { return API.CreateVertexBuffer(vertexData, mergedVertices * vertexStride); });
+
+    // Wireframe without the geometry shader, every index becomes a vertex holding its whole triangle
+    std::vector<IndexedRange> drawRanges;
+    for (const auto& merged : geometry.shapes)
+    {
+        for (const auto& range : merged.ranges)
+            drawRanges.push_back({ range.startIndex, range.indexCount, merged.baseVertex });
+    }
+
+    const auto      expanded        = Load([&] { return ExpandTriangles(vertexData, vertexStride, geometry.indices.data(), geometry.indices.size(), drawRanges); });
+    auto            expandedUpload  = loader.Upload([&] { return API.CreateVertexBuffer(expanded.data(), expanded.size()); });
+
+    printf("expanded wireframe vertices: %zu bytes, indexed: %zu bytes\n", expanded.size(), mergedVertices * vertexStride + geometry.indices.size() * sizeof(uint32_t));
+
+    const auto      batchExpanded       = Load([&] { return ExpandTriangles(vertexData, vertexStride, batches.indices.data(), batches.indices.size(), batches.Ranges()); });
+    auto            batchExpandedUpload = loader.Upload([&] { return API.CreateVertexBuffer(batchExpanded.data(), batchExpanded.size()); });
+
+    // Prototype meshes in the same vertex format, positions fall inside the merged bounds
+    const size_t prototypeVertices = instancedGeometry.positions.size() / 3;
+
+    std::vector<uint16_t> encodedPrototypes;
+
+    if (compactVertices)
+    {
+        encodedPrototypes.resize(4 * prototypeVertices);
+        Load([&] { EncodePositions(instancedGeometry.positions.data(), prototypeVertices, quantization, encodedPrototypes.data()); });
+    }
+
+    const void*     prototypeData           = compactVertices ? (const void*)encodedPrototypes.data() : (const void*)instancedGeometry.positions.data();
+    auto            prototypeUpload         = loader.Upload([&] { return API.CreateVertexBuffer(prototypeData, prototypeVertices * vertexStride); });
+
+    std::vector<IndexedRange> prototypeDrawRanges;
+    for (const auto& merged : instancedGeometry.shapes)
+    {
+        for (const auto& range : merged.ranges)
+            prototypeDrawRanges.push_back({ range.startIndex, range.indexCount, merged.baseVertex });
+    }
+
+    const auto      prototypeExpanded       = Load([&] { return ExpandTriangles(prototypeData, vertexStride, instancedGeometry.indices.data(), instancedGeometry.indices.size(), prototypeDrawRanges); });
+    auto            prototypeExpandedUpload = loader.Upload([&] { return API.CreateVertexBuffer(prototypeExpanded.data(), prototypeExpanded.size()); });
+
+    // Slot 1 per instance transforms. Draws that are not instanced read the identity.
+    const InstanceTransform identityTransform;
+
+    auto            identityInstanceUpload  = loader.Upload([&] { return API.CreateVertexBuffer(&identityTransform, sizeof(identityTransform)); });
+    auto            instanceUpload          = loader.Upload([&] { return API.CreateDynamicVertexBuffer(std::max<size_t>(shapes.size(), 1) * sizeof(InstanceTransform)); });
+
     struct GPUPoint
     {
         float xyz[3];
@@ -92,98 +421,514 @@ int main(int argv, const char* argvs[])
     // Initiate API
     auto constants      = API.CreateConstantBuffer(4096);
 
-    auto vertexShader   = API.LoadCompiledVertexShader("VertexShader2.cso");
-    auto geometryShader = API.LoadCompiledGeometryShader("GeometryShader2.cso");
-    auto pixelShader    = API.LoadCompiledPixelShader("PixelShader2.cso");
+    // Per frame constants go into slices of a ring bound with offsets where D3D11.1 allows it
+    ConstantRing    constantRing;
+    const bool      useConstantRing = constantRing.Create(API.device, 64 * 1024);
+
+    if (!useConstantRing)
+        printf("constant buffer offsets unavailable, updating with discard\n");
+
+    // Transient vertex and index data streamed per frame, here the visible instance transforms
+    UploadRing      uploadRing;
+    const bool      useUploadRing = uploadRing.Create(API.device, 4 * 1024 * 1024, D3D11_BIND_FLAG::D3D11_BIND_VERTEX_BUFFER | D3D11_BIND_FLAG::D3D11_BIND_INDEX_BUFFER);
 
-    auto depthBuffer        = API.CreateDepthBuffer(1024, 1024);
-    auto depthView          = API.CreateDeptStencilView(depthBuffer);
+    // Shaders from their sources through the on disk cache, the first run compiles, later
+    // ones only hash. Where a source is missing or fails to compile the build's .cso is used.
+    D3DShaderCompiler   shaderCompiler;
+    ShaderCache         shaderCache{ "ShaderCache", shaderCompiler };
+
+    const auto shadersBegin = std::chrono::high_resolution_clock::now();
+
+    auto vertexShader   = API.LoadVertexShader(shaderCache, "VertexShader2.hlsl", "main", {}, "VertexShader2.cso");
+    auto expandedShader = API.LoadVertexShader(shaderCache, "VertexShader2Expanded.hlsl", "main", {}, "VertexShader2Expanded.cso");
+    auto geometryShader = API.LoadGeometryShader(shaderCache, "GeometryShader2.hlsl", "main", {}, "GeometryShader2.cso");
+    auto pixelShader    = API.LoadPixelShader(shaderCache, "PixelShader2.hlsl", "main", {}, "PixelShader2.cso");
+
+    const auto shadersEnd = std::chrono::high_resolution_clock::now();
+
+    printf("shaders: %zu from the cache, %zu compiled, %zu failed and read from .cso, in %.3f ms\n",
+        shaderCache.Hits(), shaderCache.Misses(), shaderCache.Failures(), std::chrono::duration<double, std::milli>(shadersEnd - shadersBegin).count());
 
     D3D11_INPUT_ELEMENT_DESC layout[] = {
-        { "POSITION", 0, DXGI_FORMAT::DXGI_FORMAT_R32G32B32_FLOAT,  0, 0, D3D11_INPUT_CLASSIFICATION::D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "POSITION", 0, vertexFormat,                      0, 0,   D3D11_INPUT_CLASSIFICATION::D3D11_INPUT_PER_VERTEX_DATA,    0 },
+        { "INSTANCE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT,    1, 0,   D3D11_INPUT_CLASSIFICATION::D3D11_INPUT_PER_INSTANCE_DATA,  1 },
+        { "INSTANCE", 1, DXGI_FORMAT_R32G32B32A32_FLOAT,    1, 16,  D3D11_INPUT_CLASSIFICATION::D3D11_INPUT_PER_INSTANCE_DATA,  1 },
+        { "INSTANCE", 2, DXGI_FORMAT_R32G32B32A32_FLOAT,    1, 32,  D3D11_INPUT_CLASSIFICATION::D3D11_INPUT_PER_INSTANCE_DATA,  1 },
     };
 
     ID3D11InputLayout* inputLayout1 = nullptr;
-    API.device->CreateInputLayout(layout, 1, vertexShader.ByteCode(), vertexShader.ByteCodeSize(), &inputLayout1);
+    API.device->CreateInputLayout(layout, 4, vertexShader.ByteCode(), vertexShader.ByteCodeSize(), &inputLayout1);
+
+    D3D11_INPUT_ELEMENT_DESC expandedLayout[] = {
+        { "POSITION", 0, vertexFormat,                      0, 0,                   D3D11_INPUT_CLASSIFICATION::D3D11_INPUT_PER_VERTEX_DATA,    0 },
+        { "POSITION", 1, vertexFormat,                      0, vertexStride,        D3D11_INPUT_CLASSIFICATION::D3D11_INPUT_PER_VERTEX_DATA,    0 },
+        { "POSITION", 2, vertexFormat,                      0, 2 * vertexStride,    D3D11_INPUT_CLASSIFICATION::D3D11_INPUT_PER_VERTEX_DATA,    0 },
+        { "INSTANCE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT,    1, 0,                   D3D11_INPUT_CLASSIFICATION::D3D11_INPUT_PER_INSTANCE_DATA,  1 },
+        { "INSTANCE", 1, DXGI_FORMAT_R32G32B32A32_FLOAT,    1, 16,                  D3D11_INPUT_CLASSIFICATION::D3D11_INPUT_PER_INSTANCE_DATA,  1 },
+        { "INSTANCE", 2, DXGI_FORMAT_R32G32B32A32_FLOAT,    1, 32,                  D3D11_INPUT_CLASSIFICATION::D3D11_INPUT_PER_INSTANCE_DATA,  1 },
+    };
+
+    ID3D11InputLayout* inputLayout2 = nullptr;
+    API.device->CreateInputLayout(expandedLayout, 6, expandedShader.ByteCode(), expandedShader.ByteCodeSize(), &inputLayout2);
 
     // Camera
     Camera viewpoint;
-    viewpoint.aspectRatio = 1.0f;
+    viewpoint.aspectRatio = float(API.width) / float(API.height);
     viewpoint.Translate(0, 5.0f, 7.5f);
     viewpoint.Pitch(-3.1415919f / 8.0f);
 
+    // Measurements for --report, the window presents cleared frames while they run
+    auto Report = [&]()
+    {
+        // Vertex normals from smoothing groups, files without any s lines are smoothed by crease angle only.
+        // The vertex format has no normals or tangents yet, they are generated for the report.
+        std::vector<NormalInput> normalInputs;
+        for (size_t i = 0; i < shapes.size(); i++)
+        {
+            const auto& groups      = shapes[i].mesh.smoothing_group_ids;
+            const bool  hasGroups   = std::any_of(groups.begin(), groups.end(), [](unsigned int g) { return g != 0; });
+
+            normalInputs.push_back({ shapeIndices[i], shapeTexcoords[i], hasGroups ? std::span<const uint32_t>{ groups } : std::span<const uint32_t>{} });
+        }
+
+        const auto normalsBegin = std::chrono::high_resolution_clock::now();
+        const auto normalMeshes = GenerateNormals(threads, attrib.vertices.data(), normalInputs);
+        const auto normalsEnd   = std::chrono::high_resolution_clock::now();
+
+        {
+            size_t corners  = 0;
+            size_t vertices = 0;
+
+            for (const auto& mesh : normalMeshes)
+            {
+                corners     += mesh.indices.size();
+                vertices    += mesh.vertices.size();
+            }
+
+            printf("normals: %zu corners welded to %zu vertices in %.3f ms\n",
+                corners, vertices, std::chrono::duration<double, std::milli>(normalsEnd - normalsBegin).count());
+        }
+
+        const auto tangentsBegin    = std::chrono::high_resolution_clock::now();
+        const auto tangentMeshes    = GenerateTangents(threads, attrib.vertices.data(), attrib.texcoords.data(), normalMeshes);
+        const auto tangentsEnd      = std::chrono::high_resolution_clock::now();
+
+        {
+            size_t vertices = 0;
+            for (const auto& mesh : tangentMeshes)
+                vertices += mesh.source.size();
+
+            printf("tangents: %zu vertices after mirror seam splits in %.3f ms\n",
+                vertices, std::chrono::duration<double, std::milli>(tangentsEnd - tangentsBegin).count());
+        }
+
+        if (spatialSort)
+        {
+            IndexLocality after;
+            for (const auto& indices : shapeIndices)
+                after += AnalyzeLocality(attrib.vertices.data(), indices.data(), indices.size());
+
+            printf("spatial sort: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, mean triangle step %g -> %g\n",
+                localityBefore.ACMR(), after.ACMR(), localityBefore.ATVR(), after.ATVR(), localityBefore.MeanStep(), after.MeanStep());
+        }
+
+        if (compactVertices)
+        {
+            QuantizationError error;
+            MeasurePositionError(geometry.positions.data(), encoded.data(), mergedVertices, quantization, error);
+
+            // Normals and UVs are not in the vertex buffer yet, measured as their encodings would store them
+            std::vector<float> normals;
+            for (const auto& mesh : normalMeshes)
+            {
+                for (const auto& vertex : mesh.vertices)
+                    normals.insert(normals.end(), { vertex.normal.x, vertex.normal.y, vertex.normal.z });
+            }
+
+            std::vector<int16_t>    encodedNormals(normals.size() / 3 * 2);
+            std::vector<uint16_t>   encodedUVs(attrib.texcoords.size());
+
+            EncodeNormals(normals.data(), normals.size() / 3, encodedNormals.data());
+            EncodeHalfs(attrib.texcoords.data(), attrib.texcoords.size(), encodedUVs.data());
+
+            MeasureNormalError(normals.data(), encodedNormals.data(), normals.size() / 3, error);
+            MeasureHalfError(attrib.texcoords.data(), encodedUVs.data(), attrib.texcoords.size(), error);
+
+            printf("compact vertices: position error max %g, rms %g, normal error max %g degrees, uv error max %g\n",
+                error.positionMax, error.positionRMS, error.normalMaxDegrees, error.uvMax);
+        }
+
+        // Cluster culling from the initial viewpoint
+        std::vector<MeshletMesh> meshlets;
+
+        const auto meshletsBegin = std::chrono::high_resolution_clock::now();
+
+        for (const auto& indices : shapeIndices)
+            meshlets.push_back(BuildMeshlets(attrib.vertices.data(), vertexCount, indices.data(), indices.size()));
+
+        const auto meshletsEnd = std::chrono::high_resolution_clock::now();
+
+        {
+            const auto frustum = viewpoint.GetFrustum();
+
+            ClusterCullStats        stats;
+            std::vector<uint32_t>   visible;
+
+            for (const auto& mesh : meshlets)
+                stats += CullMeshlets(mesh, frustum, viewpoint.GetPosition(), visible);
+
+            printf("meshlets: %zu built in %.3f ms, frustum culled: %zu, backface culled: %zu, triangles: %zu / %zu\n",
+                stats.meshlets, std::chrono::duration<double, std::milli>(meshletsEnd - meshletsBegin).count(),
+                stats.frustumCulled, stats.backfaceCulled, stats.trianglesVisible, stats.trianglesTotal);
+        }
+
+        // Triangle BVH over the full resolution geometry, picked through every pixel of a 256x256 grid
+        std::vector<IndexedRange> shapeTriangles;
+        for (const auto& merged : geometry.shapes)
+            shapeTriangles.push_back({ merged.ranges[0].startIndex, merged.ranges[0].indexCount, merged.baseVertex });
+
+        TriangleBVH bvh;
+
+        const auto bvhBegin = std::chrono::high_resolution_clock::now();
+        bvh.Build(threads, geometry.positions.data(), geometry.indices.data(), shapeTriangles);
+        const auto bvhEnd   = std::chrono::high_resolution_clock::now();
+
+        printf("BVH: %zu triangles, %zu nodes, depth %zu in %.3f ms\n",
+            bvh.TriangleCount(), bvh.NodeCount(), bvh.Depth(), std::chrono::duration<double, std::milli>(bvhEnd - bvhBegin).count());
+
+        const int   gridSize    = 256;
+        size_t      hits        = 0;
+        RayHit      centerHit;
+
+        const auto pickBegin = std::chrono::high_resolution_clock::now();
+
+        for (int y = 0; y < gridSize; y++)
+        {
+            for (int x = 0; x < gridSize; x++)
+            {
+                const float ndcX = 2.0f * (x + 0.5f) / gridSize - 1.0f;
+                const float ndcY = 1.0f - 2.0f * (y + 0.5f) / gridSize;
+                const auto  hit  = bvh.Intersect(viewpoint.GetRay(ndcX, ndcY));
+
+                hits += hit.Hit();
+
+                if (x == gridSize / 2 && y == gridSize / 2)
+                    centerHit = hit;
+            }
+        }
+
+        const auto      pickEnd = std::chrono::high_resolution_clock::now();
+        const double    seconds = std::chrono::duration<double>(pickEnd - pickBegin).count();
+
+        printf("picking: %zu / %d rays hit, %.2f Mrays/s, center: shape %u triangle %u at t = %g\n",
+            hits, gridSize * gridSize, gridSize * gridSize / std::max(seconds, 1e-9) / 1e6,
+            centerHit.shape, centerHit.triangle, centerHit.Hit() ? centerHit.t : 0.0f);
+    };
+
     // Begin loop
     auto before = std::chrono::high_resolution_clock::now();
     double t    = 0;
     double dt   = 0.0f;
 
+    const float maxPixelError = 1.0f;
+
+    std::vector<uint32_t> visibleShapes;
+
+    enum class DrawMode { PerShape, Batched, Instanced };
+
+    bool        useGeometryShader   = false;                // G toggles between the two wireframe paths
+    DrawMode    drawMode            = DrawMode::PerShape;   // M toggles one draw per material, I instanced prototypes
+    bool        useDeferred         = false;                // D toggles replay on deferred contexts
+
+    std::vector<InstanceTransform>  visibleInstances;
+    std::vector<InstanceDraw>       instanceDraws;
+
+    // Pipelines and geometry recorded draws refer to, geometry is 2 * DrawMode + pipeline
+    const PipelineState pipelineStates[] = {
+        { inputLayout1, vertexShader.shader,    geometryShader.shader,  pixelShader.shader },
+        { inputLayout2, expandedShader.shader,  nullptr,                pixelShader.shader },
+    };
+
+    auto Geometry = [&](ID3D11Buffer* vertices, const UINT stride, ID3D11Buffer* instances, ID3D11Buffer* indices, const DXGI_FORMAT format)
+    {
+        return GeometryState{ { vertices, instances }, { stride, sizeof(InstanceTransform) }, { 0, 0 }, indices, format };
+    };
+
+    // The model appears once the upload thread caught up
+    auto Collect = [&](std::future<ID3D11Buffer*>& upload) { return loader.Wait(std::move(upload), PresentLoading); };
+
+    ID3D11Buffer* indexBuffer               = Collect(indexUpload);
+    ID3D11Buffer* batchIndexBuffer          = Collect(batchIndexUpload);
+    ID3D11Buffer* instancedIndexBuffer      = Collect(instancedIndexUpload);
+    ID3D11Buffer* vertexBuffer              = Collect(vertexUpload);
+    ID3D11Buffer* expandedBuffer            = Collect(expandedUpload);
+    ID3D11Buffer* batchExpandedBuffer       = Collect(batchExpandedUpload);
+    ID3D11Buffer* prototypeBuffer           = Collect(prototypeUpload);
+    ID3D11Buffer* prototypeExpandedBuffer   = Collect(prototypeExpandedUpload);
+    ID3D11Buffer* identityInstanceBuffer    = Collect(identityInstanceUpload);
+    ID3D11Buffer* instanceBuffer            = Collect(instanceUpload);
+
+    GeometryState geometryStates[] = {
+        Geometry(vertexBuffer,              vertexStride,       identityInstanceBuffer, indexBuffer,            indexFormat),
+        Geometry(expandedBuffer,            3 * vertexStride,   identityInstanceBuffer, nullptr,                indexFormat),
+        Geometry(vertexBuffer,              vertexStride,       identityInstanceBuffer, batchIndexBuffer,       batchIndexFormat),
+        Geometry(batchExpandedBuffer,       3 * vertexStride,   identityInstanceBuffer, nullptr,                batchIndexFormat),
+        Geometry(prototypeBuffer,           vertexStride,       instanceBuffer,         instancedIndexBuffer,   instancedIndexFormat),
+        Geometry(prototypeExpandedBuffer,   3 * vertexStride,   instanceBuffer,         nullptr,                instancedIndexFormat),
+    };
+
+    CommandBuffer       commands;
+    ParallelRecorder    recorder;
+    DeferredReplay      deferred;
+
+    if (!deferred.Create(API.device, threads.ThreadCount()))
+        printf("deferred contexts unavailable\n");
+
+    // Rebuilt and compiled every frame, transient textures stay pooled
+    FrameGraph<ID3D11Resource*>     frameGraph;
+    TransientPool<ID3D11Resource*>  graphTextures;
+
+    // Bindings persist across frames, the cache only forwards the ones that change
+    D3D11StateCache state{ API.context };
+    size_t          frame = 0;
+
+    state.ClearState();
+
     while (true)
     {
         MSG msg;
 
         while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
         {
+            if (msg.message == WM_KEYDOWN && msg.wParam == 'G')
+                useGeometryShader = !useGeometryShader;
+
+            if (msg.message == WM_KEYDOWN && msg.wParam == 'M')
+                drawMode = drawMode == DrawMode::Batched ? DrawMode::PerShape : DrawMode::Batched;
+
+            if (msg.message == WM_KEYDOWN && msg.wParam == 'I')
+                drawMode = drawMode == DrawMode::Instanced ? DrawMode::PerShape : DrawMode::Instanced;
+
+            if (msg.message == WM_KEYDOWN && msg.wParam == 'D')
+                useDeferred = !useDeferred && deferred.ContextCount();
+
             TranslateMessage(&msg);
             DispatchMessage(&msg);
         }
 
+        // Views are rebuilt for the new size. A failed resize cleared the state as well,
+        // either way whatever the cache knew is gone.
+        const ResizeResult resize = API.HandleResize();
+
+        if (resize != ResizeResult::Unchanged)
+            state.Invalidate();
+
+        if (resize == ResizeResult::Resized)
+            viewpoint.aspectRatio = float(API.width) / float(API.height);
+
         before = std::chrono::high_resolution_clock::now();
 
-        auto renderTargetView = API.GetBackBufferView();
+        auto renderTargetView   = API.GetBackBufferView();
+        auto depthView          = API.GetDepthView();
 
         struct {
-            DirectX::XMMATRIX pvt;
+            DirectX::XMMATRIX   pvt;
+            DirectX::XMFLOAT4   positionOffset;
+            DirectX::XMFLOAT4   positionScale;
+            DirectX::XMFLOAT4   viewportScale;
         } constantValues{
-            .pvt = DirectX::XMMatrixRotationY((float)t) * viewpoint.GetPV(),
+            .pvt            = DirectX::XMMatrixRotationY((float)t) * viewpoint.GetPV(),
+            .positionOffset = { quantization.offset.x, quantization.offset.y, quantization.offset.z, 0.0f },
+            .positionScale  = { quantization.scale.x, quantization.scale.y, quantization.scale.z, 0.0f },
+            .viewportScale  = { float(API.width), float(API.height), 0.0f, 0.0f },
         };
 
-        API.UpdateDiscard(constants, constantValues);
+        const ConstantSlice constantSlice = useConstantRing ? constantRing.Write(API.context, constantValues) : ConstantSlice{};
 
-        // Clear States
-        API.context->ClearState();
-        API.context->VSSetConstantBuffers(0, 1, &constants);
-        API.context->PSSetConstantBuffers(0, 1, &constants);
+        if (!constantSlice)
+            API.UpdateDiscard(constants, constantValues);
 
-        const float clearColor[4] = { 0.1f, 0.1f, 0.1f, 1.0f };
-        API.context->ClearRenderTargetView(renderTargetView, clearColor);
-        API.context->ClearDepthStencilView(depthView, D3D11_CLEAR_DEPTH, 1.0, 0);
+        state.Stats().Reset();
 
         D3D11_VIEWPORT  viewports = { 0 };
-        viewports.Width     = 1024;
-        viewports.Height    = 1024;
+        viewports.Width     = float(API.width);
+        viewports.Height    = float(API.height);
         viewports.MinDepth  = 0.0f;
         viewports.MaxDepth  = 1.0f;
 
         D3D11_RECT      rects = { 0 };
-        rects.right     = 1024;
-        rects.bottom    = 1024;
+        rects.right     = LONG(API.width);
+        rects.bottom    = LONG(API.height);
 
-        const UINT offsets[] = { 0 };
-        const UINT strides[] = { 12 };
+        // State packets do not carry, bound on the immediate and on every deferred context
+        auto BindFrameState = [&](D3D11StateCache& frameState)
+        {
+            ID3D11DeviceContext1* context1 = nullptr;
+
+            // Offsets are bound past the cache, which then no longer knows slot 0
+            if (constantSlice && SUCCEEDED(frameState.Context()->QueryInterface(IID_PPV_ARGS(&context1))))
+            {
+                BindConstants(context1, 0, constantSlice);
+                frameState.InvalidateConstantBuffers();
+                context1->Release();
+            }
+            else
+            {
+                frameState.VSSetConstantBuffers(0, 1, &constants);
+                frameState.GSSetConstantBuffers(0, 1, &constants);
+                frameState.PSSetConstantBuffers(0, 1, &constants);
+            }
+
+            frameState.IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+            frameState.RSSetViewports(1, &viewports);
+            frameState.RSSetScissorRects(1, &rects);
+            frameState.OMSetRenderTargets(1, &renderTargetView, depthView);
+        };
 
-        API.context->IASetInputLayout(inputLayout1);
-        API.context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        API.context->IASetVertexBuffers(0, 1, &vertexBuffer, strides, offsets);
+        // Culling and LODs work in object space
+        DirectX::XMFLOAT3 objectSpaceCamera;
+        DirectX::XMStoreFloat3(&objectSpaceCamera, DirectX::XMVector3Transform(viewpoint.p, DirectX::XMMatrixRotationY(-(float)t)));
 
-        API.context->VSSetShader(vertexShader, nullptr, 0);
-        API.context->GSSetShader(geometryShader, nullptr, 0);
-        API.context->PSSetShader(pixelShader, nullptr, 0);
+        const Frustum   frustum         = viewpoint.GetFrustum(DirectX::XMMatrixRotationY((float)t));
+        const float3    cameraPosition  = { objectSpaceCamera.x, objectSpaceCamera.y, objectSpaceCamera.z };
+        const float     projectionScale = viewpoint.GetProjectionScale(viewports.Height);
 
-        API.context->RSSetViewports(1, &viewports);
-        API.context->RSSetScissorRects(1, &rects);
-        API.context->OMSetRenderTargets(1, &renderTargetView, depthView);
+        // Record, sort by pipeline, material and depth, then replay
+        const uint16_t pipeline = useGeometryShader ? 0 : 1;
+        const uint16_t geometry = uint16_t(2 * size_t(drawMode) + pipeline);
 
-        // Draw drawables
-        for (auto& shape : drawables)
+        commands.Clear();
+
+        if (drawMode == DrawMode::Batched)
+        {
+            // Every material at full resolution without culling
+            for (const auto& batch : batches.batches)
+                commands.Draw(MakeSortKey(0, pipeline, uint32_t(batch.material + 1), 0.0f), { pipeline, geometry, batch.indexCount, batch.startIndex });
+        }
+        else if (drawMode == DrawMode::Instanced)
+        {
+            // Visible instances compacted per prototype and LOD, one instanced draw each
+            BuildInstanceDraws(threads, frustum, instanceGroups, instanceBounds,
+                [&](const uint32_t group, const BoundingSphere& bounds)
+                {
+                    return uint32_t(SelectLOD(prototypes[group].lods, Length(bounds.center - cameraPosition) - bounds.radius, projectionScale, maxPixelError));
+                },
+                visibleInstances, instanceDraws);
+
+            if (!visibleInstances.empty())
+            {
+                const UploadSlice slice = useUploadRing ? uploadRing.Write(API.context, std::span<const InstanceTransform>{ visibleInstances }) : UploadSlice{};
+
+                if (!slice)
+                    API.UpdateDiscard(instanceBuffer, visibleInstances.data(), visibleInstances.size() * sizeof(InstanceTransform));
+
+                // Slot 1 of both instanced geometries reads this frame's transforms
+                for (size_t g = 2 * size_t(DrawMode::Instanced); g < 2 * size_t(DrawMode::Instanced) + 2; g++)
+                {
+                    geometryStates[g].vertexBuffers[1]  = slice ? slice.buffer : instanceBuffer;
+                    geometryStates[g].offsets[1]        = slice.offset;
+                }
+            }
+
+            for (const auto& draw : instanceDraws)
+            {
+                const auto& prototype   = prototypes[draw.group];
+                const auto& lod         = prototype.lods[draw.level];
+
+                commands.Draw(MakeSortKey(0, pipeline, 0, 0.0f), { pipeline, geometry, lod.indexCount, lod.startIndex, prototype.baseVertex, draw.instanceCount, draw.firstInstance });
+            }
+        }
+        else
         {
-            API.context->IASetIndexBuffer(shape.indexBuffer, DXGI_FORMAT::DXGI_FORMAT_R16_UINT, 0);
-            API.context->DrawIndexed((UINT)shape.indexCount, 0, 0);
+            // Cull and draw drawables front to back, workers record disjoint ranges of the visible set
+            FrustumCull(threads, frustum, shapeBounds, visibleShapes);
+
+            recorder.Record(threads, visibleShapes.size(), 256, commands,
+                [&](CommandBuffer& out, const size_t begin, const size_t end)
+                {
+                    for (size_t v = begin; v < end; v++)
+                    {
+                        const uint32_t  i               = visibleShapes[v];
+                        const auto&     shape           = drawables[i];
+                        const auto      bounds          = shapeBounds.GetSphere(i);
+                        const float     distance        = Length(bounds.center - cameraPosition) - bounds.radius;
+                        const auto&     lod             = shape.lods[SelectLOD(shape.lods, distance, projectionScale, maxPixelError)];
+
+                        out.Draw(MakeSortKey(0, pipeline, 0, distance), { pipeline, geometry, lod.indexCount, lod.startIndex, shape.baseVertex });
+                    }
+                });
         }
 
+        commands.Sort(threads);
+
+        // GPU work of the frame as graph passes on the back buffer and depth
+        frameGraph.Reset();
+
+        const auto backBuffer   = frameGraph.Import("back buffer", API.backBuffer);
+        const auto depth        = frameGraph.Import("depth", API.depthBuffer);
+
+        frameGraph.AddPass("clear",
+            [&](auto& pass)
+            {
+                pass.Write(backBuffer);
+                pass.Write(depth);
+            },
+            [&](const auto&)
+            {
+                const float clearColor[4] = { 0.1f, 0.1f, 0.1f, 1.0f };
+                API.context->ClearRenderTargetView(renderTargetView, clearColor);
+                API.context->ClearDepthStencilView(depthView, D3D11_CLEAR_DEPTH, 1.0, 0);
+            });
+
+        frameGraph.AddPass("scene",
+            [&](auto& pass)
+            {
+                pass.Write(backBuffer);
+                pass.Write(depth);
+            },
+            [&](const auto&)
+            {
+                BindFrameState(state);
+
+                if (useDeferred)
+                {
+                    // Leaves the immediate context cleared
+                    deferred.Replay(threads, API.context, pipelineStates, geometryStates, commands, BindFrameState);
+                    state.Invalidate();
+                }
+                else
+                    Replay(state, pipelineStates, geometryStates, commands);
+            });
+
+        if (frameGraph.Compile())
+            frameGraph.Execute(graphTextures, [&](const TextureKey& key) { return API.CreateTransientTexture(key); });
+
+        graphTextures.EndFrame(2, [](ID3D11Resource* texture) { if (texture) texture->Release(); });
+
+        if (frame++ == 1)
+            printf("state cache: %zu calls issued, %zu skipped per frame\n", state.Stats().issued, state.Stats().skipped);
+
+        if (useConstantRing)
+            constantRing.EndFrame(API.context);
+
+        if (useUploadRing)
+            uploadRing.EndFrame(API.context);
+
         // Present
-        renderTargetView->Release();
         API.swapChain->Present(1, 0);
 
+        if (frame == 1)
+        {
+            const auto now = std::chrono::high_resolution_clock::now();
+            longestStall = std::max(longestStall, std::chrono::duration<double, std::milli>(now - lastPresent).count());
+
+            printf("loading: window presenting after %.1f ms, model drawn after %.1f ms, %zu loading frames, longest stall %.1f ms\n", windowTime,
+                std::chrono::duration<double, std::milli>(now - startTime).count(), loadingFrames, longestStall);
+
+            if (report)
+                Load(Report);
+        }
+
         const auto after    = std::chrono::high_resolution_clock::now();
         const auto duration = after - before;
 
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Threading.hpp"
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+// Loading that leaves the calling thread free to present. Run takes parsing and
+// processing steps to a background thread, Upload takes resource creation to a thread
+// of its own, for D3D11 through the device, which is free threaded, while the immediate
+// context stays with the caller. Wait keeps calling Idle, e.g. pumping messages and
+// presenting a frame, until the result is ready.
+class AsyncLoader
+{
+public:
+	template<typename FN>
+	auto Run(FN&& fn)       { return Push(worker, std::forward<FN>(fn)); }
+
+	template<typename FN>
+	auto Upload(FN&& fn)    { return Push(uploader, std::forward<FN>(fn)); }
+
+	template<typename TY, typename IDLE>
+	TY Wait(std::future<TY> result, IDLE&& Idle)
+	{
+		while (result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			Idle();
+
+		return result.get();
+	}
+
+private:
+	template<typename FN>
+	static auto Push(ThreadPool& pool, FN&& fn)
+	{
+		using Result = std::invoke_result_t<std::decay_t<FN>&>;
+
+		auto task   = std::make_shared<std::packaged_task<Result()>>(std::forward<FN>(fn));
+		auto result = task->get_future();
+
+		pool.Push([task] { (*task)(); });
+
+		return result;
+	}
+
+	// One worker each, the pools' callers never take part
+	ThreadPool worker   { 1 };
+	ThreadPool uploader { 1 };
+};
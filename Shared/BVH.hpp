@@ -0,0 +1,529 @@
+#pragma once
+
+#include "Bounds.hpp"
+#include "Geometry.hpp"
+#include "RadixSort.hpp"
+#include "SIMD.hpp"
+#include "Threading.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+struct BVHNode
+{
+	float       min[3];
+	uint32_t    leftOrFirst;    // interior: left child, right child follows it. leaf: first triangle
+	float       max[3];
+	uint32_t    count;          // 0 for interior nodes
+};
+
+static_assert(sizeof(BVHNode) == 32);
+
+struct RayHit
+{
+	float       t           = FLT_MAX;
+	float       u           = 0.0f;     // barycentrics of the second and third vertex
+	float       v           = 0.0f;
+	uint32_t    shape       = UINT32_MAX;
+	uint32_t    triangle    = UINT32_MAX;   // within the shape
+
+	bool Hit() const noexcept { return shape != UINT32_MAX; }
+};
+
+enum class BVHBuildMode
+{
+	SAH,    // binned surface area heuristic, best traversal speed
+	LBVH,   // Morton ordered, fast rebuilds
+};
+
+class TriangleBVH
+{
+public:
+	// Each range is one shape's triangles in the shared index and position arrays
+	void Build(ThreadPool& threads, const float* positions, const uint32_t* indices, const std::span<const IndexedRange> shapes, const BVHBuildMode mode = BVHBuildMode::SAH)
+	{
+		size_t triangleCount = 0;
+		for (const auto& shape : shapes)
+			triangleCount += shape.indexCount / 3;
+
+		triangles.resize(triangleCount);
+		references.resize(triangleCount);
+		nodes.resize(std::max<size_t>(1, 2 * triangleCount));
+		nodeCount = 1;
+
+		std::vector<float3> centroids(triangleCount);
+		std::vector<AABB>   boxes(triangleCount);
+
+		{
+			size_t t = 0;
+			for (uint32_t s = 0; s < shapes.size(); s++)
+			{
+				for (uint32_t i = 0; i < shapes[s].indexCount / 3; i++, t++)
+					references[t] = { s, i };
+			}
+		}
+
+		threads.ParallelFor(triangleCount, 4096,
+			[&](size_t begin, size_t end)
+			{
+				for (size_t t = begin; t < end; t++)
+				{
+					const auto&     shape   = shapes[references[t].shape];
+					const uint32_t* tri     = indices + shape.startIndex + 3 * references[t].triangle;
+
+					const float3 a = LoadFloat3(positions + 3 * size_t(tri[0] + shape.baseVertex));
+					const float3 b = LoadFloat3(positions + 3 * size_t(tri[1] + shape.baseVertex));
+					const float3 c = LoadFloat3(positions + 3 * size_t(tri[2] + shape.baseVertex));
+
+					triangles[t]    = { a, b - a, c - a };
+					boxes[t]        = { Min(a, Min(b, c)), Max(a, Max(b, c)) };
+					centroids[t]    = (a + b + c) / 3.0f;
+				}
+			});
+
+		std::vector<uint32_t> order(triangleCount);
+		for (uint32_t t = 0; t < triangleCount; t++)
+			order[t] = t;
+
+		Builder builder{ *this, boxes, centroids, order, mode, {}, 1, 0 };
+
+		if (mode == BVHBuildMode::LBVH)
+			builder.SortMorton(threads);
+
+		builder.Build(threads);
+
+		// Reorder triangles to leaf order so leaves reference contiguous ranges
+		std::vector<Triangle>           sortedTriangles(triangleCount);
+		std::vector<TriangleReference>  sortedReferences(triangleCount);
+
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			sortedTriangles[t]  = triangles[order[t]];
+			sortedReferences[t] = references[order[t]];
+		}
+
+		triangles   = std::move(sortedTriangles);
+		references  = std::move(sortedReferences);
+		nodes.resize(nodeCount);
+	}
+
+	RayHit Intersect(const Ray& ray) const noexcept
+	{
+		RayHit hit;
+		hit.t = ray.tMax;
+
+		if (triangles.empty())
+			return hit;
+
+		const __m128 origin     = _mm_setr_ps(ray.origin.x, ray.origin.y, ray.origin.z, 0.0f);
+		const __m128 invDir     = _mm_div_ps(_mm_set1_ps(1.0f), _mm_setr_ps(ray.direction.x, ray.direction.y, ray.direction.z, 1.0f));
+
+		// Leaves are no deeper than maxDepth and each level pushes at most one node
+		uint32_t    stack[maxDepth];
+		uint32_t    stackSize   = 0;
+		uint32_t    nodeIdx     = 0;
+
+		if (SlabTest(nodes[0], origin, invDir, hit.t) == FLT_MAX)
+			return hit;
+
+		while (true)
+		{
+			const BVHNode& node = nodes[nodeIdx];
+
+			if (node.count)
+			{
+				for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++)
+					IntersectTriangle(ray, i, hit);
+			}
+			else
+			{
+				uint32_t near   = node.leftOrFirst;
+				uint32_t far    = node.leftOrFirst + 1;
+				float    tNear  = SlabTest(nodes[near], origin, invDir, hit.t);
+				float    tFar   = SlabTest(nodes[far], origin, invDir, hit.t);
+
+				if (tFar < tNear)
+				{
+					std::swap(near, far);
+					std::swap(tNear, tFar);
+				}
+
+				if (tNear != FLT_MAX)
+				{
+					if (tFar != FLT_MAX)
+					{
+						assert(stackSize < maxDepth);
+						stack[stackSize++] = far;
+					}
+
+					nodeIdx = near;
+					continue;
+				}
+			}
+
+			if (!stackSize)
+				break;
+
+			nodeIdx = stack[--stackSize];
+		}
+
+		return hit;
+	}
+
+	size_t NodeCount()      const noexcept { return nodes.size(); }
+	size_t TriangleCount()  const noexcept { return triangles.size(); }
+	size_t Depth()          const noexcept { return depth; }
+
+private:
+	static constexpr uint32_t maxDepth = 64;
+
+	struct Triangle
+	{
+		float3 v0;
+		float3 e1;
+		float3 e2;
+	};
+
+	struct TriangleReference
+	{
+		uint32_t shape;
+		uint32_t triangle;
+	};
+
+	// Entry distance of the ray, FLT_MAX on a miss or when further than tMax
+	static float SlabTest(const BVHNode& node, const __m128 origin, const __m128 invDir, const float tMax) noexcept
+	{
+		// Lane 3 holds the child index/count bits, cleared so they are never read as denormals
+		const __m128 xyz = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+
+		const __m128 lo = _mm_mul_ps(_mm_sub_ps(_mm_and_ps(_mm_loadu_ps(node.min), xyz), origin), invDir);
+		const __m128 hi = _mm_mul_ps(_mm_sub_ps(_mm_and_ps(_mm_loadu_ps(node.max), xyz), origin), invDir);
+
+		// Lane 3 becomes the [0, tMax] ray interval
+		__m128 t0 = _mm_and_ps(_mm_min_ps(lo, hi), xyz);
+		__m128 t1 = Select(xyz, _mm_max_ps(lo, hi), _mm_set1_ps(tMax));
+
+		t0 = _mm_max_ps(t0, _mm_shuffle_ps(t0, t0, _MM_SHUFFLE(1, 0, 3, 2)));
+		t0 = _mm_max_ps(t0, _mm_shuffle_ps(t0, t0, _MM_SHUFFLE(2, 3, 0, 1)));
+		t1 = _mm_min_ps(t1, _mm_shuffle_ps(t1, t1, _MM_SHUFFLE(1, 0, 3, 2)));
+		t1 = _mm_min_ps(t1, _mm_shuffle_ps(t1, t1, _MM_SHUFFLE(2, 3, 0, 1)));
+
+		const float tEnter  = _mm_cvtss_f32(t0);
+		const float tExit   = _mm_cvtss_f32(t1);
+
+		return tEnter <= tExit ? tEnter : FLT_MAX;
+	}
+
+	// Moller-Trumbore, both windings
+	void IntersectTriangle(const Ray& ray, const uint32_t i, RayHit& hit) const noexcept
+	{
+		const Triangle& tri = triangles[i];
+
+		const float3 p      = Cross(ray.direction, tri.e2);
+		const float  det    = Dot(tri.e1, p);
+
+		if (std::abs(det) < 1e-12f)
+			return;
+
+		const float  invDet = 1.0f / det;
+		const float3 s      = ray.origin - tri.v0;
+		const float  u      = Dot(s, p) * invDet;
+
+		if (u < 0.0f || u > 1.0f)
+			return;
+
+		const float3 q = Cross(s, tri.e1);
+		const float  v = Dot(ray.direction, q) * invDet;
+
+		if (v < 0.0f || u + v > 1.0f)
+			return;
+
+		const float t = Dot(tri.e2, q) * invDet;
+
+		if (t > 0.0f && t < hit.t)
+		{
+			hit.t           = t;
+			hit.u           = u;
+			hit.v           = v;
+			hit.shape       = references[i].shape;
+			hit.triangle    = references[i].triangle;
+		}
+	}
+
+	struct Builder
+	{
+		static constexpr uint32_t binCount      = 16;
+		static constexpr uint32_t maxLeafSize   = 4;
+
+		TriangleBVH&                bvh;
+		const std::vector<AABB>&    boxes;
+		const std::vector<float3>&  centroids;
+		std::vector<uint32_t>&      order;
+		BVHBuildMode                mode;
+
+		std::vector<uint32_t>       mortonCodes;
+		std::atomic_uint32_t        nextNode = 1;
+		std::atomic_uint32_t        depth    = 0;
+
+		struct Task
+		{
+			uint32_t node;
+			uint32_t first;
+			uint32_t count;
+			uint32_t depth;     // root is 0
+		};
+
+		void SortMorton(ThreadPool& threads)
+		{
+			const size_t count = order.size();
+
+			AABB extents;
+			for (const auto& c : centroids)
+			{
+				extents.min = Min(extents.min, c);
+				extents.max = Max(extents.max, c);
+			}
+
+			mortonCodes.resize(count);
+			threads.ParallelFor(count, 4096,
+				[&](size_t begin, size_t end)
+				{
+					for (size_t t = begin; t < end; t++)
+						mortonCodes[t] = MortonCode(centroids[order[t]], extents);
+				});
+
+			RadixSort(threads, mortonCodes, order);
+		}
+
+		void SetBounds(const uint32_t node, const uint32_t first, const uint32_t count) noexcept
+		{
+			AABB aabb;
+			for (uint32_t i = first; i < first + count; i++)
+			{
+				aabb.min = Min(aabb.min, boxes[order[i]].min);
+				aabb.max = Max(aabb.max, boxes[order[i]].max);
+			}
+
+			auto& n = bvh.nodes[node];
+			n.min[0] = aabb.min.x; n.min[1] = aabb.min.y; n.min[2] = aabb.min.z;
+			n.max[0] = aabb.max.x; n.max[1] = aabb.max.y; n.max[2] = aabb.max.z;
+		}
+
+		static float HalfArea(const AABB& aabb) noexcept
+		{
+			const float3 e = aabb.Extents();
+			return aabb.Empty() ? 0.0f : e.x * e.y + e.y * e.z + e.z * e.x;
+		}
+
+		// Returns the split position in [first, first + count), or 0 to make a leaf
+		uint32_t SplitSAH(const uint32_t node, const uint32_t first, const uint32_t count) noexcept
+		{
+			AABB centroidBounds;
+			for (uint32_t i = first; i < first + count; i++)
+			{
+				centroidBounds.min = Min(centroidBounds.min, centroids[order[i]]);
+				centroidBounds.max = Max(centroidBounds.max, centroids[order[i]]);
+			}
+
+			const auto&  n          = bvh.nodes[node];
+			const float  leafCost   = float(count) * HalfArea({ { n.min[0], n.min[1], n.min[2] }, { n.max[0], n.max[1], n.max[2] } });
+			float        bestCost   = FLT_MAX;
+			int          bestAxis   = -1;
+			uint32_t     bestBin    = 0;
+
+			auto Axis = [](const float3 v, const int axis) { return axis == 0 ? v.x : axis == 1 ? v.y : v.z; };
+
+			for (int axis = 0; axis < 3; axis++)
+			{
+				const float lo      = Axis(centroidBounds.min, axis);
+				const float extent  = Axis(centroidBounds.max, axis) - lo;
+
+				if (extent <= 0.0f)
+					continue;
+
+				AABB        bins[binCount];
+				uint32_t    counts[binCount] = {};
+				const float scale = binCount / extent;
+
+				for (uint32_t i = first; i < first + count; i++)
+				{
+					const uint32_t t = order[i];
+					const uint32_t b = std::min(binCount - 1, uint32_t((Axis(centroids[t], axis) - lo) * scale));
+
+					bins[b].min = Min(bins[b].min, boxes[t].min);
+					bins[b].max = Max(bins[b].max, boxes[t].max);
+					counts[b]++;
+				}
+
+				float       rightArea[binCount];
+				uint32_t    rightCount[binCount];
+				AABB        accum;
+				uint32_t    accumCount = 0;
+
+				for (uint32_t b = binCount - 1; b > 0; b--)
+				{
+					accum.min = Min(accum.min, bins[b].min);
+					accum.max = Max(accum.max, bins[b].max);
+					accumCount += counts[b];
+
+					rightArea[b]    = HalfArea(accum);
+					rightCount[b]   = accumCount;
+				}
+
+				accum       = {};
+				accumCount  = 0;
+
+				for (uint32_t b = 0; b < binCount - 1; b++)
+				{
+					accum.min = Min(accum.min, bins[b].min);
+					accum.max = Max(accum.max, bins[b].max);
+					accumCount += counts[b];
+
+					const float cost = HalfArea(accum) * accumCount + rightArea[b + 1] * rightCount[b + 1];
+
+					if (accumCount && rightCount[b + 1] && cost < bestCost)
+					{
+						bestCost    = cost;
+						bestAxis    = axis;
+						bestBin     = b;
+					}
+				}
+			}
+
+			if (bestAxis < 0 || (bestCost >= leafCost && count <= 4 * maxLeafSize))
+				return count > maxLeafSize * 4 ? first + count / 2 : 0;
+
+			const float lo      = Axis(centroidBounds.min, bestAxis);
+			const float scale   = binCount / (Axis(centroidBounds.max, bestAxis) - lo);
+
+			const auto mid = std::partition(order.begin() + first, order.begin() + first + count,
+				[&](uint32_t t) { return std::min(binCount - 1, uint32_t((Axis(centroids[t], bestAxis) - lo) * scale)) <= bestBin; });
+
+			return uint32_t(mid - order.begin());
+		}
+
+		// Split at the highest bit where the first and last Morton codes differ
+		uint32_t SplitMorton(const uint32_t first, const uint32_t count) const noexcept
+		{
+			const uint32_t lastIdx  = first + count - 1;
+			const uint32_t a        = mortonCodes[first];
+			const uint32_t b        = mortonCodes[lastIdx];
+
+			if (a == b)
+				return first + count / 2;
+
+			const uint32_t prefix = uint32_t(std::countl_zero(a ^ b));
+
+			uint32_t split  = first;
+			uint32_t step   = count - 1;
+
+			do
+			{
+				step = (step + 1) >> 1;
+				const uint32_t candidate = split + step;
+
+				if (candidate < lastIdx && uint32_t(std::countl_zero(a ^ mortonCodes[candidate])) > prefix)
+					split = candidate;
+			} while (step > 1);
+
+			return split + 1;
+		}
+
+		// Builds the subtree serially, or hands the children back when tasks is provided
+		void BuildNode(const Task task, std::vector<Task>* tasks)
+		{
+			SetBounds(task.node, task.first, task.count);
+
+			auto& node = bvh.nodes[task.node];
+
+			uint32_t split = 0;
+
+			// Duplicate Morton codes or a lopsided SAH split can chain deeper than the
+			// traversal stack, such subtrees end in one larger leaf instead
+			if (task.count > maxLeafSize && task.depth + 1 < maxDepth)
+				split = mode == BVHBuildMode::SAH ? SplitSAH(task.node, task.first, task.count) : SplitMorton(task.first, task.count);
+
+			if (split <= task.first || split >= task.first + task.count)
+			{
+				node.leftOrFirst    = task.first;
+				node.count          = task.count;
+
+				uint32_t deepest = depth;
+				while (deepest < task.depth + 1 && !depth.compare_exchange_weak(deepest, task.depth + 1));
+
+				return;
+			}
+
+			const uint32_t left = nextNode.fetch_add(2);
+
+			node.leftOrFirst    = left;
+			node.count          = 0;
+
+			const Task children[2] = {
+				{ left,     task.first, split - task.first,                 task.depth + 1 },
+				{ left + 1, split,      task.first + task.count - split,    task.depth + 1 },
+			};
+
+			for (const auto& child : children)
+			{
+				if (tasks)
+					tasks->push_back(child);
+				else
+					BuildNode(child, nullptr);
+			}
+		}
+
+		// Top levels are split serially until there is enough work to spread across the pool
+		void Build(ThreadPool& threads)
+		{
+			const uint32_t count = uint32_t(order.size());
+
+			if (!count)
+			{
+				bvh.nodes[0] = {};
+				bvh.depth    = 1;
+				return;
+			}
+
+			const uint32_t threshold = std::max<uint32_t>(1024, count / uint32_t(8 * threads.ThreadCount()));
+
+			std::vector<Task> pending{ { 0, 0, count, 0 } };
+			std::vector<Task> parallel;
+
+			while (!pending.empty())
+			{
+				const Task task = pending.back();
+				pending.pop_back();
+
+				if (task.count <= threshold)
+				{
+					parallel.push_back(task);
+					continue;
+				}
+
+				BuildNode(task, &pending);
+			}
+
+			threads.ParallelFor(parallel.size(), 1,
+				[&](size_t begin, size_t end)
+				{
+					for (size_t i = begin; i < end; i++)
+						BuildNode(parallel[i], nullptr);
+				});
+
+			bvh.nodeCount   = nextNode;
+			bvh.depth       = depth;
+		}
+	};
+
+	std::vector<BVHNode>            nodes;
+	std::vector<Triangle>           triangles;
+	std::vector<TriangleReference>  references;
+	size_t                          nodeCount   = 0;
+	size_t                          depth       = 0;    // levels, a lone root leaf is 1
+};
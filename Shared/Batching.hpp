@@ -0,0 +1,123 @@
+#pragma once
+
+#include "Bounds.hpp"
+#include "MergedGeometry.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Regroups faces of every shape by material into one index buffer, each material
+// becomes a single contiguous range drawn with base vertex 0. Faces keep their shape
+// and face order within a material, so the locality from the spatial sort survives.
+
+struct MaterialBatch
+{
+	int32_t     material    = -1;   // -1 for faces without a material
+	uint32_t    startIndex  = 0;
+	uint32_t    indexCount  = 0;
+};
+
+struct MaterialBatches
+{
+	std::vector<uint32_t>       indices;    // into MergedGeometry::positions, not shape local
+	std::vector<MaterialBatch>  batches;    // ascending material
+	uint32_t                    maxIndex = 0;
+
+	bool Fits16BitIndices() const noexcept { return maxIndex < 0x10000; }
+
+	std::vector<uint16_t> Indices16() const
+	{
+		return { indices.begin(), indices.end() };
+	}
+
+	std::vector<IndexedRange> Ranges() const
+	{
+		std::vector<IndexedRange> out;
+		for (const auto& batch : batches)
+			out.push_back({ batch.startIndex, batch.indexCount, 0 });
+
+		return out;
+	}
+};
+
+// faceMaterials[shape] has one material per face of the shape's range at level
+inline MaterialBatches BatchByMaterial(const MergedGeometry& geometry, const std::span<const std::span<const int>> faceMaterials, const size_t level = 0)
+{
+	MaterialBatches out;
+
+	std::vector<int32_t> materials;
+	for (const auto faces : faceMaterials)
+		materials.insert(materials.end(), faces.begin(), faces.end());
+
+	std::sort(materials.begin(), materials.end());
+	materials.erase(std::unique(materials.begin(), materials.end()), materials.end());
+
+	auto Slot = [&](const int material)
+	{
+		return size_t(std::lower_bound(materials.begin(), materials.end(), material) - materials.begin());
+	};
+
+	// Counting sort of the faces by material
+	std::vector<uint32_t> cursor(materials.size(), 0);
+
+	for (size_t s = 0; s < geometry.shapes.size() && s < faceMaterials.size(); s++)
+	{
+		const size_t faceCount = std::min<size_t>(faceMaterials[s].size(), geometry.shapes[s].ranges[level].indexCount / 3);
+
+		for (size_t face = 0; face < faceCount; face++)
+			cursor[Slot(faceMaterials[s][face])] += 3;
+	}
+
+	uint32_t start = 0;
+	for (size_t m = 0; m < materials.size(); m++)
+	{
+		out.batches.push_back({ materials[m], start, cursor[m] });
+
+		const uint32_t count = cursor[m];
+		cursor[m]   = start;
+		start       += count;
+	}
+
+	out.indices.resize(start);
+
+	for (size_t s = 0; s < geometry.shapes.size() && s < faceMaterials.size(); s++)
+	{
+		const auto&     shape       = geometry.shapes[s];
+		const auto&     range       = shape.ranges[level];
+		const size_t    faceCount   = std::min<size_t>(faceMaterials[s].size(), range.indexCount / 3);
+
+		for (size_t face = 0; face < faceCount; face++)
+		{
+			uint32_t& dst = cursor[Slot(faceMaterials[s][face])];
+
+			for (size_t corner = 0; corner < 3; corner++)
+			{
+				const uint32_t index = geometry.indices[range.startIndex + 3 * face + corner] + uint32_t(shape.baseVertex);
+
+				out.indices[dst++]  = index;
+				out.maxIndex        = std::max(out.maxIndex, index);
+			}
+		}
+	}
+
+	out.batches.erase(std::remove_if(out.batches.begin(), out.batches.end(), [](const MaterialBatch& b) { return b.indexCount == 0; }), out.batches.end());
+
+	return out;
+}
+
+// Draws per frame with one draw per run of faces sharing a material within a shape,
+// which is what drawing every shape with correct materials costs without batching
+inline size_t CountMaterialRuns(const std::span<const std::span<const int>> faceMaterials) noexcept
+{
+	size_t runs = 0;
+
+	for (const auto faces : faceMaterials)
+	{
+		for (size_t face = 0; face < faces.size(); face++)
+			runs += face == 0 || faces[face] != faces[face - 1];
+	}
+
+	return runs;
+}
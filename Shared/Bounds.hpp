@@ -0,0 +1,368 @@
+#pragma once
+
+#include "Geometry.hpp"
+#include "SIMD.hpp"
+#include "Threading.hpp"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Structure of arrays bounding volumes, one row per shape or sub-mesh
+struct BoundsTable
+{
+	std::vector<float> minX, minY, minZ;
+	std::vector<float> maxX, maxY, maxZ;
+	std::vector<float> centerX, centerY, centerZ, radius;
+
+	size_t Size() const noexcept { return radius.size(); }
+
+	void Resize(const size_t size)
+	{
+		for (auto* column : { &minX, &minY, &minZ, &maxX, &maxY, &maxZ, &centerX, &centerY, &centerZ, &radius })
+			column->resize(size);
+	}
+
+	AABB GetAABB(const size_t i) const noexcept
+	{
+		return { { minX[i], minY[i], minZ[i] }, { maxX[i], maxY[i], maxZ[i] } };
+	}
+
+	BoundingSphere GetSphere(const size_t i) const noexcept
+	{
+		return { { centerX[i], centerY[i], centerZ[i] }, radius[i] };
+	}
+
+	void SetAABB(const size_t i, const AABB& aabb) noexcept
+	{
+		minX[i] = aabb.min.x; minY[i] = aabb.min.y; minZ[i] = aabb.min.z;
+		maxX[i] = aabb.max.x; maxY[i] = aabb.max.y; maxZ[i] = aabb.max.z;
+	}
+
+	void SetSphere(const size_t i, const BoundingSphere& sphere) noexcept
+	{
+		centerX[i]  = sphere.center.x;
+		centerY[i]  = sphere.center.y;
+		centerZ[i]  = sphere.center.z;
+		radius[i]   = sphere.radius;
+	}
+};
+
+// Contiguous vertices, e.g. a MergedShape
+struct VertexRange
+{
+	uint32_t firstVertex    = 0;
+	uint32_t vertexCount    = 0;
+};
+
+// Indexed subset of a vertex range, e.g. one material's faces of a shape
+struct IndexedRange
+{
+	uint32_t    startIndex  = 0;
+	uint32_t    indexCount  = 0;
+	int32_t     baseVertex  = 0;
+};
+
+namespace BoundsDetail
+{
+	constexpr size_t chunkSize = 16 * 1024;
+
+	// Scalar reference kernels. IDX maps [begin, end) to vertex indices.
+	template<typename IDX>
+	AABB AccumulateAABB(const float* positions, const size_t begin, const size_t end, IDX&& index) noexcept
+	{
+		AABB aabb;
+
+		for (size_t i = begin; i < end; i++)
+		{
+			const float3 p = LoadFloat3(positions + 3 * size_t(index(i)));
+			aabb.min = Min(aabb.min, p);
+			aabb.max = Max(aabb.max, p);
+		}
+
+		return aabb;
+	}
+
+	template<typename IDX>
+	float AccumulateRadiusSq(const float* positions, const size_t begin, const size_t end, const float3 center, IDX&& index) noexcept
+	{
+		float r = 0.0f;
+
+		for (size_t i = begin; i < end; i++)
+		{
+			const float3 d = LoadFloat3(positions + 3 * size_t(index(i))) - center;
+			r = std::max(r, Dot(d, d));
+		}
+
+		return r;
+	}
+
+	// Eight xyz triplets (24 floats) per iteration. Register lanes repeat the x y z pattern
+	// with a period of three registers, so they are reduced per component at the end.
+	SIMD_TARGET_AVX2 inline AABB AccumulateAABBContiguousAVX2(const float* positions, const size_t begin, const size_t end) noexcept
+	{
+		__m256 lo[3], hi[3];
+
+		for (size_t k = 0; k < 3; k++)
+		{
+			lo[k] = _mm256_set1_ps( FLT_MAX);
+			hi[k] = _mm256_set1_ps(-FLT_MAX);
+		}
+
+		size_t i = begin;
+		for (; i + 8 <= end; i += 8)
+		{
+			const float* p = positions + 3 * i;
+
+			for (size_t k = 0; k < 3; k++)
+			{
+				const __m256 v = _mm256_loadu_ps(p + 8 * k);
+				lo[k] = _mm256_min_ps(lo[k], v);
+				hi[k] = _mm256_max_ps(hi[k], v);
+			}
+		}
+
+		alignas(32) float minLanes[24];
+		alignas(32) float maxLanes[24];
+
+		for (size_t k = 0; k < 3; k++)
+		{
+			_mm256_store_ps(minLanes + 8 * k, lo[k]);
+			_mm256_store_ps(maxLanes + 8 * k, hi[k]);
+		}
+
+		float mins[3] = {  FLT_MAX,  FLT_MAX,  FLT_MAX };
+		float maxs[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		for (size_t l = 0; l < 24; l++)
+		{
+			mins[l % 3] = std::min(mins[l % 3], minLanes[l]);
+			maxs[l % 3] = std::max(maxs[l % 3], maxLanes[l]);
+		}
+
+		const AABB tail = AccumulateAABB(positions, i, end, [](size_t v) { return v; });
+
+		return {
+			Min({ mins[0], mins[1], mins[2] }, tail.min),
+			Max({ maxs[0], maxs[1], maxs[2] }, tail.max) };
+	}
+
+	SIMD_TARGET_AVX2 inline void Gather8(const float* positions, const __m256i vertex, __m256& x, __m256& y, __m256& z) noexcept
+	{
+		const __m256i offset = _mm256_mullo_epi32(vertex, _mm256_set1_epi32(3));
+
+		x = _mm256_i32gather_ps(positions + 0, offset, 4);
+		y = _mm256_i32gather_ps(positions + 1, offset, 4);
+		z = _mm256_i32gather_ps(positions + 2, offset, 4);
+	}
+
+	SIMD_TARGET_AVX2 inline AABB AccumulateAABBIndexedAVX2(const float* positions, const uint32_t* indices, const int32_t baseVertex, const size_t begin, const size_t end) noexcept
+	{
+		__m256 lo[3] = { _mm256_set1_ps(FLT_MAX), _mm256_set1_ps(FLT_MAX), _mm256_set1_ps(FLT_MAX) };
+		__m256 hi[3] = { _mm256_set1_ps(-FLT_MAX), _mm256_set1_ps(-FLT_MAX), _mm256_set1_ps(-FLT_MAX) };
+
+		const __m256i base = _mm256_set1_epi32(baseVertex);
+
+		size_t i = begin;
+		for (; i + 8 <= end; i += 8)
+		{
+			__m256 p[3];
+			Gather8(positions, _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(indices + i)), base), p[0], p[1], p[2]);
+
+			for (size_t k = 0; k < 3; k++)
+			{
+				lo[k] = _mm256_min_ps(lo[k], p[k]);
+				hi[k] = _mm256_max_ps(hi[k], p[k]);
+			}
+		}
+
+		alignas(32) float lanes[8];
+		AABB aabb = AccumulateAABB(positions, i, end, [&](size_t v) { return indices[v] + baseVertex; });
+		float* mins[3] = { &aabb.min.x, &aabb.min.y, &aabb.min.z };
+		float* maxs[3] = { &aabb.max.x, &aabb.max.y, &aabb.max.z };
+
+		for (size_t k = 0; k < 3; k++)
+		{
+			_mm256_store_ps(lanes, lo[k]);
+			for (const float l : lanes)
+				*mins[k] = std::min(*mins[k], l);
+
+			_mm256_store_ps(lanes, hi[k]);
+			for (const float l : lanes)
+				*maxs[k] = std::max(*maxs[k], l);
+		}
+
+		return aabb;
+	}
+
+	// vertexBase + i for contiguous ranges, indices[i] + vertexBase for indexed ones
+	SIMD_TARGET_AVX2 inline float AccumulateRadiusSqAVX2(const float* positions, const uint32_t* indices, const int32_t vertexBase, const size_t begin, const size_t end, const float3 center) noexcept
+	{
+		const __m256    cx      = _mm256_set1_ps(center.x);
+		const __m256    cy      = _mm256_set1_ps(center.y);
+		const __m256    cz      = _mm256_set1_ps(center.z);
+		const __m256i   base    = _mm256_set1_epi32(vertexBase);
+		const __m256i   iota    = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+		__m256 r = _mm256_setzero_ps();
+
+		size_t i = begin;
+		for (; i + 8 <= end; i += 8)
+		{
+			const __m256i vertex = indices ?
+				_mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(indices + i)), base) :
+				_mm256_add_epi32(_mm256_add_epi32(_mm256_set1_epi32(int32_t(i)), iota), base);
+
+			__m256 x, y, z;
+			Gather8(positions, vertex, x, y, z);
+
+			x = _mm256_sub_ps(x, cx);
+			y = _mm256_sub_ps(y, cy);
+			z = _mm256_sub_ps(z, cz);
+
+			r = _mm256_max_ps(r, _mm256_fmadd_ps(x, x, _mm256_fmadd_ps(y, y, _mm256_mul_ps(z, z))));
+		}
+
+		alignas(32) float lanes[8];
+		_mm256_store_ps(lanes, r);
+
+		float result = indices ?
+			AccumulateRadiusSq(positions, i, end, center, [&](size_t v) { return indices[v] + vertexBase; }) :
+			AccumulateRadiusSq(positions, i, end, center, [&](size_t v) { return v + vertexBase; });
+
+		for (const float l : lanes)
+			result = std::max(result, l);
+
+		return result;
+	}
+
+	struct Job
+	{
+		uint32_t    row;
+		size_t      begin;
+		size_t      end;
+	};
+
+	// Splits every row into chunks so one large shape still spreads across threads
+	template<typename COUNT>
+	std::vector<Job> MakeJobs(const size_t rows, COUNT&& count)
+	{
+		std::vector<Job> jobs;
+
+		for (size_t row = 0; row < rows; row++)
+		{
+			const size_t n = count(row);
+
+			for (size_t begin = 0; begin < n; begin += chunkSize)
+				jobs.push_back({ uint32_t(row), begin, std::min(n, begin + chunkSize) });
+		}
+
+		return jobs;
+	}
+
+	// AABB pass then radius pass around the box center, partial results merged per row
+	template<typename AABB_FN, typename RADIUS_FN>
+	void ComputeBounds(ThreadPool& threads, const std::vector<Job>& jobs, BoundsTable& out, AABB_FN&& aabbKernel, RADIUS_FN&& radiusKernel)
+	{
+		std::vector<AABB> partialAABB(jobs.size());
+		threads.ParallelFor(jobs.size(), 4,
+			[&](size_t begin, size_t end)
+			{
+				for (size_t j = begin; j < end; j++)
+					partialAABB[j] = aabbKernel(jobs[j]);
+			});
+
+		std::vector<AABB> aabbs(out.Size());
+		for (size_t j = 0; j < jobs.size(); j++)
+		{
+			auto& aabb = aabbs[jobs[j].row];
+			aabb.min = Min(aabb.min, partialAABB[j].min);
+			aabb.max = Max(aabb.max, partialAABB[j].max);
+		}
+
+		std::vector<float> partialRadius(jobs.size());
+		threads.ParallelFor(jobs.size(), 4,
+			[&](size_t begin, size_t end)
+			{
+				for (size_t j = begin; j < end; j++)
+					partialRadius[j] = radiusKernel(jobs[j], aabbs[jobs[j].row].Center());
+			});
+
+		std::vector<float> radiusSq(out.Size(), 0.0f);
+		for (size_t j = 0; j < jobs.size(); j++)
+			radiusSq[jobs[j].row] = std::max(radiusSq[jobs[j].row], partialRadius[j]);
+
+		for (size_t row = 0; row < out.Size(); row++)
+		{
+			if (aabbs[row].Empty())
+				aabbs[row] = AABB{ {}, {} };
+
+			out.SetAABB(row, aabbs[row]);
+			out.SetSphere(row, { aabbs[row].Center(), std::sqrt(radiusSq[row]) });
+		}
+	}
+}
+
+inline BoundsTable ComputeBounds(ThreadPool& threads, const float* positions, const std::span<const VertexRange> ranges)
+{
+	using namespace BoundsDetail;
+
+	BoundsTable out;
+	out.Resize(ranges.size());
+
+	const bool avx2 = HasAVX2();
+	const auto jobs = MakeJobs(ranges.size(), [&](size_t row) { return ranges[row].vertexCount; });
+
+	ComputeBounds(threads, jobs, out,
+		[&](const Job& job)
+		{
+			const size_t first = ranges[job.row].firstVertex;
+
+			return avx2 ?
+				AccumulateAABBContiguousAVX2(positions, first + job.begin, first + job.end) :
+				AccumulateAABB(positions, first + job.begin, first + job.end, [](size_t v) { return v; });
+		},
+		[&](const Job& job, const float3 center)
+		{
+			const int32_t first = int32_t(ranges[job.row].firstVertex);
+
+			return avx2 ?
+				AccumulateRadiusSqAVX2(positions, nullptr, first, job.begin, job.end, center) :
+				AccumulateRadiusSq(positions, job.begin, job.end, center, [&](size_t v) { return v + first; });
+		});
+
+	return out;
+}
+
+inline BoundsTable ComputeBounds(ThreadPool& threads, const float* positions, const uint32_t* indices, const std::span<const IndexedRange> ranges)
+{
+	using namespace BoundsDetail;
+
+	BoundsTable out;
+	out.Resize(ranges.size());
+
+	const bool avx2 = HasAVX2();
+	const auto jobs = MakeJobs(ranges.size(), [&](size_t row) { return ranges[row].indexCount; });
+
+	ComputeBounds(threads, jobs, out,
+		[&](const Job& job)
+		{
+			const auto&     range   = ranges[job.row];
+			const uint32_t* local   = indices + range.startIndex;
+
+			return avx2 ?
+				AccumulateAABBIndexedAVX2(positions, local, range.baseVertex, job.begin, job.end) :
+				AccumulateAABB(positions, job.begin, job.end, [&](size_t v) { return local[v] + range.baseVertex; });
+		},
+		[&](const Job& job, const float3 center)
+		{
+			const auto&     range   = ranges[job.row];
+			const uint32_t* local   = indices + range.startIndex;
+
+			return avx2 ?
+				AccumulateRadiusSqAVX2(positions, local, range.baseVertex, job.begin, job.end, center) :
+				AccumulateRadiusSq(positions, job.begin, job.end, center, [&](size_t v) { return local[v] + range.baseVertex; });
+		});
+
+	return out;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "RadixSort.hpp"
+#include "Threading.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+// Draws recorded as POD packets with a 64 bit sort key, sorted and replayed later.
+// Packets refer to pipeline and geometry state by index into tables the replay gets,
+// so recording and sorting never touch the API. The D3D11 replay is in D3D11Commands.hpp.
+
+struct DrawPacket
+{
+	uint16_t    pipeline        = 0;
+	uint16_t    geometry        = 0;
+	uint32_t    count           = 0;    // indices, or vertices without an index buffer
+	uint32_t    start           = 0;
+	int32_t     baseVertex      = 0;
+	uint32_t    instanceCount   = 0;    // 0 draws without instancing
+	uint32_t    startInstance   = 0;
+};
+
+// pass 4 bits | pipeline 12 | material 16 | depth 32, ascending. A pipeline is a shader
+// set with its input layout and nothing else, so it is the shader field and a separate
+// one would repeat it. Depth is the float bit pattern, which orders non negative values,
+// so near draws come first within a material.
+inline uint64_t MakeSortKey(const uint32_t pass, const uint32_t pipeline, const uint32_t material, const float depth) noexcept
+{
+	const float positive = depth > 0.0f ? depth : 0.0f;
+
+	uint32_t depthBits;
+	std::memcpy(&depthBits, &positive, sizeof(depthBits));
+
+	return
+		uint64_t(pass & 0xf) << 60 |
+		uint64_t(pipeline & 0xfff) << 48 |
+		uint64_t(material & 0xffff) << 32 |
+		depthBits;
+}
+
+class CommandBuffer
+{
+public:
+	void Clear() noexcept
+	{
+		keys.clear();
+		packets.clear();
+		order.clear();
+	}
+
+	void Reserve(const size_t count)
+	{
+		keys.reserve(count);
+		packets.reserve(count);
+		order.reserve(count);
+	}
+
+	void Draw(const uint64_t key, const DrawPacket& packet)
+	{
+		keys.push_back(key);
+		packets.push_back(packet);
+	}
+
+	// Appends the parts in order, each copied by its own task at its prefix offset
+	void Append(ThreadPool& threads, const std::span<const CommandBuffer> parts)
+	{
+		std::vector<size_t> offsets(parts.size() + 1, packets.size());
+		for (size_t i = 0; i < parts.size(); i++)
+			offsets[i + 1] = offsets[i] + parts[i].Size();
+
+		keys.resize(offsets.back());
+		packets.resize(offsets.back());
+
+		threads.ParallelFor(parts.size(), 1,
+			[&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					std::copy(parts[i].keys.begin(), parts[i].keys.end(), keys.begin() + offsets[i]);
+					std::copy(parts[i].packets.begin(), parts[i].packets.end(), packets.begin() + offsets[i]);
+				}
+			});
+	}
+
+	// Stable, packets with equal keys replay in recording order. Sorts the keys in
+	// place, record the next frame after Clear.
+	void Sort(ThreadPool& threads)
+	{
+		order.resize(packets.size());
+		for (uint32_t i = 0; i < order.size(); i++)
+			order[i] = i;
+
+		RadixSort(threads, keys, order);
+	}
+
+	// Packets [begin, end) of the replay order, call Sort first
+	template<typename FN>
+	void ForEach(FN&& fn, const size_t begin = 0, const size_t end = SIZE_MAX) const
+	{
+		for (size_t i = begin; i < std::min(end, order.size()); i++)
+			fn(packets[order[i]]);
+	}
+
+	size_t Size() const noexcept { return packets.size(); }
+
+private:
+	std::vector<uint64_t>   keys;
+	std::vector<DrawPacket> packets;
+	std::vector<uint32_t>   order;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "UploadRing.hpp"
+
+#include <d3d11_1.h>
+
+// One large dynamic constant buffer handed out in 256 byte slices, written with
+// MAP_WRITE_NO_OVERWRITE and bound with *SetConstantBuffers1 offsets, so per draw
+// constants cost neither a discard per update nor a buffer per draw. An UploadRing
+// underneath reclaims slices per frame once the frame's fence passed.
+
+struct ConstantSlice
+{
+	ID3D11Buffer*   buffer          = nullptr;
+	UINT            firstConstant   = 0;    // in 16 byte constants, as *SetConstantBuffers1 takes them
+	UINT            constantCount   = 0;    // multiple of 16
+
+	explicit operator bool () const noexcept { return buffer != nullptr; }
+};
+
+// Binds the slice to slot of the vertex, geometry and pixel stage
+inline void BindConstants(ID3D11DeviceContext1* context, const UINT slot, const ConstantSlice& slice)
+{
+	context->VSSetConstantBuffers1(slot, 1, &slice.buffer, &slice.firstConstant, &slice.constantCount);
+	context->GSSetConstantBuffers1(slot, 1, &slice.buffer, &slice.firstConstant, &slice.constantCount);
+	context->PSSetConstantBuffers1(slot, 1, &slice.buffer, &slice.firstConstant, &slice.constantCount);
+}
+
+class ConstantRing
+{
+public:
+	static constexpr size_t sliceAlignment = 256;   // 16 constants, the offset granularity of D3D11.1
+
+	// False without constant buffer offsets or no overwrite maps, keep UpdateDiscard then
+	bool Create(ID3D11Device* device, const size_t capacity)
+	{
+		D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+
+		if (FAILED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) ||
+			!options.ConstantBufferOffsetting || !options.MapNoOverwriteOnDynamicConstantBuffer)
+			return false;
+
+		return ring.Create(device, capacity, D3D11_BIND_FLAG::D3D11_BIND_CONSTANT_BUFFER, sliceAlignment);
+	}
+
+	ConstantSlice Write(ID3D11DeviceContext* context, const void* data, const size_t size)
+	{
+		const UploadSlice slice = ring.Write(context, data, size);
+
+		if (!slice)
+			return {};
+
+		return { slice.buffer, slice.offset / 16, UINT(ring.Allocator().AlignUp(size) / 16) };
+	}
+
+	template<typename TY>
+	ConstantSlice Write(ID3D11DeviceContext* context, const TY& values)
+	{
+		return Write(context, &values, sizeof(values));
+	}
+
+	// Fences the slices written this frame and reclaims those of frames the GPU finished
+	void EndFrame(ID3D11DeviceContext* context)
+	{
+		ring.EndFrame(context);
+	}
+
+	const RingAllocator& Allocator() const noexcept { return ring.Allocator(); }
+
+private:
+	UploadRing ring;
+};
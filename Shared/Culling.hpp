@@ -0,0 +1,164 @@
+#pragma once
+
+#include "Bounds.hpp"
+#include "Geometry.hpp"
+#include "SIMD.hpp"
+#include "Threading.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+namespace CullingDetail
+{
+	constexpr size_t chunkSize = 4096;
+
+	// Box is outside once its most positive corner along a plane normal is behind the plane
+	inline bool IsVisible(const Frustum& frustum, const BoundsTable& bounds, const size_t i) noexcept
+	{
+		const AABB   aabb       = bounds.GetAABB(i);
+		const float3 center     = aabb.Center();
+		const float3 extents    = aabb.Extents() * 0.5f;
+
+		for (const auto& plane : frustum.planes)
+		{
+			const float3 absN = { std::abs(plane.n.x), std::abs(plane.n.y), std::abs(plane.n.z) };
+
+			if (Dot(plane.n, center) + Dot(absN, extents) + plane.d < 0.0f)
+				return false;
+		}
+
+		return true;
+	}
+
+	inline size_t CullScalar(const Frustum& frustum, const BoundsTable& bounds, const size_t begin, const size_t end, uint32_t* visible) noexcept
+	{
+		size_t count = 0;
+
+		for (size_t i = begin; i < end; i++)
+		{
+			if (IsVisible(frustum, bounds, i))
+				visible[count++] = uint32_t(i);
+		}
+
+		return count;
+	}
+
+	// Eight boxes per iteration straight from the table's columns
+	SIMD_TARGET_AVX2 inline size_t CullAVX2(const Frustum& frustum, const BoundsTable& bounds, const size_t begin, const size_t end, uint32_t* visible) noexcept
+	{
+		const __m256 half = _mm256_set1_ps(0.5f);
+
+		__m256 nx[6], ny[6], nz[6], ax[6], ay[6], az[6], d[6];
+
+		for (size_t p = 0; p < 6; p++)
+		{
+			const Plane& plane = frustum.planes[p];
+
+			nx[p] = _mm256_set1_ps(plane.n.x);
+			ny[p] = _mm256_set1_ps(plane.n.y);
+			nz[p] = _mm256_set1_ps(plane.n.z);
+			ax[p] = _mm256_set1_ps(std::abs(plane.n.x));
+			ay[p] = _mm256_set1_ps(std::abs(plane.n.y));
+			az[p] = _mm256_set1_ps(std::abs(plane.n.z));
+			d[p]  = _mm256_set1_ps(plane.d);
+		}
+
+		size_t count    = 0;
+		size_t i        = begin;
+
+		for (; i + 8 <= end; i += 8)
+		{
+			const __m256 minX = _mm256_loadu_ps(bounds.minX.data() + i);
+			const __m256 minY = _mm256_loadu_ps(bounds.minY.data() + i);
+			const __m256 minZ = _mm256_loadu_ps(bounds.minZ.data() + i);
+			const __m256 maxX = _mm256_loadu_ps(bounds.maxX.data() + i);
+			const __m256 maxY = _mm256_loadu_ps(bounds.maxY.data() + i);
+			const __m256 maxZ = _mm256_loadu_ps(bounds.maxZ.data() + i);
+
+			const __m256 cx = _mm256_mul_ps(_mm256_add_ps(minX, maxX), half);
+			const __m256 cy = _mm256_mul_ps(_mm256_add_ps(minY, maxY), half);
+			const __m256 cz = _mm256_mul_ps(_mm256_add_ps(minZ, maxZ), half);
+			const __m256 ex = _mm256_mul_ps(_mm256_sub_ps(maxX, minX), half);
+			const __m256 ey = _mm256_mul_ps(_mm256_sub_ps(maxY, minY), half);
+			const __m256 ez = _mm256_mul_ps(_mm256_sub_ps(maxZ, minZ), half);
+
+			__m256 outside = _mm256_setzero_ps();
+
+			for (size_t p = 0; p < 6; p++)
+			{
+				__m256 dist = _mm256_fmadd_ps(nx[p], cx, d[p]);
+				dist = _mm256_fmadd_ps(ny[p], cy, dist);
+				dist = _mm256_fmadd_ps(nz[p], cz, dist);
+				dist = _mm256_fmadd_ps(ax[p], ex, dist);
+				dist = _mm256_fmadd_ps(ay[p], ey, dist);
+				dist = _mm256_fmadd_ps(az[p], ez, dist);
+
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(dist, _mm256_setzero_ps(), _CMP_LT_OQ));
+			}
+
+			uint32_t mask = ~uint32_t(_mm256_movemask_ps(outside)) & 0xff;
+
+			while (mask)
+			{
+				const uint32_t bit = uint32_t(std::countr_zero(mask));
+				visible[count++] = uint32_t(i + bit);
+				mask &= mask - 1;
+			}
+		}
+
+		return count + CullScalar(frustum, bounds, i, end, visible + count);
+	}
+
+	inline size_t Cull(const Frustum& frustum, const BoundsTable& bounds, const size_t begin, const size_t end, uint32_t* visible) noexcept
+	{
+		return HasAVX2() ?
+			CullAVX2(frustum, bounds, begin, end, visible) :
+			CullScalar(frustum, bounds, begin, end, visible);
+	}
+}
+
+// Writes the rows of bounds whose AABB intersects the frustum to visible, in ascending
+// order. frustum must be in the same space as the bounds, see Camera::GetFrustum.
+inline void FrustumCull(ThreadPool& threads, const Frustum& frustum, const BoundsTable& bounds, std::vector<uint32_t>& visible)
+{
+	using namespace CullingDetail;
+
+	const size_t rows       = bounds.Size();
+	const size_t chunkCount = (rows + chunkSize - 1) / chunkSize;
+
+	visible.resize(rows);
+
+	if (chunkCount <= 1)
+	{
+		visible.resize(Cull(frustum, bounds, 0, rows, visible.data()));
+		return;
+	}
+
+	// Each chunk compacts into its own slot, then the slots are packed in order
+	std::vector<uint32_t> scratch(rows);
+	std::vector<size_t>   counts(chunkCount);
+
+	threads.ParallelFor(chunkCount, 1,
+		[&](size_t begin, size_t end)
+		{
+			for (size_t chunk = begin; chunk < end; chunk++)
+			{
+				const size_t first = chunk * chunkSize;
+				counts[chunk] = Cull(frustum, bounds, first, std::min(rows, first + chunkSize), scratch.data() + first);
+			}
+		});
+
+	std::vector<size_t> offsets(chunkCount + 1, 0);
+	for (size_t chunk = 0; chunk < chunkCount; chunk++)
+		offsets[chunk + 1] = offsets[chunk] + counts[chunk];
+
+	threads.ParallelFor(chunkCount, 4,
+		[&](size_t begin, size_t end)
+		{
+			for (size_t chunk = begin; chunk < end; chunk++)
+				std::copy_n(scratch.data() + chunk * chunkSize, counts[chunk], visible.data() + offsets[chunk]);
+		});
+
+	visible.resize(offsets.back());
+}
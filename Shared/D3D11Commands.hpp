@@ -0,0 +1,144 @@
+#pragma once
+
+#include "CommandBuffer.hpp"
+#include "D3D11StateCache.hpp"
+#include "Threading.hpp"
+
+#include <d3d11.h>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// The tables DrawPacket indexes and their replay on a D3D11 context, directly or split
+// across deferred contexts
+
+// The shaders and input layout a packet draws with, the sort key's pipeline field
+struct PipelineState
+{
+	ID3D11InputLayout*      inputLayout     = nullptr;
+	ID3D11VertexShader*     vertexShader    = nullptr;
+	ID3D11GeometryShader*   geometryShader  = nullptr;
+	ID3D11PixelShader*      pixelShader     = nullptr;
+};
+
+// Slot 0 mesh vertices, slot 1 per instance data. Without an index buffer draws are not indexed.
+struct GeometryState
+{
+	ID3D11Buffer*   vertexBuffers[2]    = {};
+	UINT            strides[2]          = {};
+	UINT            offsets[2]          = {};
+	ID3D11Buffer*   indexBuffer         = nullptr;
+	DXGI_FORMAT     indexFormat         = DXGI_FORMAT_R32_UINT;
+};
+
+// Binds each packet's pipeline and geometry through the state cache, which drops what a
+// sorted stream keeps bound, then issues the matching draw. [begin, end) selects a slice
+// of the replay order.
+inline void Replay(D3D11StateCache& state, const std::span<const PipelineState> pipelines, const std::span<const GeometryState> geometries, const CommandBuffer& commands, const size_t begin = 0, const size_t end = SIZE_MAX)
+{
+	commands.ForEach(
+		[&](const DrawPacket& packet)
+		{
+			const auto& pipeline = pipelines[packet.pipeline];
+			const auto& geometry = geometries[packet.geometry];
+
+			state.IASetInputLayout(pipeline.inputLayout);
+			state.VSSetShader(pipeline.vertexShader, nullptr, 0);
+			state.GSSetShader(pipeline.geometryShader, nullptr, 0);
+			state.PSSetShader(pipeline.pixelShader, nullptr, 0);
+
+			state.IASetVertexBuffers(0, 2, geometry.vertexBuffers, geometry.strides, geometry.offsets);
+
+			if (geometry.indexBuffer)
+			{
+				state.IASetIndexBuffer(geometry.indexBuffer, geometry.indexFormat, 0);
+
+				if (packet.instanceCount)
+					state.DrawIndexedInstanced(packet.count, packet.instanceCount, packet.start, packet.baseVertex, packet.startInstance);
+				else
+					state.DrawIndexed(packet.count, packet.start, packet.baseVertex);
+			}
+			else
+			{
+				if (packet.instanceCount)
+					state.DrawInstanced(packet.count, packet.instanceCount, packet.start, packet.startInstance);
+				else
+					state.Draw(packet.count, packet.start);
+			}
+		}, begin, end);
+}
+
+// Replays a sorted buffer as contiguous slices, one deferred context each, in parallel,
+// then executes the command lists in slice order on the immediate context. Deferred
+// contexts start from default state, Setup(D3D11StateCache&) binds what packets do not carry.
+// Afterwards the immediate context is in default state as well.
+class DeferredReplay
+{
+public:
+	DeferredReplay() = default;
+
+	DeferredReplay(const DeferredReplay&)               = delete;
+	DeferredReplay& operator = (const DeferredReplay&)  = delete;
+
+	~DeferredReplay()
+	{
+		for (auto context : contexts)
+			context->Release();
+	}
+
+	bool Create(ID3D11Device* device, const size_t contextCount)
+	{
+		for (size_t i = contexts.size(); i < contextCount; i++)
+		{
+			ID3D11DeviceContext* context = nullptr;
+
+			if (FAILED(device->CreateDeferredContext(0, &context)))
+				return false;
+
+			contexts.push_back(context);
+		}
+
+		lists.resize(contexts.size());
+
+		return !contexts.empty();
+	}
+
+	template<typename SETUP>
+	void Replay(ThreadPool& threads, ID3D11DeviceContext* immediate, const std::span<const PipelineState> pipelines, const std::span<const GeometryState> geometries, const CommandBuffer& commands, SETUP&& Setup)
+	{
+		const size_t sliceSize = (commands.Size() + contexts.size() - 1) / contexts.size();
+
+		threads.ParallelFor(contexts.size(), 1,
+			[&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					D3D11StateCache state{ contexts[i] };
+					state.ClearState();
+
+					Setup(state);
+					::Replay(state, pipelines, geometries, commands, i * sliceSize, (i + 1) * sliceSize);
+
+					lists[i] = nullptr;
+					contexts[i]->FinishCommandList(FALSE, &lists[i]);
+				}
+			});
+
+		for (auto& list : lists)
+		{
+			if (!list)
+				continue;
+
+			immediate->ExecuteCommandList(list, FALSE);
+			list->Release();
+			list = nullptr;
+		}
+	}
+
+	size_t ContextCount() const noexcept { return contexts.size(); }
+
+private:
+	std::vector<ID3D11DeviceContext*>   contexts;
+	std::vector<ID3D11CommandList*>     lists;
+};
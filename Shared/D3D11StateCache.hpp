@@ -0,0 +1,31 @@
+#pragma once
+
+#include "StateCache.hpp"
+
+#include <d3d11.h>
+
+// StateCache over ID3D11DeviceContext, deferred contexts included
+
+struct D3D11StateTypes
+{
+	using Context           = ID3D11DeviceContext;
+	using Buffer            = ID3D11Buffer;
+	using InputLayout       = ID3D11InputLayout;
+	using VertexShader      = ID3D11VertexShader;
+	using GeometryShader    = ID3D11GeometryShader;
+	using PixelShader       = ID3D11PixelShader;
+	using ClassInstance     = ID3D11ClassInstance;
+	using RenderTargetView  = ID3D11RenderTargetView;
+	using DepthStencilView  = ID3D11DepthStencilView;
+	using Topology          = D3D11_PRIMITIVE_TOPOLOGY;
+	using Format            = DXGI_FORMAT;
+	using Viewport          = D3D11_VIEWPORT;
+	using Rect              = D3D11_RECT;
+
+	static constexpr uint32_t vertexBufferSlots     = D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT;
+	static constexpr uint32_t constantBufferSlots   = D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT;
+	static constexpr uint32_t renderTargetSlots     = D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT;
+	static constexpr uint32_t viewportSlots         = D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE;
+};
+
+using D3D11StateCache = StateCache<D3D11StateTypes>;
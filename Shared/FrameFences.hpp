@@ -0,0 +1,94 @@
+#pragma once
+
+#include <d3d11.h>
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// D3D11 has no fences before 11.3, an event query ended after a frame's work signals
+// when the GPU got past it. Frame numbers ascend, 0 means no frame completed yet.
+class FrameFences
+{
+public:
+	FrameFences() = default;
+
+	FrameFences(const FrameFences&)               = delete;
+	FrameFences& operator = (const FrameFences&)  = delete;
+
+	~FrameFences()
+	{
+		for (auto& fence : pending)
+			fence.query->Release();
+
+		for (auto query : spare)
+			query->Release();
+	}
+
+	bool Signal(ID3D11Device* device, ID3D11DeviceContext* context, const uint64_t frame)
+	{
+		ID3D11Query* query = nullptr;
+
+		if (!spare.empty())
+		{
+			query = spare.back();
+			spare.pop_back();
+		}
+		else
+		{
+			D3D11_QUERY_DESC desc = { D3D11_QUERY_EVENT, 0 };
+
+			if (FAILED(device->CreateQuery(&desc, &query)))
+				return false;
+		}
+
+		context->End(query);
+		pending.push_back({ frame, query });
+
+		return true;
+	}
+
+	// Newest completed frame without waiting
+	uint64_t Poll(ID3D11DeviceContext* context)
+	{
+		while (!pending.empty() && context->GetData(pending.front().query, nullptr, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK)
+			Pop();
+
+		return completed;
+	}
+
+	// Blocks until the oldest frame in flight completed
+	uint64_t WaitOldest(ID3D11DeviceContext* context)
+	{
+		if (pending.empty())
+			return completed;
+
+		while (context->GetData(pending.front().query, nullptr, 0, 0) != S_OK)
+			;
+
+		Pop();
+
+		return completed;
+	}
+
+	size_t      Pending()   const noexcept { return pending.size(); }
+	uint64_t    Completed() const noexcept { return completed; }
+
+private:
+	struct Fence
+	{
+		uint64_t        frame;
+		ID3D11Query*    query;
+	};
+
+	void Pop()
+	{
+		completed = pending.front().frame;
+		spare.push_back(pending.front().query);
+		pending.pop_front();
+	}
+
+	std::deque<Fence>           pending;
+	std::vector<ID3D11Query*>   spare;
+	uint64_t                    completed = 0;
+};
@@ -0,0 +1,321 @@
+#pragma once
+
+#include "TransientTextures.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Passes declare the named resources they read and write. Compile culls passes whose
+// results nobody needs, orders the rest by their dependencies and gives transient
+// textures lifetimes for PlanAliasing. Compiling makes no API calls, Execute realizes
+// the textures through a TransientPool and runs the passes.
+//
+// Writers of a resource run in declaration order and all of them before its readers.
+// Passes writing an imported resource or marked with SideEffect are never culled.
+
+using FrameGraphResource = uint32_t;
+
+template<typename RESOURCE>
+class FrameGraph
+{
+	struct Pass;
+
+public:
+	using PassFunction = std::function<void(const FrameGraph&)>;
+
+	static constexpr uint32_t none = UINT32_MAX;
+
+	class PassBuilder
+	{
+	public:
+		FrameGraphResource Read(const FrameGraphResource resource)     { pass.reads.push_back(resource); return resource; }
+		FrameGraphResource Write(const FrameGraphResource resource)    { pass.writes.push_back(resource); return resource; }
+
+		void SideEffect() noexcept { pass.sideEffect = true; }
+
+	private:
+		friend class FrameGraph;
+
+		explicit PassBuilder(Pass& pass) noexcept : pass{ pass } {}
+
+		Pass& pass;
+	};
+
+	// Clears the declarations and what was compiled from them, handles from before are
+	// no longer valid
+	void Reset()
+	{
+		passes.clear();
+		resources.clear();
+
+		order.clear();
+		requestOf.clear();
+		requests.clear();
+		plan    = {};
+		culled  = 0;
+
+		slotResources.clear();
+	}
+
+	FrameGraphResource CreateTexture(const std::string_view name, const TextureKey& key)
+	{
+		resources.push_back({ std::string{ name }, key, RESOURCE{}, false });
+		return FrameGraphResource(resources.size() - 1);
+	}
+
+	FrameGraphResource Import(const std::string_view name, RESOURCE resource)
+	{
+		resources.push_back({ std::string{ name }, {}, resource, true });
+		return FrameGraphResource(resources.size() - 1);
+	}
+
+	// Setup(PassBuilder&) declares the reads and writes, run is called by Execute
+	template<typename SETUP>
+	void AddPass(const std::string_view name, SETUP&& Setup, PassFunction run)
+	{
+		passes.push_back({ std::string{ name }, {}, {}, std::move(run), false });
+
+		PassBuilder builder{ passes.back() };
+		Setup(builder);
+	}
+
+	// False if the dependencies form a cycle
+	bool Compile()
+	{
+		const size_t passCount      = passes.size();
+		const size_t resourceCount  = resources.size();
+
+		order.clear();
+		requestOf.assign(resourceCount, none);
+		requests.clear();
+		plan    = {};
+		culled  = 0;
+
+		slotResources.clear();
+
+		// Writers and readers per resource, in declaration order
+		writers.assign(resourceCount, {});
+		readers.assign(resourceCount, {});
+
+		for (uint32_t p = 0; p < passCount; p++)
+		{
+			for (const auto r : passes[p].writes)
+				writers[r].push_back(p);
+
+			for (const auto r : passes[p].reads)
+				readers[r].push_back(p);
+		}
+
+		// Culling, everything a root transitively reads from is live
+		live.assign(passCount, 0);
+		std::vector<uint32_t> stack;
+
+		for (uint32_t p = 0; p < passCount; p++)
+		{
+			bool root = passes[p].sideEffect;
+			for (const auto r : passes[p].writes)
+				root |= resources[r].imported;
+
+			if (root)
+			{
+				live[p] = 1;
+				stack.push_back(p);
+			}
+		}
+
+		while (!stack.empty())
+		{
+			const uint32_t p = stack.back();
+			stack.pop_back();
+
+			for (const auto r : passes[p].reads)
+			{
+				for (const uint32_t writer : writers[r])
+				{
+					if (!live[writer])
+					{
+						live[writer] = 1;
+						stack.push_back(writer);
+					}
+				}
+			}
+		}
+
+		// Edges between live passes, writer chains and the last writer to each reader
+		edges.assign(passCount, {});
+		std::vector<uint32_t> incoming(passCount, 0);
+
+		auto Edge = [&](const uint32_t from, const uint32_t to)
+		{
+			if (from == to)
+				return;
+
+			edges[from].push_back(to);
+			incoming[to]++;
+		};
+
+		for (size_t r = 0; r < resourceCount; r++)
+		{
+			uint32_t last = none;
+
+			for (const uint32_t writer : writers[r])
+			{
+				if (!live[writer])
+					continue;
+
+				if (last != none)
+					Edge(last, writer);
+
+				last = writer;
+			}
+
+			if (last == none)
+				continue;
+
+			for (const uint32_t reader : readers[r])
+			{
+				if (live[reader])
+					Edge(last, reader);
+			}
+		}
+
+		// Kahn's algorithm, the lowest declared pass first among the ready ones
+		std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> ready;
+		size_t liveCount = 0;
+
+		for (uint32_t p = 0; p < passCount; p++)
+		{
+			liveCount += live[p];
+
+			if (live[p] && incoming[p] == 0)
+				ready.push(p);
+		}
+
+		while (!ready.empty())
+		{
+			const uint32_t p = ready.top();
+			ready.pop();
+
+			order.push_back(p);
+
+			for (const uint32_t next : edges[p])
+			{
+				if (--incoming[next] == 0)
+					ready.push(next);
+			}
+		}
+
+		culled = passCount - liveCount;
+
+		if (order.size() != liveCount)
+		{
+			order.clear();
+			return false;
+		}
+
+		// Transient lifetimes in execution order
+		for (uint32_t position = 0; position < order.size(); position++)
+		{
+			auto Touch = [&](const FrameGraphResource r)
+			{
+				if (resources[r].imported)
+					return;
+
+				if (requestOf[r] == none)
+				{
+					requestOf[r] = uint32_t(requests.size());
+					requests.push_back({ resources[r].key, position, position });
+				}
+
+				requests[requestOf[r]].lastPass = position;
+			};
+
+			for (const auto r : passes[order[position]].reads)
+				Touch(r);
+
+			for (const auto r : passes[order[position]].writes)
+				Touch(r);
+		}
+
+		plan = PlanAliasing(requests);
+
+		return true;
+	}
+
+	// Runs the compiled passes, transient textures come from the pool
+	template<typename CREATE>
+	void Execute(TransientPool<RESOURCE>& pool, CREATE&& Create)
+	{
+		pool.Acquire(plan, slotResources, Create);
+
+		for (const uint32_t p : order)
+		{
+			if (passes[p].run)
+				passes[p].run(*this);
+		}
+	}
+
+	// Null for transients without a texture, e.g. of culled passes, or before Execute
+	RESOURCE Get(const FrameGraphResource resource) const
+	{
+		if (resource >= resources.size())
+			return RESOURCE{};
+
+		const auto& entry = resources[resource];
+
+		if (entry.imported)
+			return entry.resource;
+
+		if (resource >= requestOf.size() || requestOf[resource] == none || plan.slotOf[requestOf[resource]] >= slotResources.size())
+			return RESOURCE{};
+
+		return slotResources[plan.slotOf[requestOf[resource]]];
+	}
+
+	std::span<const uint32_t>   Order()         const noexcept { return order; }
+	size_t                      PassCount()     const noexcept { return passes.size(); }
+	size_t                      CulledPasses()  const noexcept { return culled; }
+	const AliasingPlan&         Plan()          const noexcept { return plan; }
+
+	const std::string& PassName(const uint32_t pass) const noexcept { return passes[pass].name; }
+
+private:
+	struct Pass
+	{
+		std::string                     name;
+		std::vector<FrameGraphResource> reads;
+		std::vector<FrameGraphResource> writes;
+		PassFunction                    run;
+		bool                            sideEffect = false;
+	};
+
+	struct Resource
+	{
+		std::string name;
+		TextureKey  key;
+		RESOURCE    resource;
+		bool        imported;
+	};
+
+	std::vector<Pass>       passes;
+	std::vector<Resource>   resources;
+
+	// Compiled
+	std::vector<uint32_t>               order;
+	std::vector<uint32_t>               requestOf;      // per resource, none if imported or unused
+	std::vector<TransientRequest>       requests;
+	AliasingPlan                        plan;
+	std::vector<RESOURCE>               slotResources;
+	size_t                              culled = 0;
+
+	// Scratch kept for its capacity
+	std::vector<std::vector<uint32_t>>  writers;
+	std::vector<std::vector<uint32_t>>  readers;
+	std::vector<std::vector<uint32_t>>  edges;
+	std::vector<uint8_t>                live;
+};
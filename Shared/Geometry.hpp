@@ -0,0 +1,235 @@
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Index buffers in this project are wound clockwise (D3D11 default front face),
+// see the index flip in ObjLoader/main.cpp. TriangleNormal follows that convention.
+
+struct float3
+{
+	float x = 0.0f;
+	float y = 0.0f;
+	float z = 0.0f;
+};
+
+inline float3 operator + (const float3 a, const float3 b) noexcept { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+inline float3 operator - (const float3 a, const float3 b) noexcept { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+inline float3 operator * (const float3 a, const float s)   noexcept { return { a.x * s, a.y * s, a.z * s }; }
+inline float3 operator / (const float3 a, const float s)   noexcept { return { a.x / s, a.y / s, a.z / s }; }
+
+inline float3& operator += (float3& a, const float3 b) noexcept { a = a + b; return a; }
+
+inline float Dot(const float3 a, const float3 b) noexcept
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline float3 Cross(const float3 a, const float3 b) noexcept
+{
+	return {
+		a.y * b.z - a.z * b.y,
+		a.z * b.x - a.x * b.z,
+		a.x * b.y - a.y * b.x };
+}
+
+inline float Length(const float3 a) noexcept
+{
+	return std::sqrt(Dot(a, a));
+}
+
+inline float3 Normalize(const float3 a) noexcept
+{
+	const float l = Length(a);
+	return l > 0.0f ? a / l : float3{};
+}
+
+inline float3 Min(const float3 a, const float3 b) noexcept { return { std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z) }; }
+inline float3 Max(const float3 a, const float3 b) noexcept { return { std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z) }; }
+
+inline float3 LoadFloat3(const float* xyz) noexcept
+{
+	return { xyz[0], xyz[1], xyz[2] };
+}
+
+// Unnormalized, length is twice the triangle area
+inline float3 TriangleNormal(const float3 a, const float3 b, const float3 c) noexcept
+{
+	return Cross(c - a, b - a);
+}
+
+struct BoundingSphere
+{
+	float3  center;
+	float   radius = 0.0f;
+};
+
+// Ritter's approximate bounding sphere
+inline BoundingSphere ComputeBoundingSphere(const float3* points, const size_t count) noexcept
+{
+	if (!count)
+		return {};
+
+	auto Farthest = [&](const float3 from)
+	{
+		size_t  idx     = 0;
+		float   best    = -1.0f;
+
+		for (size_t i = 0; i < count; i++)
+		{
+			const float3 d = points[i] - from;
+			const float  l = Dot(d, d);
+
+			if (l > best)
+			{
+				best    = l;
+				idx     = i;
+			}
+		}
+
+		return points[idx];
+	};
+
+	const float3 a = Farthest(points[0]);
+	const float3 b = Farthest(a);
+
+	BoundingSphere sphere;
+	sphere.center = (a + b) * 0.5f;
+	sphere.radius = Length(b - a) * 0.5f;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const float d = Length(points[i] - sphere.center);
+
+		if (d > sphere.radius)
+		{
+			const float r = (sphere.radius + d) * 0.5f;
+			sphere.center = sphere.center + (points[i] - sphere.center) * ((r - sphere.radius) / d);
+			sphere.radius = r;
+		}
+	}
+
+	return sphere;
+}
+
+struct AABB
+{
+	float3 min = {  FLT_MAX,  FLT_MAX,  FLT_MAX };
+	float3 max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+	float3 Center()  const noexcept { return (min + max) * 0.5f; }
+	float3 Extents() const noexcept { return max - min; }
+	bool   Empty()   const noexcept { return min.x > max.x; }
+};
+
+inline AABB ComputeAABB(const float* positions, const size_t count) noexcept
+{
+	AABB aabb;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const float3 p = LoadFloat3(positions + 3 * i);
+		aabb.min = Min(aabb.min, p);
+		aabb.max = Max(aabb.max, p);
+	}
+
+	return aabb;
+}
+
+// Spreads the low 10 bits of v to every third bit
+inline uint32_t ExpandBits10(uint32_t v) noexcept
+{
+	v = (v * 0x00010001u) & 0xFF0000FFu;
+	v = (v * 0x00000101u) & 0x0F00F00Fu;
+	v = (v * 0x00000011u) & 0xC30C30C3u;
+	v = (v * 0x00000005u) & 0x49249249u;
+	return v;
+}
+
+// 30 bit Morton code of p on a 1024^3 grid over bounds
+inline uint32_t MortonCode(const float3 p, const AABB& bounds) noexcept
+{
+	const float3 size = bounds.Extents();
+
+	auto Cell = [](const float x, const float lo, const float extent)
+	{
+		return extent > 0.0f ? uint32_t(std::clamp((x - lo) / extent, 0.0f, 1.0f) * 1023.0f) : 0u;
+	};
+
+	return
+		(ExpandBits10(Cell(p.x, bounds.min.x, size.x)) << 2) |
+		(ExpandBits10(Cell(p.y, bounds.min.y, size.y)) << 1) |
+		(ExpandBits10(Cell(p.z, bounds.min.z, size.z)));
+}
+
+struct Plane
+{
+	float3  n;
+	float   d = 0.0f;
+};
+
+struct Frustum
+{
+	Plane planes[6]; // left, right, bottom, top, near, far. Normals point inwards.
+};
+
+// Expects a row-vector (DirectXMath layout) view-projection, clip = v * m, with D3D [0, w] depth.
+inline Frustum ExtractFrustum(const float (&m)[4][4]) noexcept
+{
+	auto Column = [&](const int c) -> Plane
+	{
+		return { { m[0][c], m[1][c], m[2][c] }, m[3][c] };
+	};
+
+	auto Combine = [](const Plane a, const Plane b, const float s) -> Plane
+	{
+		return { a.n + b.n * s, a.d + b.d * s };
+	};
+
+	const Plane c0 = Column(0);
+	const Plane c1 = Column(1);
+	const Plane c2 = Column(2);
+	const Plane c3 = Column(3);
+
+	Frustum f;
+	f.planes[0] = Combine(c3, c0,  1.0f);
+	f.planes[1] = Combine(c3, c0, -1.0f);
+	f.planes[2] = Combine(c3, c1,  1.0f);
+	f.planes[3] = Combine(c3, c1, -1.0f);
+	f.planes[4] = c2;
+	f.planes[5] = Combine(c3, c2, -1.0f);
+
+	for (auto& plane : f.planes)
+	{
+		const float l = Length(plane.n);
+
+		if (l > 0.0f)
+		{
+			plane.n = plane.n / l;
+			plane.d = plane.d / l;
+		}
+	}
+
+	return f;
+}
+
+inline bool Intersects(const Frustum& f, const BoundingSphere& sphere) noexcept
+{
+	for (const auto& plane : f.planes)
+	{
+		if (Dot(plane.n, sphere.center) + plane.d < -sphere.radius)
+			return false;
+	}
+
+	return true;
+}
+
+struct Ray
+{
+	float3  origin;
+	float3  direction;
+	float   tMax = FLT_MAX;
+};
@@ -0,0 +1,302 @@
+#pragma once
+
+#include "Bounds.hpp"
+#include "Culling.hpp"
+#include "Geometry.hpp"
+#include "Threading.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+// Shapes repeated at different places in the file, e.g. bolts baked into an OBJ, are
+// found by hashing their topology and materials, then confirmed by comparing positions
+// relative to the first vertex. One prototype mesh plus a transform per instance.
+
+// Affine row-major 3x4, p' = rows * (p, 1). Uploaded as three float4 per instance.
+struct InstanceTransform
+{
+	float rows[3][4] = {
+		{ 1.0f, 0.0f, 0.0f, 0.0f },
+		{ 0.0f, 1.0f, 0.0f, 0.0f },
+		{ 0.0f, 0.0f, 1.0f, 0.0f } };
+
+	static InstanceTransform Translation(const float3 t) noexcept
+	{
+		InstanceTransform out;
+		out.rows[0][3] = t.x;
+		out.rows[1][3] = t.y;
+		out.rows[2][3] = t.z;
+		return out;
+	}
+
+	float3 Apply(const float3 p) const noexcept
+	{
+		return {
+			rows[0][0] * p.x + rows[0][1] * p.y + rows[0][2] * p.z + rows[0][3],
+			rows[1][0] * p.x + rows[1][1] * p.y + rows[1][2] * p.z + rows[1][3],
+			rows[2][0] * p.x + rows[2][1] * p.y + rows[2][2] * p.z + rows[2][3] };
+	}
+
+	// Box of the transformed box, center moves and extents go through |M|
+	AABB Apply(const AABB& aabb) const noexcept
+	{
+		const float3 c = Apply(aabb.Center());
+		const float3 e = aabb.Extents() * 0.5f;
+
+		auto Row = [&](const size_t i)
+		{
+			return std::abs(rows[i][0]) * e.x + std::abs(rows[i][1]) * e.y + std::abs(rows[i][2]) * e.z;
+		};
+
+		const float3 r = { Row(0), Row(1), Row(2) };
+
+		return { c - r, c + r };
+	}
+
+	float MaxScale() const noexcept
+	{
+		float s = 0.0f;
+
+		for (size_t c = 0; c < 3; c++)
+			s = std::max(s, Length({ rows[0][c], rows[1][c], rows[2][c] }));
+
+		return s;
+	}
+};
+
+struct InstanceGroup
+{
+	uint32_t                        prototype = 0;  // shape holding the mesh, also shapes[0]
+	std::vector<uint32_t>           shapes;
+	std::vector<InstanceTransform>  transforms;     // prototype space to each shape
+};
+
+// Bounds of every instance of every group in one table, so a frame culls them in a single
+// pass. Rows run group by group in instance order, group g owns [firstRow[g], firstRow[g + 1]).
+struct InstanceBounds
+{
+	BoundsTable             bounds;
+	std::vector<uint32_t>   firstRow;   // one per group plus the total
+};
+
+namespace InstancingDetail
+{
+	inline uint64_t HashCombine(const uint64_t h, const uint64_t v) noexcept
+	{
+		return (h ^ v) * 0x100000001B3ull;     // FNV-1a step over whole words
+	}
+
+	// Indices renumbered by first use, so equal topology gives equal streams at any vertex offset
+	inline std::vector<uint32_t> LocalIndices(const std::span<const uint32_t> indices, std::vector<uint32_t>& firstUse)
+	{
+		std::vector<uint32_t> local(indices.size());
+		std::unordered_map<uint32_t, uint32_t> ids;
+
+		firstUse.clear();
+
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			const auto [it, inserted] = ids.try_emplace(indices[i], uint32_t(firstUse.size()));
+			if (inserted)
+				firstUse.push_back(indices[i]);
+
+			local[i] = it->second;
+		}
+
+		return local;
+	}
+}
+
+// Groups shapes that are translated copies of each other within epsilon. faceMaterials
+// may be empty, otherwise instances also need equal materials. Every shape is in exactly
+// one group, unique shapes form groups of one.
+inline std::vector<InstanceGroup> FindInstances(const float* positions, const std::span<const std::span<const uint32_t>> shapeIndices, const std::span<const std::span<const int>> faceMaterials, const float epsilon)
+{
+	using namespace InstancingDetail;
+
+	struct Candidate
+	{
+		std::vector<uint32_t>   local;
+		std::vector<uint32_t>   vertices;   // shape vertices in first use order
+		uint32_t                group;
+	};
+
+	std::vector<InstanceGroup>                          groups;
+	std::unordered_map<uint64_t, std::vector<Candidate>> prototypes;
+
+	for (uint32_t s = 0; s < shapeIndices.size(); s++)
+	{
+		const std::span<const int> materials = s < faceMaterials.size() ? faceMaterials[s] : std::span<const int>{};
+
+		Candidate shape;
+		shape.local = LocalIndices(shapeIndices[s], shape.vertices);
+
+		uint64_t hash = 0xCBF29CE484222325ull;
+		for (const uint32_t index : shape.local)
+			hash = HashCombine(hash, index);
+
+		for (const int material : materials)
+			hash = HashCombine(hash, uint64_t(uint32_t(material)) | 1ull << 32);
+
+		auto& bucket = prototypes[hash];
+
+		// Translation from the first vertex, every other vertex has to agree
+		auto Match = [&](const Candidate& proto, float3& translation)
+		{
+			if (proto.local != shape.local || shape.vertices.empty())
+				return false;
+
+			const auto& protoMaterials = groups[proto.group].prototype < faceMaterials.size() ? faceMaterials[groups[proto.group].prototype] : std::span<const int>{};
+			if (!std::equal(materials.begin(), materials.end(), protoMaterials.begin(), protoMaterials.end()))
+				return false;
+
+			translation = LoadFloat3(positions + 3 * size_t(shape.vertices[0])) - LoadFloat3(positions + 3 * size_t(proto.vertices[0]));
+
+			for (size_t v = 1; v < shape.vertices.size(); v++)
+			{
+				const float3 expected   = LoadFloat3(positions + 3 * size_t(proto.vertices[v])) + translation;
+				const float3 d          = LoadFloat3(positions + 3 * size_t(shape.vertices[v])) - expected;
+
+				if (Dot(d, d) > epsilon * epsilon)
+					return false;
+			}
+
+			return true;
+		};
+
+		bool found = false;
+
+		for (const auto& proto : bucket)
+		{
+			float3 translation;
+			if (!Match(proto, translation))
+				continue;
+
+			groups[proto.group].shapes.push_back(s);
+			groups[proto.group].transforms.push_back(InstanceTransform::Translation(translation));
+			found = true;
+			break;
+		}
+
+		if (!found)
+		{
+			shape.group = uint32_t(groups.size());
+
+			InstanceGroup group;
+			group.prototype = s;
+			group.shapes.push_back(s);
+			group.transforms.push_back({});
+			groups.push_back(std::move(group));
+
+			bucket.push_back(std::move(shape));
+		}
+	}
+
+	return groups;
+}
+
+// Instance bounds from each prototype's local bounds, row g of prototypes belongs to group g
+inline InstanceBounds ComputeInstanceBounds(const std::span<const InstanceGroup> groups, const BoundsTable& prototypes)
+{
+	InstanceBounds out;
+	out.firstRow.reserve(groups.size() + 1);
+
+	uint32_t rows = 0;
+	for (const auto& group : groups)
+	{
+		out.firstRow.push_back(rows);
+		rows += uint32_t(group.transforms.size());
+	}
+
+	out.firstRow.push_back(rows);
+	out.bounds.Resize(rows);
+
+	for (size_t g = 0; g < groups.size(); g++)
+	{
+		const AABB              aabb    = prototypes.GetAABB(g);
+		const BoundingSphere    sphere  = prototypes.GetSphere(g);
+
+		for (size_t i = 0; i < groups[g].transforms.size(); i++)
+		{
+			const auto&     transform   = groups[g].transforms[i];
+			const size_t    row         = out.firstRow[g] + i;
+
+			out.bounds.SetAABB(row, transform.Apply(aabb));
+			out.bounds.SetSphere(row, { transform.Apply(sphere.center), sphere.radius * transform.MaxScale() });
+		}
+	}
+
+	return out;
+}
+
+struct InstanceDraw
+{
+	uint32_t group          = 0;
+	uint32_t level          = 0;    // LOD of the prototype
+	uint32_t firstInstance  = 0;    // into the compacted transforms
+	uint32_t instanceCount  = 0;
+};
+
+// Culls every instance in one pass and compacts the visible transforms, one draw per group
+// and LOD level. SelectLevel(group, BoundingSphere) returns the level of an instance.
+template<typename SELECT_LEVEL>
+void BuildInstanceDraws(ThreadPool& threads, const Frustum& frustum, const std::span<const InstanceGroup> groups, const InstanceBounds& instances, SELECT_LEVEL&& SelectLevel, std::vector<InstanceTransform>& transforms, std::vector<InstanceDraw>& draws)
+{
+	transforms.clear();
+	draws.clear();
+
+	std::vector<uint32_t> visible;
+	std::vector<uint32_t> levels;
+	std::vector<uint32_t> counts;
+
+	FrustumCull(threads, frustum, instances.bounds, visible);
+
+	levels.resize(visible.size());
+	transforms.resize(visible.size());
+
+	// Visible rows are ascending, so each group's survivors are one run of them
+	size_t begin = 0;
+
+	for (uint32_t g = 0; g < groups.size() && begin < visible.size(); g++)
+	{
+		const auto&     group       = groups[g];
+		const uint32_t  firstRow    = instances.firstRow[g];
+
+		size_t end = begin;
+		while (end < visible.size() && visible[end] < instances.firstRow[g + 1])
+			end++;
+
+		// Bucket the group's visible instances by level, keeping their order within a level
+		counts.clear();
+
+		for (size_t i = begin; i < end; i++)
+		{
+			levels[i] = SelectLevel(g, instances.bounds.GetSphere(visible[i]));
+
+			if (levels[i] >= counts.size())
+				counts.resize(levels[i] + 1, 0);
+
+			counts[levels[i]]++;
+		}
+
+		uint32_t offset = uint32_t(begin);
+		for (uint32_t level = 0; level < counts.size(); level++)
+		{
+			if (counts[level])
+				draws.push_back({ g, level, offset, counts[level] });
+
+			const uint32_t count = counts[level];
+			counts[level]   = offset;
+			offset          += count;
+		}
+
+		for (size_t i = begin; i < end; i++)
+			transforms[counts[levels[i]]++] = group.transforms[visible[i] - firstRow];
+
+		begin = end;
+	}
+}
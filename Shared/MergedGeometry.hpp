@@ -0,0 +1,82 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Packs many shapes into one vertex and one index buffer. Each shape gets its own
+// contiguous vertex range so its indices are local and drawn with a base vertex.
+
+struct IndexRange
+{
+	uint32_t    startIndex  = 0;
+	uint32_t    indexCount  = 0;
+};
+
+struct MergedShape
+{
+	int32_t                 baseVertex  = 0;
+	uint32_t                vertexCount = 0;
+	std::vector<IndexRange> ranges;         // one per input index list, e.g. LODs
+};
+
+struct MergedGeometry
+{
+	std::vector<float>          positions;  // xyz
+	std::vector<uint32_t>       indices;    // local to each shape's vertex range
+	std::vector<MergedShape>    shapes;
+	uint32_t                    maxShapeVertices = 0;
+
+	bool Fits16BitIndices() const noexcept { return maxShapeVertices <= 0x10000; }
+
+	std::vector<uint16_t> Indices16() const
+	{
+		return { indices.begin(), indices.end() };
+	}
+};
+
+// shapeIndexLists[shape][list] index a shared positions array. Vertices referenced by
+// several shapes are duplicated into each shape's range.
+inline MergedGeometry MergeShapes(const float* positions, const size_t vertexCount, const std::vector<std::vector<std::span<const uint32_t>>>& shapeIndexLists)
+{
+	MergedGeometry out;
+	out.shapes.reserve(shapeIndexLists.size());
+
+	std::vector<uint32_t> localIndex(vertexCount, UINT32_MAX);
+	std::vector<uint32_t> used;
+
+	for (const auto& lists : shapeIndexLists)
+	{
+		MergedShape shape;
+		shape.baseVertex = int32_t(out.positions.size() / 3);
+
+		for (const auto list : lists)
+		{
+			shape.ranges.push_back({ (uint32_t)out.indices.size(), (uint32_t)list.size() });
+
+			for (const uint32_t v : list)
+			{
+				if (localIndex[v] == UINT32_MAX)
+				{
+					localIndex[v] = (uint32_t)used.size();
+					used.push_back(v);
+					out.positions.insert(out.positions.end(), positions + 3 * v, positions + 3 * v + 3);
+				}
+
+				out.indices.push_back(localIndex[v]);
+			}
+		}
+
+		for (const uint32_t v : used)
+			localIndex[v] = UINT32_MAX;
+
+		shape.vertexCount       = (uint32_t)used.size();
+		out.maxShapeVertices    = std::max(out.maxShapeVertices, shape.vertexCount);
+		used.clear();
+
+		out.shapes.push_back(std::move(shape));
+	}
+
+	return out;
+}
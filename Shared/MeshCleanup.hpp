@@ -0,0 +1,245 @@
+#pragma once
+
+#include "Geometry.hpp"
+#include "RadixSort.hpp"
+#include "Threading.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Cleanup of exported meshes: positions within epsilon are welded through a spatial
+// hash grid, then triangles that collapsed or repeat an earlier one are dropped.
+
+struct CleanupStats
+{
+	size_t  vertices        = 0;
+	size_t  welded          = 0;    // vertices folded into an earlier one
+	size_t  triangles       = 0;
+	size_t  degenerate      = 0;    // repeated index or height below epsilon
+	size_t  duplicates      = 0;    // same vertices and winding as an earlier triangle
+
+	size_t RemovedTriangles() const noexcept { return degenerate + duplicates; }
+
+	CleanupStats& operator += (const CleanupStats& rhs) noexcept
+	{
+		vertices    += rhs.vertices;
+		welded      += rhs.welded;
+		triangles   += rhs.triangles;
+		degenerate  += rhs.degenerate;
+		duplicates  += rhs.duplicates;
+
+		return *this;
+	}
+};
+
+namespace CleanupDetail
+{
+	constexpr size_t grainSize = 4096;
+
+	struct Cell
+	{
+		int64_t x = 0;
+		int64_t y = 0;
+		int64_t z = 0;
+	};
+
+	// Cells are epsilon wide so every neighbour within epsilon is in the 3x3x3 block.
+	// With epsilon 0 the cell is the exact bit pattern and only the own cell is searched.
+	inline Cell CellOf(const float3 p, const float epsilon) noexcept
+	{
+		auto Coord = [&](const float x) -> int64_t
+		{
+			if (!std::isfinite(x))
+				return 0;
+
+			if (epsilon > 0.0f)
+				return int64_t(std::floor(double(x) / epsilon));
+
+			int32_t bits;
+			const float positive = x + 0.0f;   // -0 welds with +0
+			std::memcpy(&bits, &positive, sizeof(bits));
+			return bits;
+		};
+
+		return { Coord(p.x), Coord(p.y), Coord(p.z) };
+	}
+
+	// Colliding cells only cost extra distance tests
+	inline uint64_t HashCell(const Cell c) noexcept
+	{
+		uint64_t h = uint64_t(c.x) * 0x9E3779B97F4A7C15ull;
+		h = (h ^ (h >> 29) ^ uint64_t(c.y)) * 0xBF58476D1CE4E5B9ull;
+		h = (h ^ (h >> 29) ^ uint64_t(c.z)) * 0x94D049BB133111EBull;
+		return h ^ (h >> 31);
+	}
+}
+
+// Returns remap[v], the vertex v welds into. Each vertex joins the lowest index vertex
+// within epsilon, so chains may drift further than epsilon but the result does not
+// depend on the thread count. remap[v] <= v and remap[remap[v]] == remap[v].
+inline std::vector<uint32_t> WeldPositions(ThreadPool& threads, const float* positions, const size_t vertexCount, const float epsilon, CleanupStats& stats)
+{
+	using namespace CleanupDetail;
+
+	std::vector<uint64_t> keys(vertexCount);
+	std::vector<uint32_t> vertices(vertexCount);
+
+	threads.ParallelFor(vertexCount, grainSize,
+		[&](size_t begin, size_t end)
+		{
+			for (size_t v = begin; v < end; v++)
+			{
+				keys[v]     = HashCell(CellOf(LoadFloat3(positions + 3 * v), epsilon));
+				vertices[v] = uint32_t(v);
+			}
+		});
+
+	// Grid as runs of equal keys, vertices ascending within a run since the sort is stable
+	RadixSort(threads, keys, vertices);
+
+	const int64_t   radius          = epsilon > 0.0f ? 1 : 0;
+	const float     epsilonSquared  = epsilon * epsilon;
+
+	std::vector<uint32_t> remap(vertexCount);
+
+	threads.ParallelFor(vertexCount, grainSize,
+		[&](size_t begin, size_t end)
+		{
+			for (size_t v = begin; v < end; v++)
+			{
+				const float3 p = LoadFloat3(positions + 3 * v);
+				const Cell   c = CellOf(p, epsilon);
+
+				uint32_t first = uint32_t(v);
+
+				for (int64_t z = -radius; z <= radius; z++)
+				for (int64_t y = -radius; y <= radius; y++)
+				for (int64_t x = -radius; x <= radius; x++)
+				{
+					const auto range = std::equal_range(keys.begin(), keys.end(), HashCell({ c.x + x, c.y + y, c.z + z }));
+
+					for (auto it = range.first; it != range.second; it++)
+					{
+						const uint32_t other = vertices[size_t(it - keys.begin())];
+						if (other >= first)
+							break;
+
+						const float3 d = LoadFloat3(positions + 3 * size_t(other)) - p;
+						if (Dot(d, d) <= epsilonSquared)
+						{
+							first = other;
+							break;
+						}
+					}
+				}
+
+				remap[v] = first;
+			}
+		});
+
+	// Lower vertices are final by the time they are referenced
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		remap[v] = remap[remap[v]];
+		stats.welded += remap[v] != v;
+	}
+
+	stats.vertices += vertexCount;
+
+	return remap;
+}
+
+// Remaps indices through remap (may be empty) and removes degenerate and duplicate
+// triangles in place. Returns kept[new] = old for the per triangle data, see ApplyTriangleOrder.
+inline std::vector<uint32_t> CleanupTriangles(const float* positions, const std::vector<uint32_t>& remap, std::vector<uint32_t>& indices, const float epsilon, CleanupStats& stats)
+{
+	const size_t triangleCount = indices.size() / 3;
+
+	stats.triangles += triangleCount;
+
+	if (!remap.empty())
+	{
+		for (auto& index : indices)
+			index = remap[index];
+	}
+
+	std::vector<uint32_t> kept;
+	kept.reserve(triangleCount);
+
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const uint32_t* tri = indices.data() + 3 * t;
+
+		if (tri[0] == tri[1] || tri[1] == tri[2] || tri[2] == tri[0])
+		{
+			stats.degenerate++;
+			continue;
+		}
+
+		const float3 a = LoadFloat3(positions + 3 * size_t(tri[0]));
+		const float3 b = LoadFloat3(positions + 3 * size_t(tri[1]));
+		const float3 c = LoadFloat3(positions + 3 * size_t(tri[2]));
+
+		// Twice the area against the longest edge times epsilon, i.e. height <= epsilon
+		const float longest = std::sqrt(std::max({ Dot(b - a, b - a), Dot(c - b, c - b), Dot(a - c, a - c) }));
+
+		if (Length(TriangleNormal(a, b, c)) <= epsilon * longest)
+		{
+			stats.degenerate++;
+			continue;
+		}
+
+		kept.push_back(uint32_t(t));
+	}
+
+	// Duplicates by rotation to the lowest index first, which keeps the winding,
+	// so two sided geometry built from opposite triangles survives
+	struct Key
+	{
+		uint32_t v[3];
+		uint32_t triangle;
+
+		bool operator < (const Key& rhs) const noexcept
+		{
+			return std::lexicographical_compare(v, v + 3, rhs.v, rhs.v + 3) || (std::equal(v, v + 3, rhs.v) && triangle < rhs.triangle);
+		}
+	};
+
+	std::vector<Key> sorted;
+	sorted.reserve(kept.size());
+
+	for (const uint32_t t : kept)
+	{
+		const uint32_t* tri     = indices.data() + 3 * size_t(t);
+		const size_t    lowest  = tri[0] < tri[1] ? (tri[0] < tri[2] ? 0 : 2) : (tri[1] < tri[2] ? 1 : 2);
+
+		sorted.push_back({ { tri[lowest], tri[(lowest + 1) % 3], tri[(lowest + 2) % 3] }, t });
+	}
+
+	std::sort(sorted.begin(), sorted.end());
+
+	std::vector<uint8_t> duplicate(triangleCount, 0);
+
+	for (size_t i = 1; i < sorted.size(); i++)
+	{
+		if (std::equal(sorted[i].v, sorted[i].v + 3, sorted[i - 1].v))
+			duplicate[sorted[i].triangle] = 1;
+	}
+
+	const auto last = std::remove_if(kept.begin(), kept.end(), [&](uint32_t t) { return duplicate[t] != 0; });
+	stats.duplicates += size_t(kept.end() - last);
+	kept.erase(last, kept.end());
+
+	std::vector<uint32_t> compacted;
+	compacted.reserve(3 * kept.size());
+
+	for (const uint32_t t : kept)
+		compacted.insert(compacted.end(), indices.begin() + 3 * size_t(t), indices.begin() + 3 * size_t(t) + 3);
+
+	indices.swap(compacted);
+
+	return kept;
+}
@@ -0,0 +1,601 @@
+#pragma once
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Index codec
+//  One code byte per triangle plus a varint data stream. Triangles that share an edge with
+//  one of the last 15 emitted edges only code the third vertex, which is usually the next
+//  unseen vertex or one of the last 16 vertices. Decoded triangles may be rotated
+//  (a, b, c) -> (b, c, a), winding and the rendered result are unchanged.
+//
+// Vertex codec
+//  Vertices are split into 32 bit words, each word column is delta coded against the
+//  previous vertex, zigzagged and transposed into four byte planes. Each plane is stored
+//  in groups of 16 bytes packed to 0, 2, 4 or 8 bits. Decoding is SSE2, a block is
+//  decoded column by column and written out in vertex order.
+
+namespace MeshCodecDetail
+{
+	constexpr uint8_t   indexHeader     = 0xe1;
+	constexpr uint8_t   vertexHeader    = 0xe2;
+	constexpr size_t    edgeFifoSize    = 15;
+	constexpr size_t    vertexFifoSize  = 16;
+	constexpr size_t    vertexBlockSize = 256;
+	constexpr size_t    groupSize       = 16;
+
+	inline void WriteVarint(std::vector<uint8_t>& out, uint64_t v)
+	{
+		while (v >= 0x80)
+		{
+			out.push_back(uint8_t(v | 0x80));
+			v >>= 7;
+		}
+
+		out.push_back(uint8_t(v));
+	}
+
+	inline bool ReadVarint(const uint8_t*& data, const uint8_t* end, uint64_t& v) noexcept
+	{
+		// Most codes fit a byte
+		if (data != end && *data < 0x80)
+		{
+			v = *data++;
+			return true;
+		}
+
+		v = 0;
+
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			if (data == end)
+				return false;
+
+			const uint8_t byte = *data++;
+			v |= uint64_t(byte & 0x7f) << shift;
+
+			if (!(byte & 0x80))
+				return true;
+		}
+
+		return false;
+	}
+
+	inline uint32_t ZigZag(const int32_t v) noexcept    { return (uint32_t(v) << 1) ^ uint32_t(v >> 31); }
+	inline int32_t  UnZigZag(const uint32_t v) noexcept { return int32_t(v >> 1) ^ -int32_t(v & 1); }
+
+	struct Edge
+	{
+		uint32_t a;
+		uint32_t b;
+	};
+
+	// Ring buffers shared by the index encoder and decoder so both see the same state. The
+	// edge ring has 16 slots of which the last 15 are addressed, masking instead of % 15.
+	struct IndexState
+	{
+		static constexpr size_t ringMask = 15;
+
+		Edge        edges[ringMask + 1]     = {};
+		uint32_t    vertices[vertexFifoSize]= {};
+		size_t      edgeOffset              = 0;
+		size_t      vertexOffset            = 0;
+		uint32_t    next                    = 0;
+		uint32_t    last                    = 0;
+
+		void PushEdge(const uint32_t a, const uint32_t b) noexcept
+		{
+			edges[edgeOffset] = { a, b };
+			edgeOffset = (edgeOffset + 1) & ringMask;
+		}
+
+		void PushVertex(const uint32_t v) noexcept
+		{
+			vertices[vertexOffset] = v;
+			vertexOffset = (vertexOffset + 1) & ringMask;
+		}
+
+		// Most recent first
+		const Edge& EdgeAt(const size_t i) const noexcept { return edges[(edgeOffset - 1 - i) & ringMask]; }
+		uint32_t    VertexAt(const size_t i) const noexcept { return vertices[(vertexOffset - 1 - i) & ringMask]; }
+
+		void PushTriangle(const uint32_t a, const uint32_t b, const uint32_t c) noexcept
+		{
+			PushEdge(b, c);
+			PushEdge(c, a);
+			PushEdge(a, b);
+		}
+	};
+
+	// Vertex reference in the data stream: 0 = next, 1..16 = vertex fifo, otherwise delta from last
+	inline void WriteVertex(std::vector<uint8_t>& data, IndexState& state, const uint32_t v)
+	{
+		if (v == state.next)
+		{
+			data.push_back(0);
+			state.next++;
+			state.PushVertex(v);
+			return;
+		}
+
+		for (size_t i = 0; i < vertexFifoSize; i++)
+		{
+			if (state.VertexAt(i) == v)
+			{
+				data.push_back(uint8_t(i + 1));
+				return;
+			}
+		}
+
+		WriteVarint(data, uint64_t(ZigZag(int32_t(v - state.last))) + vertexFifoSize + 1);
+		state.last = v;
+		state.next = std::max(state.next, v + 1);
+		state.PushVertex(v);
+	}
+
+	inline bool ReadVertex(const uint8_t*& data, const uint8_t* end, IndexState& state, uint32_t& v) noexcept
+	{
+		uint64_t code;
+		if (!ReadVarint(data, end, code))
+			return false;
+
+		if (code == 0)
+		{
+			v = state.next++;
+			state.PushVertex(v);
+		}
+		else if (code <= vertexFifoSize)
+			v = state.VertexAt(size_t(code - 1));
+		else
+		{
+			v = state.last + uint32_t(UnZigZag(uint32_t(code - vertexFifoSize - 1)));
+			state.last = v;
+			state.next = std::max(state.next, v + 1);
+			state.PushVertex(v);
+		}
+
+		return true;
+	}
+}
+
+// Triangle lists only, empty if indexCount is not a multiple of 3
+inline std::vector<uint8_t> EncodeIndexBuffer(const uint32_t* indices, const size_t indexCount)
+{
+	using namespace MeshCodecDetail;
+
+	if (indexCount % 3)
+		return {};
+
+	const size_t triangleCount = indexCount / 3;
+
+	std::vector<uint8_t> out;
+	out.push_back(indexHeader);
+	WriteVarint(out, indexCount);
+
+	const size_t codeOffset = out.size();
+	out.resize(codeOffset + triangleCount);
+
+	std::vector<uint8_t> data;
+	data.reserve(triangleCount * 2);
+
+	IndexState state;
+
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const uint32_t* tri = indices + 3 * t;
+
+		// Find a rotation whose first edge was emitted (reversed) by a neighbour
+		size_t edge     = edgeFifoSize;
+		size_t rotation = 0;
+
+		for (size_t i = 0; i < edgeFifoSize && edge == edgeFifoSize; i++)
+		{
+			const Edge& e = state.EdgeAt(i);
+
+			for (size_t r = 0; r < 3; r++)
+			{
+				if (tri[r] == e.b && tri[(r + 1) % 3] == e.a)
+				{
+					edge        = i;
+					rotation    = r;
+					break;
+				}
+			}
+		}
+
+		if (edge == edgeFifoSize)
+		{
+			out[codeOffset + t] = 0xff;
+
+			for (size_t i = 0; i < 3; i++)
+				WriteVertex(data, state, tri[i]);
+
+			state.PushTriangle(tri[0], tri[1], tri[2]);
+			continue;
+		}
+
+		const uint32_t a = tri[rotation];
+		const uint32_t b = tri[(rotation + 1) % 3];
+		const uint32_t c = tri[(rotation + 2) % 3];
+
+		// Third vertex packed in the low nibble when possible: 0 = next, 1..14 = fifo, 15 = data stream
+		uint8_t code = 15;
+
+		if (c == state.next)
+		{
+			code = 0;
+			state.next++;
+			state.PushVertex(c);
+		}
+		else
+		{
+			for (size_t i = 0; i < 14; i++)
+			{
+				if (state.VertexAt(i) == c)
+				{
+					code = uint8_t(i + 1);
+					break;
+				}
+			}
+
+			if (code == 15)
+				WriteVertex(data, state, c);
+		}
+
+		out[codeOffset + t] = uint8_t(edge << 4) | code;
+		state.PushTriangle(a, b, c);
+	}
+
+	out.insert(out.end(), data.begin(), data.end());
+
+	return out;
+}
+
+inline size_t GetEncodedIndexCount(const uint8_t* encoded, const size_t size) noexcept
+{
+	const uint8_t* end = encoded + size;
+	uint64_t count = 0;
+
+	if (!size || *encoded++ != MeshCodecDetail::indexHeader || !MeshCodecDetail::ReadVarint(encoded, end, count))
+		return 0;
+
+	return size_t(count);
+}
+
+// Returns false on malformed input. out must hold GetEncodedIndexCount indices.
+inline bool DecodeIndexBuffer(const uint8_t* encoded, const size_t size, uint32_t* out, const size_t indexCount) noexcept
+{
+	using namespace MeshCodecDetail;
+
+	const uint8_t*  end     = encoded + size;
+	uint64_t        count   = 0;
+
+	if (!size || *encoded++ != indexHeader || !ReadVarint(encoded, end, count) || count != indexCount || count % 3)
+		return false;
+
+	const size_t triangleCount = indexCount / 3;
+
+	if (size_t(end - encoded) < triangleCount)
+		return false;
+
+	const uint8_t* codes    = encoded;
+	const uint8_t* data     = encoded + triangleCount;
+
+	IndexState state;
+
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const uint8_t   code    = codes[t];
+		uint32_t*       tri     = out + 3 * t;
+
+		if (code == 0xff)
+		{
+			for (size_t i = 0; i < 3; i++)
+			{
+				if (!ReadVertex(data, end, state, tri[i]))
+					return false;
+			}
+
+			state.PushTriangle(tri[0], tri[1], tri[2]);
+			continue;
+		}
+
+		const Edge&     e       = state.EdgeAt(code >> 4);
+		const uint8_t   vertex  = code & 0xf;
+
+		tri[0] = e.b;
+		tri[1] = e.a;
+
+		if (vertex == 0)
+		{
+			tri[2] = state.next++;
+			state.PushVertex(tri[2]);
+		}
+		else if (vertex < 15)
+			tri[2] = state.VertexAt(vertex - 1);
+		else if (!ReadVertex(data, end, state, tri[2]))
+			return false;
+
+		state.PushTriangle(tri[0], tri[1], tri[2]);
+	}
+
+	return data == end;
+}
+
+namespace MeshCodecDetail
+{
+	inline size_t GroupBytes(const uint32_t mode) noexcept
+	{
+		constexpr size_t bytes[] = { 0, 4, 8, 16 };
+		return bytes[mode];
+	}
+
+	// 2 bit layout: value j lives in byte j % 4 at bit 2 * (j / 4)
+	// 4 bit layout: value j lives in byte j % 8 at bit 4 * (j / 8)
+	inline void EncodeGroup(const uint8_t* values, const uint32_t mode, std::vector<uint8_t>& out)
+	{
+		uint8_t packed[16] = {};
+
+		switch (mode)
+		{
+		case 0:
+			return;
+		case 1:
+			for (size_t j = 0; j < groupSize; j++)
+				packed[j % 4] |= uint8_t(values[j] << (2 * (j / 4)));
+			break;
+		case 2:
+			for (size_t j = 0; j < groupSize; j++)
+				packed[j % 8] |= uint8_t(values[j] << (4 * (j / 8)));
+			break;
+		default:
+			memcpy(packed, values, groupSize);
+		}
+
+		out.insert(out.end(), packed, packed + GroupBytes(mode));
+	}
+
+	inline __m128i DecodeGroup(const uint8_t* data, const uint32_t mode) noexcept
+	{
+		switch (mode)
+		{
+		case 0:
+			return _mm_setzero_si128();
+		case 1:
+		{
+			int32_t word;
+			memcpy(&word, data, sizeof(word));
+
+			const __m128i b = _mm_set1_epi32(word);
+			const __m128i m = _mm_set1_epi8(3);
+
+			const __m128i v0 = _mm_and_si128(b,                      _mm_setr_epi32(-1, 0, 0, 0));
+			const __m128i v1 = _mm_and_si128(_mm_srli_epi16(b, 2),   _mm_setr_epi32(0, -1, 0, 0));
+			const __m128i v2 = _mm_and_si128(_mm_srli_epi16(b, 4),   _mm_setr_epi32(0, 0, -1, 0));
+			const __m128i v3 = _mm_and_si128(_mm_srli_epi16(b, 6),   _mm_setr_epi32(0, 0, 0, -1));
+
+			return _mm_and_si128(_mm_or_si128(_mm_or_si128(v0, v1), _mm_or_si128(v2, v3)), m);
+		}
+		case 2:
+		{
+			const __m128i l = _mm_loadl_epi64((const __m128i*)data);
+			const __m128i b = _mm_unpacklo_epi64(l, l);
+			const __m128i m = _mm_set1_epi8(0xf);
+
+			const __m128i lo = _mm_and_si128(b,                     _mm_setr_epi32(-1, -1, 0, 0));
+			const __m128i hi = _mm_and_si128(_mm_srli_epi16(b, 4),  _mm_setr_epi32(0, 0, -1, -1));
+
+			return _mm_and_si128(_mm_or_si128(lo, hi), m);
+		}
+		default:
+			return _mm_loadu_si128((const __m128i*)data);
+		}
+	}
+
+	// x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3 from four of each, the words are only moved
+	inline void StoreInterleaved4(const float* x, const float* y, const float* z, float* out) noexcept
+	{
+		const __m128 vx = _mm_loadu_ps(x);
+		const __m128 vy = _mm_loadu_ps(y);
+		const __m128 vz = _mm_loadu_ps(z);
+
+		const __m128 xy01 = _mm_unpacklo_ps(vx, vy);                                // x0 y0 x1 y1
+		const __m128 xy23 = _mm_unpackhi_ps(vx, vy);                                // x2 y2 x3 y3
+
+		const __m128 z0x1 = _mm_shuffle_ps(vz, xy01, _MM_SHUFFLE(2, 2, 0, 0));      // z0 z0 x1 x1
+		const __m128 y1z1 = _mm_shuffle_ps(xy01, vz, _MM_SHUFFLE(1, 1, 3, 3));      // y1 y1 z1 z1
+		const __m128 z2x3 = _mm_shuffle_ps(vz, xy23, _MM_SHUFFLE(2, 2, 2, 2));      // z2 z2 x3 x3
+		const __m128 y3z3 = _mm_shuffle_ps(xy23, vz, _MM_SHUFFLE(3, 3, 3, 3));      // y3 y3 z3 z3
+
+		_mm_storeu_ps(out + 0, _mm_shuffle_ps(xy01, z0x1, _MM_SHUFFLE(2, 0, 1, 0)));
+		_mm_storeu_ps(out + 4, _mm_shuffle_ps(y1z1, xy23, _MM_SHUFFLE(1, 0, 2, 0)));
+		_mm_storeu_ps(out + 8, _mm_shuffle_ps(z2x3, y3z3, _MM_SHUFFLE(2, 0, 2, 0)));
+	}
+
+	inline uint32_t SelectMode(const uint8_t* values) noexcept
+	{
+		uint8_t maxValue = 0;
+		for (size_t j = 0; j < groupSize; j++)
+			maxValue = std::max(maxValue, values[j]);
+
+		return maxValue == 0 ? 0 : maxValue < 4 ? 1 : maxValue < 16 ? 2 : 3;
+	}
+}
+
+// stride must be a multiple of 4
+inline std::vector<uint8_t> EncodeVertexBuffer(const void* vertices, const size_t vertexCount, const size_t stride)
+{
+	using namespace MeshCodecDetail;
+
+	const size_t    columns = stride / 4;
+	const uint8_t*  src     = (const uint8_t*)vertices;
+
+	std::vector<uint8_t> out;
+	out.reserve(vertexCount * stride / 2);
+	out.push_back(vertexHeader);
+	WriteVarint(out, vertexCount);
+	WriteVarint(out, stride);
+
+	std::vector<uint32_t>   previous(columns, 0);
+	uint8_t                 planes[4][vertexBlockSize];
+
+	for (size_t begin = 0; begin < vertexCount; begin += vertexBlockSize)
+	{
+		const size_t count  = std::min(vertexBlockSize, vertexCount - begin);
+		const size_t groups = (count + groupSize - 1) / groupSize;
+
+		for (size_t w = 0; w < columns; w++)
+		{
+			memset(planes, 0, sizeof(planes));
+
+			for (size_t i = 0; i < count; i++)
+			{
+				uint32_t word;
+				memcpy(&word, src + (begin + i) * stride + 4 * w, sizeof(word));
+
+				const uint32_t delta = ZigZag(int32_t(word - previous[w]));
+				previous[w] = word;
+
+				for (size_t b = 0; b < 4; b++)
+					planes[b][i] = uint8_t(delta >> (8 * b));
+			}
+
+			for (size_t b = 0; b < 4; b++)
+			{
+				// Two bit modes, four groups per header byte
+				const size_t headerOffset = out.size();
+				out.resize(out.size() + (groups + 3) / 4, 0);
+
+				for (size_t g = 0; g < groups; g++)
+				{
+					const uint32_t mode = SelectMode(planes[b] + g * groupSize);
+					out[headerOffset + g / 4] |= uint8_t(mode << (2 * (g % 4)));
+					EncodeGroup(planes[b] + g * groupSize, mode, out);
+				}
+			}
+		}
+	}
+
+	return out;
+}
+
+// Returns false on malformed input or a vertexCount/stride mismatch
+inline bool DecodeVertexBuffer(const uint8_t* encoded, const size_t size, void* vertices, const size_t vertexCount, const size_t stride) noexcept
+{
+	using namespace MeshCodecDetail;
+
+	const uint8_t*  data    = encoded;
+	const uint8_t*  end     = encoded + size;
+	uint64_t        count   = 0;
+	uint64_t        width   = 0;
+
+	if (!size || *data++ != vertexHeader ||
+		!ReadVarint(data, end, count) || !ReadVarint(data, end, width) ||
+		count != vertexCount || width != stride || stride % 4)
+		return false;
+
+	const size_t    columns = stride / 4;
+	uint8_t*        dst     = (uint8_t*)vertices;
+
+	alignas(16) uint8_t planes[4][vertexBlockSize];
+
+	// Every column of a block is decoded before the block is written out in vertex order
+	std::vector<uint32_t> previous(columns, 0);
+	std::vector<uint32_t> block(columns * vertexBlockSize);
+
+	for (size_t begin = 0; begin < vertexCount; begin += vertexBlockSize)
+	{
+		const size_t blockCount = std::min(vertexBlockSize, vertexCount - begin);
+		const size_t groups     = (blockCount + groupSize - 1) / groupSize;
+
+		for (size_t w = 0; w < columns; w++)
+		{
+			uint32_t* const words = block.data() + w * vertexBlockSize;
+
+			for (size_t b = 0; b < 4; b++)
+			{
+				const uint8_t* header = data;
+				data += (groups + 3) / 4;
+
+				if (data > end)
+					return false;
+
+				for (size_t g = 0; g < groups; g++)
+				{
+					const uint32_t mode = (header[g / 4] >> (2 * (g % 4))) & 3;
+
+					if (data + GroupBytes(mode) > end)
+						return false;
+
+					_mm_store_si128((__m128i*)(planes[b] + g * groupSize), DecodeGroup(data, mode));
+					data += GroupBytes(mode);
+				}
+			}
+
+			const __m128i one   = _mm_set1_epi32(1);
+			__m128i       carry = _mm_set1_epi32(int32_t(previous[w]));
+
+			for (size_t g = 0; g < groups; g++)
+			{
+				const __m128i p0 = _mm_load_si128((const __m128i*)(planes[0] + g * groupSize));
+				const __m128i p1 = _mm_load_si128((const __m128i*)(planes[1] + g * groupSize));
+				const __m128i p2 = _mm_load_si128((const __m128i*)(planes[2] + g * groupSize));
+				const __m128i p3 = _mm_load_si128((const __m128i*)(planes[3] + g * groupSize));
+
+				const __m128i lo01 = _mm_unpacklo_epi8(p0, p1);
+				const __m128i hi01 = _mm_unpackhi_epi8(p0, p1);
+				const __m128i lo23 = _mm_unpacklo_epi8(p2, p3);
+				const __m128i hi23 = _mm_unpackhi_epi8(p2, p3);
+
+				const __m128i zigzag[4] = {
+					_mm_unpacklo_epi16(lo01, lo23),
+					_mm_unpackhi_epi16(lo01, lo23),
+					_mm_unpacklo_epi16(hi01, hi23),
+					_mm_unpackhi_epi16(hi01, hi23),
+				};
+
+				for (size_t k = 0; k < 4; k++)
+				{
+					const __m128i z = zigzag[k];
+					__m128i       d = _mm_xor_si128(_mm_srli_epi32(z, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(z, one)));
+
+					// Inclusive prefix sum over the four lanes, then add the running value
+					d = _mm_add_epi32(d, _mm_slli_si128(d, 4));
+					d = _mm_add_epi32(d, _mm_slli_si128(d, 8));
+					d = _mm_add_epi32(d, carry);
+
+					carry = _mm_shuffle_epi32(d, _MM_SHUFFLE(3, 3, 3, 3));
+					_mm_storeu_si128((__m128i*)(words + g * groupSize + 4 * k), d);
+				}
+			}
+
+			previous[w] = words[blockCount - 1];
+		}
+
+		uint8_t*    out = dst + begin * stride;
+		size_t      i   = 0;
+
+		// xyz positions, four vertices at a time
+		if (columns == 3)
+		{
+			const float* x = (const float*)block.data();
+			const float* y = x + vertexBlockSize;
+			const float* z = y + vertexBlockSize;
+
+			for (; i + 4 <= blockCount; i += 4, out += 4 * stride)
+				StoreInterleaved4(x + i, y + i, z + i, (float*)out);
+		}
+
+		for (; i < blockCount; i++, out += stride)
+		{
+			for (size_t w = 0; w < columns; w++)
+				memcpy(out + 4 * w, block.data() + w * vertexBlockSize + i, sizeof(uint32_t));
+		}
+	}
+
+	return data == end;
+}
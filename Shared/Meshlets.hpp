@@ -0,0 +1,238 @@
+#pragma once
+
+#include "Geometry.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+struct Meshlet
+{
+	uint32_t vertexOffset   = 0;    // into MeshletMesh::vertices
+	uint32_t triangleOffset = 0;    // into MeshletMesh::triangles, in bytes
+	uint32_t vertexCount    = 0;
+	uint32_t triangleCount  = 0;
+};
+
+struct MeshletBounds
+{
+	BoundingSphere  sphere;
+
+	float3  coneApex;
+	float3  coneAxis;
+	float   coneCutoff = 1.0f; // 1 = cone too wide, never backface culled
+};
+
+struct MeshletLimits
+{
+	size_t maxVertices  = 64;
+	size_t maxTriangles = 124;
+};
+
+struct MeshletMesh
+{
+	std::vector<Meshlet>        meshlets;
+	std::vector<MeshletBounds>  bounds;
+	std::vector<uint32_t>       vertices;   // local vertex -> mesh vertex
+	std::vector<uint8_t>        triangles;  // three local indices per triangle
+
+	size_t TriangleCount() const noexcept { return triangles.size() / 3; }
+};
+
+inline MeshletBounds ComputeMeshletBounds(const MeshletMesh& mesh, const Meshlet& meshlet, const float* positions)
+{
+	std::vector<float3> points;
+	points.reserve(meshlet.vertexCount);
+
+	for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+		points.push_back(LoadFloat3(positions + 3 * mesh.vertices[meshlet.vertexOffset + i]));
+
+	MeshletBounds bounds;
+	bounds.sphere   = ComputeBoundingSphere(points.data(), points.size());
+	bounds.coneApex = bounds.sphere.center;
+
+	struct Triangle
+	{
+		float3 corner;
+		float3 normal;
+	};
+
+	std::vector<Triangle> triangles;
+	triangles.reserve(meshlet.triangleCount);
+
+	float3 axis;
+	for (uint32_t i = 0; i < meshlet.triangleCount; i++)
+	{
+		const uint8_t* tri = mesh.triangles.data() + meshlet.triangleOffset + 3 * i;
+
+		const float3 a = points[tri[0]];
+		const float3 b = points[tri[1]];
+		const float3 c = points[tri[2]];
+		const float3 n = TriangleNormal(a, b, c);
+
+		// Degenerate triangles are never rasterized, ignore them
+		if (Length(n) <= 0.0f)
+			continue;
+
+		triangles.push_back({ a, Normalize(n) });
+		axis += triangles.back().normal;
+	}
+
+	axis = Normalize(axis);
+
+	if (triangles.empty() || Length(axis) <= 0.0f)
+		return bounds;
+
+	float minDot = 1.0f;
+	for (const auto& tri : triangles)
+		minDot = std::min(minDot, Dot(tri.normal, axis));
+
+	// A cone that wide can always be seen from some direction
+	if (minDot <= 0.1f)
+		return bounds;
+
+	// Move the apex back along the axis until it lies behind every triangle plane
+	float maxT = 0.0f;
+	for (const auto& tri : triangles)
+	{
+		const float dc = Dot(bounds.sphere.center - tri.corner, tri.normal);
+		const float dn = Dot(axis, tri.normal);
+
+		maxT = std::max(maxT, dc / dn);
+	}
+
+	bounds.coneApex     = bounds.sphere.center - axis * maxT;
+	bounds.coneAxis     = axis;
+	bounds.coneCutoff   = std::sqrt(1.0f - minDot * minDot);
+
+	return bounds;
+}
+
+// Greedy scan in index order, a meshlet is closed once either limit would be exceeded.
+inline MeshletMesh BuildMeshlets(const float* positions, const size_t vertexCount, const uint32_t* indices, const size_t indexCount, const MeshletLimits limits = {})
+{
+	assert(limits.maxVertices >= 3 && limits.maxVertices <= 256);
+	assert(limits.maxTriangles >= 1 && limits.maxTriangles <= 512);
+	assert(indexCount % 3 == 0);
+
+	MeshletMesh out;
+	out.meshlets.reserve(indexCount / 3 / limits.maxTriangles + 1);
+	out.vertices.reserve(indexCount / 2);
+	out.triangles.reserve(indexCount);
+
+	std::vector<int16_t> localIndex(vertexCount, -1);
+
+	Meshlet current;
+
+	auto Flush = [&]()
+	{
+		if (!current.triangleCount)
+			return;
+
+		for (uint32_t i = 0; i < current.vertexCount; i++)
+			localIndex[out.vertices[current.vertexOffset + i]] = -1;
+
+		out.meshlets.push_back(current);
+
+		current = {};
+		current.vertexOffset    = (uint32_t)out.vertices.size();
+		current.triangleOffset  = (uint32_t)out.triangles.size();
+	};
+
+	for (size_t i = 0; i < indexCount; i += 3)
+	{
+		const uint32_t a = indices[i + 0];
+		const uint32_t b = indices[i + 1];
+		const uint32_t c = indices[i + 2];
+
+		const size_t newVertices =
+			(localIndex[a] < 0) +
+			(localIndex[b] < 0 && b != a) +
+			(localIndex[c] < 0 && c != a && c != b);
+
+		if (current.vertexCount + newVertices > limits.maxVertices ||
+			current.triangleCount + 1 > limits.maxTriangles)
+			Flush();
+
+		for (const uint32_t v : { a, b, c })
+		{
+			if (localIndex[v] < 0)
+			{
+				localIndex[v] = (int16_t)current.vertexCount++;
+				out.vertices.push_back(v);
+			}
+
+			out.triangles.push_back((uint8_t)localIndex[v]);
+		}
+
+		current.triangleCount++;
+	}
+
+	Flush();
+
+	out.bounds.reserve(out.meshlets.size());
+
+	for (const auto& meshlet : out.meshlets)
+		out.bounds.push_back(ComputeMeshletBounds(out, meshlet, positions));
+
+	return out;
+}
+
+struct ClusterCullStats
+{
+	size_t meshlets             = 0;
+	size_t frustumCulled        = 0;
+	size_t backfaceCulled       = 0;
+	size_t visible              = 0;
+	size_t trianglesTotal       = 0;
+	size_t trianglesVisible     = 0;
+
+	ClusterCullStats& operator += (const ClusterCullStats& rhs) noexcept
+	{
+		meshlets            += rhs.meshlets;
+		frustumCulled       += rhs.frustumCulled;
+		backfaceCulled      += rhs.backfaceCulled;
+		visible             += rhs.visible;
+		trianglesTotal      += rhs.trianglesTotal;
+		trianglesVisible    += rhs.trianglesVisible;
+
+		return *this;
+	}
+};
+
+inline bool IsBackfacing(const MeshletBounds& bounds, const float3 cameraPosition) noexcept
+{
+	return Dot(Normalize(bounds.coneApex - cameraPosition), bounds.coneAxis) >= bounds.coneCutoff;
+}
+
+// frustum and cameraPosition must be in the same space as the mesh positions.
+// Appends the indices of surviving meshlets to visible.
+inline ClusterCullStats CullMeshlets(const MeshletMesh& mesh, const Frustum& frustum, const float3 cameraPosition, std::vector<uint32_t>& visible)
+{
+	ClusterCullStats stats;
+	stats.meshlets = mesh.meshlets.size();
+
+	for (size_t i = 0; i < mesh.meshlets.size(); i++)
+	{
+		const auto& bounds = mesh.bounds[i];
+		stats.trianglesTotal += mesh.meshlets[i].triangleCount;
+
+		if (!Intersects(frustum, bounds.sphere))
+		{
+			stats.frustumCulled++;
+			continue;
+		}
+
+		if (IsBackfacing(bounds, cameraPosition))
+		{
+			stats.backfaceCulled++;
+			continue;
+		}
+
+		stats.visible++;
+		stats.trianglesVisible += mesh.meshlets[i].triangleCount;
+		visible.push_back((uint32_t)i);
+	}
+
+	return stats;
+}
@@ -0,0 +1,306 @@
+#pragma once
+
+#include "Geometry.hpp"
+#include "SIMD.hpp"
+#include "Threading.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <span>
+#include <vector>
+
+// Vertex normals for meshes without vn lines. Corners sharing a position are smoothed
+// together when their faces share a smoothing group and meet under the crease angle,
+// positions are split into one vertex per distinct normal.
+
+enum class NormalWeighting
+{
+	Area,   // face normals weighted by triangle area
+	Angle,  // unit face normals weighted by the corner angle, independent of tessellation
+};
+
+struct NormalSettings
+{
+	float           creaseAngle = 1.0471976f;   // radians, 60 degrees
+	NormalWeighting weighting   = NormalWeighting::Angle;
+};
+
+struct NormalInput
+{
+	std::span<const uint32_t> indices;          // position indices, clockwise triangles
+	std::span<const uint32_t> attributes;       // optional per corner, e.g. texcoord index. Corners only weld when equal
+	std::span<const uint32_t> smoothingGroups;  // optional per triangle, 0 is flat. Empty smooths everything by crease angle
+};
+
+struct NormalVertex
+{
+	uint32_t    position    = 0;
+	uint32_t    attribute   = 0;
+	float3      normal;
+};
+
+struct NormalMesh
+{
+	std::vector<NormalVertex>   vertices;
+	std::vector<uint32_t>       indices;    // into vertices
+};
+
+namespace NormalsDetail
+{
+	// Unit face normal and per corner weights of one triangle
+	inline void FaceData(const float* positions, const uint32_t* tri, float3& normal, float* weights, const NormalWeighting weighting) noexcept
+	{
+		const float3 a = LoadFloat3(positions + 3 * size_t(tri[0]));
+		const float3 b = LoadFloat3(positions + 3 * size_t(tri[1]));
+		const float3 c = LoadFloat3(positions + 3 * size_t(tri[2]));
+
+		const float3 n      = TriangleNormal(a, b, c);
+		const float  length = Length(n);
+
+		normal = Normalize(n);
+
+		if (weighting == NormalWeighting::Area)
+		{
+			weights[0] = weights[1] = weights[2] = length;
+			return;
+		}
+
+		auto Angle = [](const float3 u, const float3 v)
+		{
+			const float l = Length(u) * Length(v);
+			return l > 0.0f ? std::acos(std::clamp(Dot(u, v) / l, -1.0f, 1.0f)) : 0.0f;
+		};
+
+		weights[0] = length > 0.0f ? Angle(b - a, c - a) : 0.0f;
+		weights[1] = length > 0.0f ? Angle(a - b, c - b) : 0.0f;
+		weights[2] = length > 0.0f ? Angle(a - c, b - c) : 0.0f;
+	}
+
+	inline __m128 Gather(const float* positions, const uint32_t* indices, const size_t corner, const size_t component) noexcept
+	{
+		return _mm_setr_ps(
+			positions[3 * size_t(indices[corner + 0]) + component],
+			positions[3 * size_t(indices[corner + 3]) + component],
+			positions[3 * size_t(indices[corner + 6]) + component],
+			positions[3 * size_t(indices[corner + 9]) + component]);
+	}
+
+	// Four triangles per iteration, acos of the corner cosines stays scalar
+	inline void ComputeFaceData(const float* positions, const uint32_t* indices, const size_t triangleCount, float3* normals, float* weights, const NormalWeighting weighting) noexcept
+	{
+		size_t t = 0;
+
+		for (; t + 4 <= triangleCount; t += 4)
+		{
+			const uint32_t* tri = indices + 3 * t;
+
+			const __m128 ax = Gather(positions, tri, 0, 0), ay = Gather(positions, tri, 0, 1), az = Gather(positions, tri, 0, 2);
+			const __m128 bx = Gather(positions, tri, 1, 0), by = Gather(positions, tri, 1, 1), bz = Gather(positions, tri, 1, 2);
+			const __m128 cx = Gather(positions, tri, 2, 0), cy = Gather(positions, tri, 2, 1), cz = Gather(positions, tri, 2, 2);
+
+			// e1 = b - a, e2 = c - a, e3 = c - b
+			const __m128 e1x = _mm_sub_ps(bx, ax), e1y = _mm_sub_ps(by, ay), e1z = _mm_sub_ps(bz, az);
+			const __m128 e2x = _mm_sub_ps(cx, ax), e2y = _mm_sub_ps(cy, ay), e2z = _mm_sub_ps(cz, az);
+			const __m128 e3x = _mm_sub_ps(cx, bx), e3y = _mm_sub_ps(cy, by), e3z = _mm_sub_ps(cz, bz);
+
+			// TriangleNormal, Cross(e2, e1)
+			const __m128 nx = _mm_sub_ps(_mm_mul_ps(e2y, e1z), _mm_mul_ps(e2z, e1y));
+			const __m128 ny = _mm_sub_ps(_mm_mul_ps(e2z, e1x), _mm_mul_ps(e2x, e1z));
+			const __m128 nz = _mm_sub_ps(_mm_mul_ps(e2x, e1y), _mm_mul_ps(e2y, e1x));
+
+			const __m128 length     = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz)));
+			const __m128 nonZero    = _mm_cmpgt_ps(length, _mm_setzero_ps());
+			const __m128 invLength  = _mm_and_ps(nonZero, _mm_div_ps(_mm_set1_ps(1.0f), length));
+
+			alignas(16) float x[4], y[4], z[4], l[4];
+			_mm_store_ps(x, _mm_mul_ps(nx, invLength));
+			_mm_store_ps(y, _mm_mul_ps(ny, invLength));
+			_mm_store_ps(z, _mm_mul_ps(nz, invLength));
+			_mm_store_ps(l, length);
+
+			for (size_t i = 0; i < 4; i++)
+				normals[t + i] = { x[i], y[i], z[i] };
+
+			if (weighting == NormalWeighting::Area)
+			{
+				for (size_t i = 0; i < 4; i++)
+					weights[3 * (t + i) + 0] = weights[3 * (t + i) + 1] = weights[3 * (t + i) + 2] = l[i];
+
+				continue;
+			}
+
+			const __m128 l1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, e1x), _mm_mul_ps(e1y, e1y)), _mm_mul_ps(e1z, e1z));
+			const __m128 l2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, e2x), _mm_mul_ps(e2y, e2y)), _mm_mul_ps(e2z, e2z));
+			const __m128 l3 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e3x, e3x), _mm_mul_ps(e3y, e3y)), _mm_mul_ps(e3z, e3z));
+
+			// Corner a between e1 and e2, b between -e1 and e3, c between e2 and e3
+			const __m128 d12 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, e2x), _mm_mul_ps(e1y, e2y)), _mm_mul_ps(e1z, e2z));
+			const __m128 d13 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, e3x), _mm_mul_ps(e1y, e3y)), _mm_mul_ps(e1z, e3z));
+			const __m128 d23 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, e3x), _mm_mul_ps(e2y, e3y)), _mm_mul_ps(e2z, e3z));
+
+			auto Cosine = [&](const __m128 dot, const __m128 la, const __m128 lb)
+			{
+				const __m128 cosine = _mm_div_ps(dot, _mm_sqrt_ps(_mm_mul_ps(la, lb)));
+				return _mm_min_ps(_mm_set1_ps(1.0f), _mm_max_ps(_mm_set1_ps(-1.0f), cosine));
+			};
+
+			alignas(16) float cosA[4], cosB[4], cosC[4];
+			_mm_store_ps(cosA, Cosine(d12, l1, l2));
+			_mm_store_ps(cosB, Cosine(_mm_sub_ps(_mm_setzero_ps(), d13), l1, l3));
+			_mm_store_ps(cosC, Cosine(d23, l2, l3));
+
+			for (size_t i = 0; i < 4; i++)
+			{
+				float* w = weights + 3 * (t + i);
+
+				if (l[i] > 0.0f)
+				{
+					w[0] = std::acos(cosA[i]);
+					w[1] = std::acos(cosB[i]);
+					w[2] = std::acos(cosC[i]);
+				}
+				else
+					w[0] = w[1] = w[2] = 0.0f;
+			}
+		}
+
+		for (; t < triangleCount; t++)
+			FaceData(positions, indices + 3 * t, normals[t], weights + 3 * t, weighting);
+	}
+}
+
+inline NormalMesh GenerateNormals(const float* positions, const NormalInput& input, const NormalSettings& settings = {})
+{
+	using namespace NormalsDetail;
+
+	const auto&     indices         = input.indices;
+	const size_t    cornerCount     = indices.size() - indices.size() % 3;
+	const size_t    triangleCount   = cornerCount / 3;
+	const float     cosCrease       = std::cos(settings.creaseAngle);
+
+	std::vector<float3> faceNormals(triangleCount);
+	std::vector<float>  weights(cornerCount);
+
+	ComputeFaceData(positions, indices.data(), triangleCount, faceNormals.data(), weights.data(), settings.weighting);
+
+	auto Group      = [&](const size_t corner) { return input.smoothingGroups.empty() ? 1u : input.smoothingGroups[corner / 3]; };
+	auto Attribute  = [&](const size_t corner) { return input.attributes.empty() ? 0u : input.attributes[corner]; };
+
+	// Corners grouped by position, then by smoothing group, ascending corner order within a
+	// group keeps sums deterministic. Only corners of one group are compared with each other.
+	std::vector<uint32_t> corners(cornerCount);
+	std::iota(corners.begin(), corners.end(), 0u);
+	std::stable_sort(corners.begin(), corners.end(),
+		[&](uint32_t lhs, uint32_t rhs) { return indices[lhs] != indices[rhs] ? indices[lhs] < indices[rhs] : Group(lhs) < Group(rhs); });
+
+	std::vector<float3>     cornerNormals(cornerCount);
+	std::vector<uint32_t>   representative(cornerCount);
+	std::vector<uint32_t>   welded;
+
+	for (size_t first = 0; first < cornerCount;)
+	{
+		size_t last = first + 1;
+		while (last < cornerCount && indices[corners[last]] == indices[corners[first]])
+			last++;
+
+		for (size_t groupFirst = first; groupFirst < last;)
+		{
+			const uint32_t group = Group(corners[groupFirst]);
+
+			size_t groupLast = groupFirst + 1;
+			while (groupLast < last && Group(corners[groupLast]) == group)
+				groupLast++;
+
+			for (size_t i = groupFirst; i < groupLast; i++)
+			{
+				const uint32_t  c       = corners[i];
+				const float3    face    = faceNormals[c / 3];
+				const bool      flat    = Dot(face, face) == 0.0f;     // degenerate, takes its neighbours' normal
+				float3          sum;
+
+				for (size_t j = groupFirst; j < groupLast; j++)
+				{
+					const uint32_t other = corners[j];
+
+					const bool smooth = other == c ||
+						(group != 0 && (flat || Dot(face, faceNormals[other / 3]) >= cosCrease));
+
+					if (smooth)
+						sum += faceNormals[other / 3] * weights[other];
+				}
+
+				cornerNormals[c] = Length(sum) > 0.0f ? Normalize(sum) : face;
+			}
+
+			groupFirst = groupLast;
+		}
+
+		// Corners of this position with equal attribute and normal weld to the lowest of them
+		welded.assign(corners.begin() + first, corners.begin() + last);
+		std::sort(welded.begin(), welded.end(),
+			[&](uint32_t lhs, uint32_t rhs)
+			{
+				if (Attribute(lhs) != Attribute(rhs))
+					return Attribute(lhs) < Attribute(rhs);
+
+				const int order = memcmp(&cornerNormals[lhs], &cornerNormals[rhs], sizeof(float3));
+				return order != 0 ? order < 0 : lhs < rhs;
+			});
+
+		for (size_t i = 0; i < welded.size(); i++)
+		{
+			const uint32_t c        = welded[i];
+			const uint32_t previous = i ? welded[i - 1] : c;
+
+			const bool same = i && Attribute(previous) == Attribute(c) && !memcmp(&cornerNormals[previous], &cornerNormals[c], sizeof(float3));
+
+			representative[c] = same ? representative[previous] : c;
+		}
+
+		first = last;
+	}
+
+	// Vertices are numbered in order of first use
+	NormalMesh out;
+	out.indices.resize(cornerCount);
+
+	std::vector<uint32_t> vertexId(cornerCount, UINT32_MAX);
+
+	for (uint32_t c = 0; c < cornerCount; c++)
+	{
+		const uint32_t rep = representative[c];
+
+		if (vertexId[rep] == UINT32_MAX)
+		{
+			vertexId[rep] = (uint32_t)out.vertices.size();
+			out.vertices.push_back({ indices[c], Attribute(c), cornerNormals[c] });
+		}
+
+		out.indices[c] = vertexId[rep];
+	}
+
+	return out;
+}
+
+// One job per shape, largest first
+inline std::vector<NormalMesh> GenerateNormals(ThreadPool& threads, const float* positions, const std::span<const NormalInput> shapes, const NormalSettings& settings = {})
+{
+	std::vector<NormalMesh> meshes(shapes.size());
+	std::vector<size_t>     order(shapes.size());
+
+	std::iota(order.begin(), order.end(), size_t(0));
+	std::sort(order.begin(), order.end(),
+		[&](size_t lhs, size_t rhs) { return shapes[lhs].indices.size() > shapes[rhs].indices.size(); });
+
+	threads.ParallelFor(order.size(), 1,
+		[&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				meshes[order[i]] = GenerateNormals(positions, shapes[order[i]], settings);
+		});
+
+	return meshes;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "CommandBuffer.hpp"
+#include "Threading.hpp"
+
+#include <algorithm>
+#include <span>
+#include <vector>
+
+// Draw ranges recorded by workers into one buffer per chunk, merged in chunk order.
+// Chunks are fixed by count and grain size, so the merged stream is the same for any
+// thread count and equal to recording [0, count) serially.
+class ParallelRecorder
+{
+public:
+	// Record(CommandBuffer&, begin, end) records the draws of [begin, end) into the buffer,
+	// which are appended to out
+	template<typename RECORD>
+	void Record(ThreadPool& threads, const size_t count, const size_t grainSize, CommandBuffer& out, RECORD&& Record)
+	{
+		const size_t grain      = std::max<size_t>(1, grainSize);
+		const size_t chunkCount = (count + grain - 1) / grain;
+
+		if (chunks.size() < chunkCount)
+			chunks.resize(chunkCount);
+
+		threads.ParallelFor(chunkCount, 1,
+			[&](size_t begin, size_t end)
+			{
+				for (size_t chunk = begin; chunk < end; chunk++)
+				{
+					chunks[chunk].Clear();
+					Record(chunks[chunk], chunk * grain, std::min(count, (chunk + 1) * grain));
+				}
+			});
+
+		out.Append(threads, std::span<const CommandBuffer>{ chunks.data(), chunkCount });
+	}
+
+private:
+	std::vector<CommandBuffer> chunks;     // kept between frames for their capacity
+};
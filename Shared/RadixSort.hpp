@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Threading.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Stable LSD radix sort of keys together with a payload, 8 bits per pass. Each pass
+// histograms and scatters fixed chunks in parallel, chunk order keeps it stable and
+// independent of the thread count. Passes where all keys share the digit are skipped.
+template<typename KEY>
+void RadixSort(ThreadPool& threads, std::vector<KEY>& keys, std::vector<uint32_t>& values)
+{
+	constexpr size_t chunkSize = 16384;
+
+	const size_t count      = keys.size();
+	const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+	if (count < 2)
+		return;
+
+	std::vector<KEY>                    keyScratch(count);
+	std::vector<uint32_t>               valueScratch(count);
+	std::vector<std::array<size_t, 256>> histograms(chunkCount);
+
+	for (uint32_t shift = 0; shift < 8 * sizeof(KEY); shift += 8)
+	{
+		threads.ParallelFor(chunkCount, 1,
+			[&](size_t begin, size_t end)
+			{
+				for (size_t chunk = begin; chunk < end; chunk++)
+				{
+					auto& histogram = histograms[chunk];
+					histogram.fill(0);
+
+					const size_t last = std::min(count, (chunk + 1) * chunkSize);
+					for (size_t i = chunk * chunkSize; i < last; i++)
+						histogram[(keys[i] >> shift) & 0xff]++;
+				}
+			});
+
+		// Digit major, chunk minor offsets
+		size_t  total   = 0;
+		bool    skip    = false;
+
+		for (size_t digit = 0; digit < 256; digit++)
+		{
+			size_t digitCount = 0;
+
+			for (auto& histogram : histograms)
+			{
+				const size_t c = histogram[digit];
+				histogram[digit] = total;
+
+				total       += c;
+				digitCount  += c;
+			}
+
+			skip |= digitCount == count;
+		}
+
+		if (skip)
+			continue;
+
+		threads.ParallelFor(chunkCount, 1,
+			[&](size_t begin, size_t end)
+			{
+				for (size_t chunk = begin; chunk < end; chunk++)
+				{
+					auto& cursor = histograms[chunk];
+
+					const size_t last = std::min(count, (chunk + 1) * chunkSize);
+					for (size_t i = chunk * chunkSize; i < last; i++)
+					{
+						const size_t dst = cursor[(keys[i] >> shift) & 0xff]++;
+
+						keyScratch[dst]     = keys[i];
+						valueScratch[dst]   = values[i];
+					}
+				}
+			});
+
+		keys.swap(keyScratch);
+		values.swap(valueScratch);
+	}
+}
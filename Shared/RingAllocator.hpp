@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+// Suballocates a circular range of bytes for data the GPU reads a few frames later.
+// Allocations never straddle the end, the skipped tail counts towards the frame that
+// wrapped. Memory comes back a whole frame at a time, oldest first, once it retired.
+// No API calls, the fencing lives with the owner.
+class RingAllocator
+{
+public:
+	static constexpr size_t invalid = SIZE_MAX;
+
+	explicit RingAllocator(const size_t capacity = 0, const size_t alignment = 256) noexcept :
+		capacity{ capacity }, alignment{ std::max<size_t>(1, alignment) } {}
+
+	// Offset of size bytes rounded up to the alignment, invalid while frames in flight hold too much
+	size_t Allocate(const size_t size) noexcept
+	{
+		const size_t bytes = AlignUp(std::max<size_t>(1, size));
+
+		if (bytes > capacity)
+			return invalid;
+
+		size_t offset   = invalid;
+		size_t skipped  = 0;
+
+		// Free space is [head, capacity) + [0, tail) when empty or wrapped, [head, tail) otherwise
+		if (used == 0 || head > tail)
+		{
+			if (head + bytes <= capacity)
+				offset = head;
+			else if (bytes <= tail || (used == 0 && bytes <= capacity))
+			{
+				offset  = 0;
+				skipped = capacity - head;
+			}
+		}
+		else if (head < tail && head + bytes <= tail)
+			offset = head;
+
+		if (offset == invalid)
+			return invalid;
+
+		head        = (offset + bytes) % capacity;
+		used        += skipped + bytes;
+		frameBytes  += skipped + bytes;
+
+		return offset;
+	}
+
+	// Allocate that makes room while frames are in flight: WaitOldest() blocks until the
+	// oldest one completed and returns the newest completed frame. Invalid when size
+	// exceeds the ring or waiting frees nothing.
+	template<typename WAIT>
+	size_t Allocate(const size_t size, WAIT&& WaitOldest, size_t* waits = nullptr)
+	{
+		size_t      offset  = Allocate(size);
+		const bool  fits    = AlignUp(std::max<size_t>(1, size)) <= capacity;
+
+		while (offset == invalid && fits && !frames.empty())
+		{
+			const size_t inFlight = frames.size();
+
+			Retire(WaitOldest());
+
+			if (waits)
+				(*waits)++;
+
+			if (frames.size() == inFlight)
+				break;
+
+			offset = Allocate(size);
+		}
+
+		return offset;
+	}
+
+	// Everything allocated since the last call belongs to frame, ascending
+	void EndFrame(const uint64_t frame)
+	{
+		frames.push_back({ frame, head, frameBytes });
+		frameBytes = 0;
+	}
+
+	// Frees the frames up to and including completedFrame
+	void Retire(const uint64_t completedFrame) noexcept
+	{
+		while (!frames.empty() && frames.front().frame <= completedFrame)
+		{
+			tail    = frames.front().end;
+			used    -= frames.front().bytes;
+			frames.pop_front();
+		}
+	}
+
+	size_t Capacity()       const noexcept { return capacity; }
+	size_t Alignment()      const noexcept { return alignment; }
+	size_t Used()           const noexcept { return used; }
+	size_t FramesInFlight() const noexcept { return frames.size(); }
+
+	size_t AlignUp(const size_t size) const noexcept { return (size + alignment - 1) / alignment * alignment; }
+
+private:
+	struct Frame
+	{
+		uint64_t    frame   = 0;
+		size_t      end     = 0;    // head when the frame ended, the tail once it retires
+		size_t      bytes   = 0;
+	};
+
+	size_t              capacity    = 0;
+	size_t              alignment   = 1;
+	size_t              head        = 0;
+	size_t              tail        = 0;
+	size_t              used        = 0;
+	size_t              frameBytes  = 0;
+	std::deque<Frame>   frames;
+};
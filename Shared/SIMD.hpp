@@ -0,0 +1,83 @@
+#pragma once
+
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define SIMD_TARGET_AVX2
+#else
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+
+// AVX2 kernels are compiled alongside the SSE2 baseline and picked at runtime
+inline bool HasAVX2() noexcept
+{
+	static const bool supported = []
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+
+		if (info[0] < 7)
+			return false;
+
+		__cpuid(info, 1);
+		const bool osxsave  = (info[2] & (1 << 27)) != 0;
+		const bool fma      = (info[2] & (1 << 12)) != 0;
+
+		__cpuidex(info, 7, 0);
+		const bool avx2 = (info[1] & (1 << 5)) != 0;
+
+		return osxsave && fma && avx2 && (_xgetbv(0) & 6) == 6;
+#else
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+	}();
+
+	return supported;
+}
+
+// Loads four xyz triplets (12 floats) and transposes them to x, y, z lanes
+inline void LoadTransposed4(const float* xyz, __m128& x, __m128& y, __m128& z) noexcept
+{
+	const __m128 a = _mm_loadu_ps(xyz + 0);    // x0 y0 z0 x1
+	const __m128 b = _mm_loadu_ps(xyz + 4);    // y1 z1 x2 y2
+	const __m128 c = _mm_loadu_ps(xyz + 8);    // z2 x3 y3 z3
+
+	const __m128 x0 = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 0, 0));
+	const __m128 x1 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2));
+	const __m128 y0 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1));
+	const __m128 y1 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3));
+	const __m128 z0 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2));
+	const __m128 z1 = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0));
+
+	x = _mm_shuffle_ps(x0, x1, _MM_SHUFFLE(2, 0, 2, 0));
+	y = _mm_shuffle_ps(y0, y1, _MM_SHUFFLE(2, 0, 2, 0));
+	z = _mm_shuffle_ps(z0, z1, _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+inline __m128 Abs(const __m128 v) noexcept
+{
+	return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+}
+
+// Magnitude of mag with the sign of sign, +0 counts as positive
+inline __m128 CopySign(const __m128 mag, const __m128 sign) noexcept
+{
+	const __m128 mask = _mm_set1_ps(-0.0f);
+	return _mm_or_ps(_mm_andnot_ps(mask, mag), _mm_and_ps(mask, sign));
+}
+
+inline __m128 Select(const __m128 mask, const __m128 a, const __m128 b) noexcept
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// Packs the low 16 bits of each 32 bit lane, without saturation
+inline __m128i PackLow16(const __m128i a, const __m128i b) noexcept
+{
+	const __m128i sa = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+	const __m128i sb = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+
+	return _mm_packs_epi32(sa, sb);
+}
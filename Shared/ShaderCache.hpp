@@ -0,0 +1,277 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+// Compiled shaders kept on disk, keyed by a hash of everything the compiler sees: the
+// source and its absolute path, which includes resolve against, the entry point,
+// profile, flags and defines. Each entry also holds the hash of
+// every file the source included, so an edited include makes it stale. Compiling sits
+// behind ShaderCompiler, the cache itself makes no API calls.
+
+struct ShaderDefine
+{
+	std::string name;
+	std::string value;
+};
+
+struct ShaderRequest
+{
+	std::filesystem::path       file;
+	std::string                 entryPoint  = "main";
+	std::string                 profile;                // e.g. vs_5_0
+	uint32_t                    flags       = 0;        // D3DCOMPILE_*
+	std::vector<ShaderDefine>   defines;
+};
+
+class ShaderCompiler
+{
+public:
+	virtual ~ShaderCompiler() = default;
+
+	// Bytecode for the source of request.file, includes receives every file the source
+	// opened. False on errors, described in errors.
+	virtual bool Compile(const ShaderRequest& request, std::string_view source, std::vector<uint8_t>& bytecode,
+		std::vector<std::filesystem::path>& includes, std::string& errors) = 0;
+};
+
+class ShaderCache
+{
+public:
+	ShaderCache(std::filesystem::path directory, ShaderCompiler& compiler)
+		: directory{ std::move(directory) }, compiler{ compiler } {}
+
+	// Bytecode from the cache, compiling and storing it on a miss. False if the source
+	// could not be read or did not compile, then errors holds the compiler output.
+	bool Load(const ShaderRequest& request, std::vector<uint8_t>& bytecode, std::string* errors = nullptr)
+	{
+		std::string source;
+
+		if (!ReadFile(request.file, source))
+		{
+			failures++;
+			return false;
+		}
+
+		const uint64_t  key     = Key(request, source);
+		const auto      path    = EntryPath(key);
+
+		if (ReadEntry(path, key, bytecode))
+		{
+			hits++;
+			return true;
+		}
+
+		std::vector<std::filesystem::path>  includes;
+		std::string                         output;
+
+		if (!compiler.Compile(request, source, bytecode, includes, output))
+		{
+			if (errors)
+				*errors = std::move(output);
+
+			failures++;
+			return false;
+		}
+
+		// A cache that can't be written only costs the next run a compile
+		WriteEntry(path, key, includes, bytecode);
+		misses++;
+
+		return true;
+	}
+
+	static uint64_t Key(const ShaderRequest& request, const std::string_view source)
+	{
+		std::error_code error;
+
+		const auto absolute = std::filesystem::absolute(request.file, error);
+		const auto file     = (error ? request.file : absolute).lexically_normal().generic_u8string();
+
+		uint64_t hash = offsetBasis;
+
+		hash = Hash(hash, source);
+		hash = Hash(hash, std::string_view{ reinterpret_cast<const char*>(file.data()), file.size() });
+		hash = Hash(hash, request.entryPoint);
+		hash = Hash(hash, request.profile);
+		hash = Hash(hash, &request.flags, sizeof(request.flags));
+
+		for (const auto& define : request.defines)
+		{
+			hash = Hash(hash, define.name);
+			hash = Hash(hash, define.value);
+		}
+
+		return hash;
+	}
+
+	size_t Hits()       const noexcept { return hits; }
+	size_t Misses()     const noexcept { return misses; }      // compiled and stored
+	size_t Failures()   const noexcept { return failures; }
+
+private:
+	static constexpr uint32_t magic         = 0x31434853;   // SHC1
+	static constexpr uint64_t offsetBasis   = 0xCBF29CE484222325ull;
+	static constexpr uint64_t includeSize   = sizeof(uint32_t) + sizeof(uint64_t);    // smallest include record, an empty path
+
+	// FNV-1a, strings with their length so neighbouring fields can't run together
+	static uint64_t Hash(uint64_t hash, const void* data, const size_t size) noexcept
+	{
+		const auto bytes = static_cast<const uint8_t*>(data);
+
+		for (size_t i = 0; i < size; i++)
+			hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+
+		return hash;
+	}
+
+	static uint64_t Hash(uint64_t hash, const std::string_view text) noexcept
+	{
+		const uint64_t size = text.size();
+
+		hash = Hash(hash, &size, sizeof(size));
+		return Hash(hash, text.data(), text.size());
+	}
+
+	static bool ReadFile(const std::filesystem::path& path, std::string& out)
+	{
+		std::ifstream stream{ path, std::ios::binary };
+		if (!stream)
+			return false;
+
+		out.assign(std::istreambuf_iterator<char>{ stream }, std::istreambuf_iterator<char>{});
+		return !stream.bad();
+	}
+
+	// 0 for a missing file, which then never matches
+	static uint64_t HashFile(const std::filesystem::path& path)
+	{
+		std::string content;
+		return ReadFile(path, content) ? Hash(offsetBasis, content) : 0;
+	}
+
+	std::filesystem::path EntryPath(const uint64_t key) const
+	{
+		char name[24];
+		snprintf(name, sizeof(name), "%016llx.shader", (unsigned long long)key);
+
+		return directory / name;
+	}
+
+	// Magic, key, include count, per include its path length, path and hash, then the bytecode size and bytecode.
+	// Sizes are checked against what is left of the file, a truncated or corrupt entry is a miss.
+	static bool ReadEntry(const std::filesystem::path& path, const uint64_t key, std::vector<uint8_t>& bytecode)
+	{
+		std::error_code error;
+
+		uint64_t remaining = std::filesystem::file_size(path, error);
+		if (error)
+			return false;
+
+		std::ifstream stream{ path, std::ios::binary };
+		if (!stream)
+			return false;
+
+		auto Read = [&](void* data, const uint64_t size)
+		{
+			if (size > remaining)
+				return false;
+
+			remaining -= size;
+			return bool(stream.read(static_cast<char*>(data), std::streamsize(size)));
+		};
+
+		uint32_t fileMagic      = 0;
+		uint64_t fileKey        = 0;
+		uint32_t includeCount   = 0;
+
+		if (!Read(&fileMagic, sizeof(fileMagic)) || fileMagic != magic || !Read(&fileKey, sizeof(fileKey)) || fileKey != key ||
+			!Read(&includeCount, sizeof(includeCount)) || includeCount > remaining / includeSize)
+			return false;
+
+		for (uint32_t i = 0; i < includeCount; i++)
+		{
+			uint32_t        length  = 0;
+			uint64_t        hash    = 0;
+			std::u8string   include;
+
+			if (!Read(&length, sizeof(length)) || length > remaining)
+				return false;
+
+			include.resize(length);
+
+			if (!Read(include.data(), length) || !Read(&hash, sizeof(hash)))
+				return false;
+
+			if (HashFile(std::filesystem::path{ include }) != hash)
+				return false;
+		}
+
+		// The bytecode ends the entry
+		uint64_t size = 0;
+		if (!Read(&size, sizeof(size)) || size != remaining)
+			return false;
+
+		bytecode.resize(size);
+		return Read(bytecode.data(), size);
+	}
+
+	// Written beside the entry and renamed over it, readers never see half an entry
+	static bool WriteEntry(const std::filesystem::path& path, const uint64_t key, const std::vector<std::filesystem::path>& includes, const std::vector<uint8_t>& bytecode)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(path.parent_path(), error);
+
+		auto temporary = path;
+		temporary += ".tmp";
+
+		{
+			std::ofstream stream{ temporary, std::ios::binary | std::ios::trunc };
+			if (!stream)
+				return false;
+
+			auto Write = [&](const void* data, const size_t size) { stream.write(static_cast<const char*>(data), size); };
+
+			const uint32_t includeCount = uint32_t(includes.size());
+			const uint64_t size         = bytecode.size();
+
+			Write(&magic, sizeof(magic));
+			Write(&key, sizeof(key));
+			Write(&includeCount, sizeof(includeCount));
+
+			for (const auto& include : includes)
+			{
+				const auto      text    = include.u8string();
+				const uint32_t  length  = uint32_t(text.size());
+				const uint64_t  hash    = HashFile(include);
+
+				Write(&length, sizeof(length));
+				Write(text.data(), length);
+				Write(&hash, sizeof(hash));
+			}
+
+			Write(&size, sizeof(size));
+			Write(bytecode.data(), bytecode.size());
+
+			if (!stream.flush())
+				return false;
+		}
+
+		std::filesystem::rename(temporary, path, error);
+		return !error;
+	}
+
+	std::filesystem::path   directory;
+	ShaderCompiler&         compiler;
+	size_t                  hits        = 0;
+	size_t                  misses      = 0;
+	size_t                  failures    = 0;
+};
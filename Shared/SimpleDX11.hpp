@@ -1,19 +1,29 @@
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
 #include <d3d11.h>
 #include <DirectXMath.h>
 #include <d3dcompiler.h>
 #include <tiny_obj_loader.h>
 
+#include "Geometry.hpp"
+#include "ShaderCache.hpp"
+#include "TransientTextures.hpp"
+
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "d3dcompiler.lib")
 
+#include <cstdint>
 #include <filesystem>
+#include <memory>
+#include <vector>
 
 struct VShader
 {
-	ID3D11VertexShader* shader      = nullptr;
-	ID3DBlob*           blob        = nullptr;
-	char*               shaderFile  = nullptr;
-	size_t              bufferSize  = 0;
+	ID3D11VertexShader*     shader      = nullptr;
+	ID3DBlob*               blob        = nullptr;
+	std::vector<uint8_t>    bytecode;               // without a blob, from the cache or a .cso
 	
 	~VShader()
 	{
@@ -22,23 +32,20 @@ struct VShader
 
 		if (blob)
 			blob->Release();
-
-		if (shaderFile)
-			free(shaderFile);
 	}
 
-	void*   ByteCode()      const 
+	const void* ByteCode()  const 
 	{
 		if(blob)
 			return blob->GetBufferPointer();
-		return shaderFile;
+		return bytecode.data();
 	}
 	
 	size_t  ByteCodeSize()  const 
 	{ 
 		if (blob)
 			return blob->GetBufferSize(); 
-		return bufferSize;
+		return bytecode.size();
 	}
 
 	operator ID3D11VertexShader* () const { return shader; }
@@ -71,6 +78,163 @@ struct PShader
 	operator ID3D11PixelShader* () { return shader; }
 };
 
+// Formats used for render targets, others count as 4 bytes
+inline uint32_t BytesPerTexel(const DXGI_FORMAT format) noexcept
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:    return 16;
+	case DXGI_FORMAT_R32G32B32_FLOAT:       return 12;
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+	case DXGI_FORMAT_R16G16B16A16_UNORM:
+	case DXGI_FORMAT_R32G32_FLOAT:          return 8;
+	case DXGI_FORMAT_R16_FLOAT:
+	case DXGI_FORMAT_R16_UINT:              return 2;
+	case DXGI_FORMAT_R8_UNORM:              return 1;
+	default:                                return 4;
+	}
+}
+
+inline TextureKey MakeTextureKey(const UINT width, const UINT height, const DXGI_FORMAT format, const UINT bindFlags, const UINT sampleCount = 1)
+{
+	TextureKey key;
+	key.width           = width;
+	key.height          = height;
+	key.format          = format;
+	key.bindFlags       = bindFlags;
+	key.sampleCount     = sampleCount;
+	key.bytesPerTexel   = BytesPerTexel(format);
+
+	return key;
+}
+
+// Bytecode of a .cso the build compiled, false without a file or if it can't be read
+inline bool ReadCompiledShader(const char* file, std::vector<uint8_t>& bytecode)
+{
+	if (!file)
+		return false;
+
+	std::ifstream stream{ file, std::ios::binary };
+	if (!stream)
+		return false;
+
+	bytecode.assign(std::istreambuf_iterator<char>{ stream }, std::istreambuf_iterator<char>{});
+	return !bytecode.empty();
+}
+
+// D3DCompile behind the ShaderCache. Includes resolve relative to the including file
+// and are reported back, so the cache can tell when one of them changed.
+class D3DShaderCompiler : public ShaderCompiler
+{
+public:
+	bool Compile(const ShaderRequest& request, std::string_view source, std::vector<uint8_t>& bytecode,
+		std::vector<std::filesystem::path>& includes, std::string& errors) override
+	{
+		std::vector<D3D_SHADER_MACRO> macros;
+		for (const auto& define : request.defines)
+			macros.push_back({ define.name.c_str(), define.value.c_str() });
+
+		macros.push_back({ nullptr, nullptr });
+
+		IncludeHandler  handler{ request.file.parent_path(), includes };
+		ID3DBlob*       blob        = nullptr;
+		ID3DBlob*       errorBlob   = nullptr;
+
+		const auto name = request.file.string();
+		const auto hr   = D3DCompile(source.data(), source.size(), name.c_str(), macros.data(), &handler,
+			request.entryPoint.c_str(), request.profile.c_str(), request.flags, 0, &blob, &errorBlob);
+
+		if (errorBlob)
+		{
+			errors.assign(static_cast<const char*>(errorBlob->GetBufferPointer()), errorBlob->GetBufferSize());
+			errorBlob->Release();
+		}
+
+		if (FAILED(hr) || !blob)
+		{
+			if (blob)
+				blob->Release();
+
+			return false;
+		}
+
+		const auto code = static_cast<const uint8_t*>(blob->GetBufferPointer());
+		bytecode.assign(code, code + blob->GetBufferSize());
+		blob->Release();
+
+		return true;
+	}
+
+private:
+	struct IncludeHandler : ID3DInclude
+	{
+		struct File
+		{
+			std::string             content;
+			std::filesystem::path   directory;
+		};
+
+		IncludeHandler(std::filesystem::path directory, std::vector<std::filesystem::path>& includes)
+			: directory{ std::move(directory) }, includes{ includes } {}
+
+		HRESULT STDMETHODCALLTYPE Open(D3D_INCLUDE_TYPE, LPCSTR fileName, LPCVOID parentData, LPCVOID* data, UINT* bytes) override
+		{
+			// Nested includes are relative to their parent, the others to the source
+			auto base = directory;
+			for (const auto& file : open)
+			{
+				if (file->content.data() == parentData)
+					base = file->directory;
+			}
+
+			const auto      path = base / fileName;
+			std::ifstream   stream{ path, std::ios::binary };
+
+			if (!stream)
+				return E_FAIL;
+
+			auto file = std::make_unique<File>();
+			file->content.assign(std::istreambuf_iterator<char>{ stream }, std::istreambuf_iterator<char>{});
+			file->directory = path.parent_path();
+
+			*data   = file->content.data();
+			*bytes  = UINT(file->content.size());
+
+			includes.push_back(path);
+			open.push_back(std::move(file));
+
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE Close(LPCVOID data) override
+		{
+			std::erase_if(open, [&](const auto& file) { return file->content.data() == data; });
+			return S_OK;
+		}
+
+		std::filesystem::path                   directory;
+		std::vector<std::filesystem::path>&     includes;
+		std::vector<std::unique_ptr<File>>      open;
+	};
+};
+
+// Client size from the last WM_SIZE, applied by DX_Context::HandleResize
+struct WindowResize
+{
+	UINT    width   = 0;
+	UINT    height  = 0;
+	bool    pending = false;
+};
+
+inline WindowResize windowResize;
+
+enum class ResizeResult
+{
+	Unchanged,  // nothing pending or the same size, the context state is untouched
+	Resized,
+	Failed,     // ResizeBuffers failed, the old size stays but the context state was cleared too
+};
+
 struct DX_Context
 {
 	DX_Context() = default;
@@ -79,21 +243,42 @@ struct DX_Context
 	DX_Context&     operator =  (const DX_Context&) = delete;
 
 	DX_Context  (DX_Context&& rhs) : 
-		swapChain   { std::exchange(rhs.swapChain, nullptr) },
-		device      { std::exchange(rhs.device,  nullptr)    },
-		context     { std::exchange(rhs.context, nullptr)   } {}
+		swapChain       { std::exchange(rhs.swapChain, nullptr) },
+		device          { std::exchange(rhs.device,  nullptr)    },
+		context         { std::exchange(rhs.context, nullptr)   },
+		width           { rhs.width },
+		height          { rhs.height },
+		backBuffer      { std::exchange(rhs.backBuffer, nullptr) },
+		backBufferView  { std::exchange(rhs.backBufferView, nullptr) },
+		depthBuffer     { std::exchange(rhs.depthBuffer, nullptr) },
+		depthView       { std::exchange(rhs.depthView, nullptr) } {}
 
 	DX_Context&     operator =  (DX_Context&& rhs)
 	{
-		swapChain   = std::exchange(rhs.swapChain, nullptr);
-		device      = std::exchange(rhs.device,  nullptr);
-		context     = std::exchange(rhs.context, nullptr);  
+		swapChain       = std::exchange(rhs.swapChain, nullptr);
+		device          = std::exchange(rhs.device,  nullptr);
+		context         = std::exchange(rhs.context, nullptr);  
+		width           = rhs.width;
+		height          = rhs.height;
+		backBuffer      = std::exchange(rhs.backBuffer, nullptr);
+		backBufferView  = std::exchange(rhs.backBufferView, nullptr);
+		depthBuffer     = std::exchange(rhs.depthBuffer, nullptr);
+		depthView       = std::exchange(rhs.depthView, nullptr);
 	}
 
 	IDXGISwapChain*         swapChain;
 	ID3D11Device*           device;
 	ID3D11DeviceContext*    context = nullptr;
 
+	UINT                    width   = 0;
+	UINT                    height  = 0;
+
+	// Size dependent views, created on first use and again after a resize
+	ID3D11Resource*         backBuffer      = nullptr;
+	ID3D11RenderTargetView* backBufferView  = nullptr;
+	ID3D11Texture2D*        depthBuffer     = nullptr;
+	ID3D11DepthStencilView* depthView       = nullptr;
+
 	ID3D11Buffer* CreateConstantBuffer(size_t constantBuffer)
 	{
 		ID3D11Buffer* constants;
@@ -110,19 +295,80 @@ struct DX_Context
 		return constants;
 	}        
 	
+	// With the discard swap effect buffer 0 is always the back buffer, so one view serves
+	// every frame. Owned by the context, not to be released.
 	ID3D11RenderTargetView* GetBackBufferView()
 	{
-		ID3D11Resource* currentBuffer;
+		if (backBufferView)
+			return backBufferView;
 
-		swapChain->GetBuffer(0, IID_PPV_ARGS(&currentBuffer));
+		swapChain->GetBuffer(0, IID_PPV_ARGS(&backBuffer));
 
-		ID3D11RenderTargetView* renderTargetView;
 		D3D11_RENDER_TARGET_VIEW_DESC desc;
 		desc.ViewDimension      = D3D11_RTV_DIMENSION_TEXTURE2DMS;
 		desc.Format             = DXGI_FORMAT_R16G16B16A16_FLOAT;
-		device->CreateRenderTargetView(currentBuffer, &desc, &renderTargetView);
+		device->CreateRenderTargetView(backBuffer, &desc, &backBufferView);
 
-		return renderTargetView;
+		return backBufferView;
+	}
+
+	// Depth buffer of the back buffer's size, owned by the context
+	ID3D11DepthStencilView* GetDepthView()
+	{
+		if (!depthView)
+		{
+			depthBuffer = CreateDepthBuffer(width, height);
+			depthView   = CreateDeptStencilView(depthBuffer);
+		}
+
+		return depthView;
+	}
+
+	// Applies the size of the last WM_SIZE. Anything but Unchanged cleared the context
+	// state, since nothing may reference the back buffer during ResizeBuffers.
+	ResizeResult HandleResize()
+	{
+		if (!windowResize.pending)
+			return ResizeResult::Unchanged;
+
+		windowResize.pending = false;
+
+		const UINT newWidth     = windowResize.width;
+		const UINT newHeight    = windowResize.height;
+
+		if (!newWidth || !newHeight || (newWidth == width && newHeight == height))
+			return ResizeResult::Unchanged;
+
+		context->ClearState();
+		ReleaseViews();
+
+		if (FAILED(swapChain->ResizeBuffers(0, newWidth, newHeight, DXGI_FORMAT_UNKNOWN, 0)))
+			return ResizeResult::Failed;
+
+		width   = newWidth;
+		height  = newHeight;
+
+		return ResizeResult::Resized;
+	}
+
+	void ReleaseViews()
+	{
+		if (backBufferView)
+			backBufferView->Release();
+
+		if (backBuffer)
+			backBuffer->Release();
+
+		if (depthView)
+			depthView->Release();
+
+		if (depthBuffer)
+			depthBuffer->Release();
+
+		backBuffer      = nullptr;
+		backBufferView  = nullptr;
+		depthView       = nullptr;
+		depthBuffer     = nullptr;
 	}
 
 	VShader  LoadVertexShader(LPCWCHAR file, const char* entryPoint)
@@ -162,6 +408,44 @@ struct DX_Context
 		return { shader };
 	}
 
+	// Through the cache, compiling only when the source, an include, the entry point or the defines changed.
+	// Where the source can't be read or compiled the bytecode comes from the compiled file, if given.
+	VShader  LoadVertexShader(ShaderCache& cache, const std::filesystem::path& file, const char* entryPoint, std::vector<ShaderDefine> defines = {}, const char* compiled = nullptr)
+	{
+		std::vector<uint8_t> bytecode;
+		if (!cache.Load({ file, entryPoint, "vs_5_0", D3DCOMPILE_DEBUG, std::move(defines) }, bytecode) && !ReadCompiledShader(compiled, bytecode))
+			return {};
+
+		ID3D11VertexShader* shader = nullptr;
+		device->CreateVertexShader(bytecode.data(), bytecode.size(), nullptr, &shader);
+
+		return { shader, nullptr, std::move(bytecode) };
+	}
+
+	GShader  LoadGeometryShader(ShaderCache& cache, const std::filesystem::path& file, const char* entryPoint, std::vector<ShaderDefine> defines = {}, const char* compiled = nullptr)
+	{
+		std::vector<uint8_t> bytecode;
+		if (!cache.Load({ file, entryPoint, "gs_5_0", D3DCOMPILE_DEBUG, std::move(defines) }, bytecode) && !ReadCompiledShader(compiled, bytecode))
+			return {};
+
+		ID3D11GeometryShader* shader = nullptr;
+		device->CreateGeometryShader(bytecode.data(), bytecode.size(), nullptr, &shader);
+
+		return { shader };
+	}
+
+	PShader  LoadPixelShader(ShaderCache& cache, const std::filesystem::path& file, const char* entryPoint, std::vector<ShaderDefine> defines = {}, const char* compiled = nullptr)
+	{
+		std::vector<uint8_t> bytecode;
+		if (!cache.Load({ file, entryPoint, "ps_5_0", 0, std::move(defines) }, bytecode) && !ReadCompiledShader(compiled, bytecode))
+			return {};
+
+		ID3D11PixelShader* shader = nullptr;
+		device->CreatePixelShader(bytecode.data(), bytecode.size(), nullptr, &shader);
+
+		return { shader };
+	}
+
 	GShader  LoadCompiledGeometryShader(const char* file)
 	{
 		const auto fileSize = std::filesystem::file_size(file);
@@ -180,18 +464,13 @@ struct DX_Context
 
 	VShader  LoadCompiledVertexShader(const char* file)
 	{
-		const auto fileSize = std::filesystem::file_size(file);
-		char* buffer = (char*)malloc(fileSize);
-
-		FILE* f = nullptr;
-		fopen_s(&f, file, "rb");
-		auto readSize = fread(buffer, 1, fileSize, f);
-		fclose(f);
+		std::vector<uint8_t> bytecode;
+		ReadCompiledShader(file, bytecode);
 
 		ID3D11VertexShader* shader = nullptr;
-		device->CreateVertexShader(buffer, fileSize, nullptr, &shader);
+		device->CreateVertexShader(bytecode.data(), bytecode.size(), nullptr, &shader);
 
-		return { shader, nullptr, buffer, fileSize };
+		return { shader, nullptr, std::move(bytecode) };
 	}
 
 	PShader  LoadCompiledPixelShader(const char* file)
@@ -241,7 +520,7 @@ struct DX_Context
 		return view;
 	}
 
-	ID3D11Buffer* CreateVertexBuffer(void* buffer, const size_t byteSize)
+	ID3D11Buffer* CreateVertexBuffer(const void* buffer, const size_t byteSize)
 	{
 		D3D11_BUFFER_DESC   bufferDesc;
 		bufferDesc.ByteWidth            = (UINT)byteSize;
@@ -262,7 +541,22 @@ struct DX_Context
 		return vertexBuffer;
 	}
 
-	ID3D11Buffer* CreateIndexBuffer(void* buffer, const size_t byteSize)
+	// Rewritten every frame with UpdateDiscard, e.g. per instance data
+	ID3D11Buffer* CreateDynamicVertexBuffer(const size_t byteSize)
+	{
+		D3D11_BUFFER_DESC   bufferDesc = { 0 };
+		bufferDesc.ByteWidth            = (UINT)byteSize;
+		bufferDesc.Usage                = D3D11_USAGE_DYNAMIC;
+		bufferDesc.BindFlags            = D3D11_BIND_FLAG::D3D11_BIND_VERTEX_BUFFER;
+		bufferDesc.CPUAccessFlags       = D3D11_CPU_ACCESS_WRITE;
+
+		ID3D11Buffer* vertexBuffer;
+		auto res = device->CreateBuffer(&bufferDesc, nullptr, &vertexBuffer);
+
+		return vertexBuffer;
+	}
+
+	ID3D11Buffer* CreateIndexBuffer(const void* buffer, const size_t byteSize)
 	{
 
 		D3D11_BUFFER_DESC   bufferDesc = { 0 };
@@ -327,6 +621,42 @@ struct DX_Context
 		return texture;
 	}
 
+	// Uninitialized texture for a TransientPool slot, a volume when depth is above 1
+	ID3D11Resource* CreateTransientTexture(const TextureKey& key)
+	{
+		if (key.depth > 1)
+		{
+			D3D11_TEXTURE3D_DESC desc = { 0 };
+			desc.Format             = (DXGI_FORMAT)key.format;
+			desc.BindFlags          = key.bindFlags;
+			desc.Height             = key.height;
+			desc.Width              = key.width;
+			desc.Depth              = key.depth;
+			desc.MipLevels          = key.mipLevels;
+			desc.Usage              = D3D11_USAGE_DEFAULT;
+
+			ID3D11Texture3D* texture = nullptr;
+			device->CreateTexture3D(&desc, nullptr, &texture);
+
+			return texture;
+		}
+
+		D3D11_TEXTURE2D_DESC desc = { 0 };
+		desc.Format             = (DXGI_FORMAT)key.format;
+		desc.ArraySize          = key.arraySize;
+		desc.BindFlags          = key.bindFlags;
+		desc.Height             = key.height;
+		desc.Width              = key.width;
+		desc.SampleDesc         = { key.sampleCount, 0 };
+		desc.MipLevels          = key.mipLevels;
+		desc.Usage              = D3D11_USAGE_DEFAULT;
+
+		ID3D11Texture2D* texture = nullptr;
+		device->CreateTexture2D(&desc, nullptr, &texture);
+
+		return texture;
+	}
+
 	template<typename TY>
 	void UpdateDiscard(ID3D11Resource* buffer, const TY& values)
 	{
@@ -335,10 +665,21 @@ struct DX_Context
 		memcpy(sr.pData, &values, sizeof(values));
 		context->Unmap(buffer, 0);
 	}
+
+	void UpdateDiscard(ID3D11Resource* buffer, const void* data, const size_t byteSize)
+	{
+		D3D11_MAPPED_SUBRESOURCE sr = { 0 };
+		context->Map(buffer, 0, D3D11_MAP::D3D11_MAP_WRITE_DISCARD, 0, &sr);
+		memcpy(sr.pData, data, byteSize);
+		context->Unmap(buffer, 0);
+	}
 };
 
 inline LRESULT CALLBACK WindowProcess(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 {
+	if (message == WM_SIZE && wParam != SIZE_MINIMIZED)
+		windowResize = { LOWORD(lParam), HIWORD(lParam), true };
+
 	return DefWindowProc(hWnd, message, wParam, lParam);
 }
 
@@ -422,6 +763,8 @@ inline DX_Context CreateDX(uint32_t width = 800, uint32_t height = 600)
 	out.context     = context;
 	out.device      = device;
 	out.swapChain   = swapChain;
+	out.width       = width;
+	out.height      = height;
 
 
 	ShowWindow(windowHndl, SW_SHOW);
@@ -463,6 +806,43 @@ struct Camera
 		return DirectX::XMMatrixTranspose(p * v);
 	}
 
+	// Pixels per unit of object space size at unit distance
+	float GetProjectionScale(const float viewportHeight) const noexcept
+	{
+		return viewportHeight / (2.0f * std::tan(fov / 2.0f));
+	}
+
+	float3 GetPosition() const noexcept
+	{
+		DirectX::XMFLOAT3 xyz;
+		DirectX::XMStoreFloat3(&xyz, p);
+
+		return { xyz.x, xyz.y, xyz.z };
+	}
+
+	Frustum GetFrustum(DirectX::FXMMATRIX world = DirectX::XMMatrixIdentity()) const noexcept
+	{
+		DirectX::XMFLOAT4X4 wpv;
+		DirectX::XMStoreFloat4x4(&wpv, world * GetPV());
+
+		return ExtractFrustum(wpv.m);
+	}
+
+	// Ray through a point in normalized device coordinates, in the space world maps from
+	Ray GetRay(const float ndcX, const float ndcY, DirectX::FXMMATRIX world = DirectX::XMMatrixIdentity()) const noexcept
+	{
+		const auto inverse  = DirectX::XMMatrixInverse(nullptr, world * GetPV());
+		const auto nearPt   = DirectX::XMVector3TransformCoord(DirectX::XMVectorSet(ndcX, ndcY, 0.0f, 1.0f), inverse);
+		const auto farPt    = DirectX::XMVector3TransformCoord(DirectX::XMVectorSet(ndcX, ndcY, 1.0f, 1.0f), inverse);
+
+		DirectX::XMFLOAT3 origin;
+		DirectX::XMFLOAT3 direction;
+		DirectX::XMStoreFloat3(&origin, nearPt);
+		DirectX::XMStoreFloat3(&direction, DirectX::XMVector3Normalize(DirectX::XMVectorSubtract(farPt, nearPt)));
+
+		return { { origin.x, origin.y, origin.z }, { direction.x, direction.y, direction.z } };
+	}
+
 	void Yaw(float a)
 	{
 	   const auto y = DirectX::XMQuaternionRotationAxis(
@@ -0,0 +1,458 @@
+#pragma once
+
+#include "Geometry.hpp"
+#include "Threading.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+// Symmetric 4x4 error quadric, weighted by triangle area
+struct Quadric
+{
+	double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+	double      a11 = 0, a12 = 0, a13 = 0;
+	double           a22 = 0, a23 = 0;
+	double                a33 = 0;
+	double weight = 0;
+
+	static Quadric FromPlane(const float3 n, const float d, const float w) noexcept
+	{
+		Quadric q;
+		q.a00 = w * n.x * n.x; q.a01 = w * n.x * n.y; q.a02 = w * n.x * n.z; q.a03 = w * n.x * d;
+		q.a11 = w * n.y * n.y; q.a12 = w * n.y * n.z; q.a13 = w * n.y * d;
+		q.a22 = w * n.z * n.z; q.a23 = w * n.z * d;
+		q.a33 = w * d * d;
+		q.weight = w;
+
+		return q;
+	}
+
+	Quadric& operator += (const Quadric& rhs) noexcept
+	{
+		a00 += rhs.a00; a01 += rhs.a01; a02 += rhs.a02; a03 += rhs.a03;
+		a11 += rhs.a11; a12 += rhs.a12; a13 += rhs.a13;
+		a22 += rhs.a22; a23 += rhs.a23;
+		a33 += rhs.a33;
+		weight += rhs.weight;
+
+		return *this;
+	}
+
+	// Area weighted squared distance of p to the accumulated planes
+	double Evaluate(const float3 p) const noexcept
+	{
+		const double x = p.x, y = p.y, z = p.z;
+
+		const double r =
+			a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x +
+			a11 * y * y + 2 * a12 * y * z + 2 * a13 * y +
+			a22 * z * z + 2 * a23 * z +
+			a33;
+
+		return std::max(r, 0.0);
+	}
+};
+
+struct SimplifyOptions
+{
+	size_t  targetIndexCount    = 0;
+	float   targetError         = FLT_MAX;  // object space distance
+	bool    preserveBorder      = true;
+};
+
+struct SimplifyResult
+{
+	std::vector<uint32_t>   indices;
+	float                   error = 0.0f;  // object space distance
+};
+
+// Half-edge collapse simplifier. Vertices are never moved, the result indexes the
+// source vertex buffer so LODs can share it. Vertices on open borders and on
+// attribute seams (several vertices at one position) are locked. Scratch is sized by
+// vertexCount, pass the mesh's own vertices rather than a large shared buffer.
+inline SimplifyResult Simplify(const float* positions, const size_t vertexCount, const uint32_t* indices, const size_t indexCount, const SimplifyOptions& options)
+{
+	assert(indexCount % 3 == 0);
+
+	SimplifyResult out;
+	out.indices.assign(indices, indices + indexCount);
+
+	if (indexCount <= options.targetIndexCount)
+		return out;
+
+	auto Position = [&](const uint32_t v) { return LoadFloat3(positions + 3 * v); };
+
+	// Canonical vertex per position, topology is tracked on these
+	std::vector<uint32_t> canonical(vertexCount);
+	{
+		struct Hash
+		{
+			size_t operator () (const float3& p) const noexcept
+			{
+				uint32_t h[3];
+				memcpy(h, &p, sizeof(h));
+				return (h[0] * 73856093u) ^ (h[1] * 19349663u) ^ (h[2] * 83492791u);
+			}
+		};
+
+		struct Equal
+		{
+			bool operator () (const float3& a, const float3& b) const noexcept
+			{
+				return a.x == b.x && a.y == b.y && a.z == b.z;
+			}
+		};
+
+		std::unordered_map<float3, uint32_t, Hash, Equal> lookup;
+		lookup.reserve(vertexCount);
+
+		for (uint32_t v = 0; v < vertexCount; v++)
+			canonical[v] = lookup.try_emplace(Position(v), v).first->second;
+	}
+
+	std::vector<uint8_t> locked(vertexCount, 0);
+
+	for (uint32_t v = 0; v < vertexCount; v++)
+	{
+		if (canonical[v] != v)
+			locked[v] = locked[canonical[v]] = 1;
+	}
+
+	if (options.preserveBorder)
+	{
+		std::unordered_map<uint64_t, uint32_t> edgeUse;
+		edgeUse.reserve(indexCount);
+
+		auto Key = [&](uint32_t a, uint32_t b)
+		{
+			a = canonical[a];
+			b = canonical[b];
+			return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+		};
+
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			for (size_t e = 0; e < 3; e++)
+				edgeUse[Key(indices[i + e], indices[i + (e + 1) % 3])]++;
+		}
+
+		for (const auto& [key, count] : edgeUse)
+		{
+			if (count == 1)
+				locked[key >> 32] = locked[key & 0xffffffff] = 1;
+		}
+
+		for (uint32_t v = 0; v < vertexCount; v++)
+			locked[v] |= locked[canonical[v]];
+	}
+
+	// Area weighted normals of the input per position. Passes only compare against the
+	// current triangles, these keep many small turns from adding up to a fold or to a
+	// sliver standing on its edge.
+	std::vector<Quadric>    quadrics(vertexCount);
+	std::vector<float3>     normals(vertexCount);
+
+	for (size_t i = 0; i < indexCount; i += 3)
+	{
+		const float3 a = Position(indices[i + 0]);
+		const float3 b = Position(indices[i + 1]);
+		const float3 c = Position(indices[i + 2]);
+		const float3 n = TriangleNormal(a, b, c);
+		const float  l = Length(n);
+
+		if (l <= 0.0f)
+			continue;
+
+		const float3 nn = n / l;
+		const auto   q  = Quadric::FromPlane(nn, -Dot(nn, a), l * 0.5f);
+
+		for (size_t j = 0; j < 3; j++)
+		{
+			quadrics[indices[i + j]] += q;
+			normals[canonical[indices[i + j]]] += n;
+		}
+	}
+
+	// Squared object space distance of collapsing v onto u
+	auto CollapseCost = [&](const uint32_t v, const uint32_t u)
+	{
+		Quadric q = quadrics[u];
+		q += quadrics[v];
+
+		return q.weight > 0.0 ? q.Evaluate(Position(u)) / q.weight : 0.0;
+	};
+
+	struct Collapse
+	{
+		uint32_t    v;
+		uint32_t    u;
+		double      cost;
+	};
+
+	std::vector<uint32_t>   triangleOffsets;
+	std::vector<uint32_t>   vertexTriangles;
+	std::vector<uint32_t>   remap(vertexCount);
+	std::vector<uint8_t>    touched(vertexCount);
+	std::vector<Collapse>   collapses;
+
+	auto& current = out.indices;
+
+	const double errorLimit = double(options.targetError) * options.targetError;
+	double       maxError   = 0.0;
+
+	while (current.size() > options.targetIndexCount)
+	{
+		// Vertex -> triangle adjacency
+		triangleOffsets.assign(vertexCount + 1, 0);
+
+		for (const uint32_t v : current)
+			triangleOffsets[v + 1]++;
+
+		std::partial_sum(triangleOffsets.begin(), triangleOffsets.end(), triangleOffsets.begin());
+		vertexTriangles.resize(current.size());
+
+		{
+			std::vector<uint32_t> fill{ triangleOffsets.begin(), triangleOffsets.end() - 1 };
+
+			for (size_t i = 0; i < current.size(); i++)
+				vertexTriangles[fill[current[i]]++] = uint32_t(i / 3);
+		}
+
+		collapses.clear();
+
+		for (size_t i = 0; i < current.size(); i += 3)
+		{
+			for (size_t e = 0; e < 3; e++)
+			{
+				const uint32_t a = current[i + e];
+				const uint32_t b = current[i + (e + 1) % 3];
+
+				const double costAB = locked[a] ? DBL_MAX : CollapseCost(a, b);
+				const double costBA = locked[b] ? DBL_MAX : CollapseCost(b, a);
+
+				if (costAB == DBL_MAX && costBA == DBL_MAX)
+					continue;
+
+				if (costAB <= costBA)
+					collapses.push_back({ a, b, costAB });
+				else
+					collapses.push_back({ b, a, costBA });
+			}
+		}
+
+		if (collapses.empty())
+			break;
+
+		std::sort(collapses.begin(), collapses.end(),
+			[](const Collapse& lhs, const Collapse& rhs) { return lhs.cost < rhs.cost; });
+
+		std::iota(remap.begin(), remap.end(), 0u);
+		std::fill(touched.begin(), touched.end(), 0);
+
+		auto Flips = [&](const uint32_t v, const uint32_t u)
+		{
+			const float3 target     = Position(u);
+			const float3 reference  = normals[canonical[v]];
+
+			for (uint32_t t = triangleOffsets[v]; t < triangleOffsets[v + 1]; t++)
+			{
+				const uint32_t* tri = current.data() + 3 * vertexTriangles[t];
+
+				if (tri[0] == u || tri[1] == u || tri[2] == u)
+					continue;
+
+				float3 p[3] = { Position(tri[0]), Position(tri[1]), Position(tri[2]) };
+				const float3 before = TriangleNormal(p[0], p[1], p[2]);
+
+				for (auto k = 0; k < 3; k++)
+				{
+					if (tri[k] == v)
+						p[k] = target;
+				}
+
+				const float3 after = TriangleNormal(p[0], p[1], p[2]);
+
+				if (Dot(before, after) <= 0.25f * Length(before) * Length(after) ||
+					Dot(reference, after) <= 0.5f * Length(reference) * Length(after))
+					return true;
+			}
+
+			return false;
+		};
+
+		const size_t    triangleCount       = current.size() / 3;
+		const size_t    targetTriangles     = options.targetIndexCount / 3;
+		size_t          removedTriangles    = 0;
+		size_t          collapsed           = 0;
+
+		for (const auto& collapse : collapses)
+		{
+			if (collapse.cost > errorLimit)
+				break;
+
+			if (triangleCount - removedTriangles <= targetTriangles)
+				break;
+
+			const uint32_t v = collapse.v;
+			const uint32_t u = collapse.u;
+
+			if (touched[v] || touched[u] || Flips(v, u))
+				continue;
+
+			remap[v]        = u;
+			quadrics[u]     += quadrics[v];
+			maxError        = std::max(maxError, collapse.cost);
+
+			// Keep this pass' adjacency valid by freezing the whole neighbourhood of v
+			for (uint32_t t = triangleOffsets[v]; t < triangleOffsets[v + 1]; t++)
+			{
+				const uint32_t* tri = current.data() + 3 * vertexTriangles[t];
+
+				touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+				removedTriangles += (tri[0] == u || tri[1] == u || tri[2] == u);
+			}
+
+			collapsed++;
+		}
+
+		if (!collapsed)
+			break;
+
+		size_t write = 0;
+
+		for (size_t i = 0; i < current.size(); i += 3)
+		{
+			const uint32_t a = remap[current[i + 0]];
+			const uint32_t b = remap[current[i + 1]];
+			const uint32_t c = remap[current[i + 2]];
+
+			if (a == b || b == c || a == c)
+				continue;
+
+			current[write++] = a;
+			current[write++] = b;
+			current[write++] = c;
+		}
+
+		current.resize(write);
+	}
+
+	out.error = float(std::sqrt(maxError));
+
+	return out;
+}
+
+struct LODLevel
+{
+	std::vector<uint32_t>   indices;
+	float                   error = 0.0f; // object space distance from the full resolution mesh
+};
+
+struct LODSettings
+{
+	size_t  maxLevels       = 5;
+	float   reduction       = 0.5f;     // index count ratio between neighbouring levels
+	float   maxError        = FLT_MAX;
+	bool    preserveBorder  = true;
+};
+
+// Level 0 is the source mesh. Each level is simplified from the previous one and stops
+// early once a level fails to meaningfully reduce the triangle count. The chain works on
+// a copy of the vertices the mesh uses, so its cost follows the mesh and not the buffer.
+inline std::vector<LODLevel> BuildLODChain(const float* positions, const size_t vertexCount, const uint32_t* indices, const size_t indexCount, const LODSettings& settings = {})
+{
+	std::vector<LODLevel> lods;
+	lods.push_back({ { indices, indices + indexCount }, 0.0f });
+
+	// Used vertices in buffer order, local vertex i is vertices[i]
+	std::vector<uint32_t> vertices(indices, indices + indexCount);
+	std::sort(vertices.begin(), vertices.end());
+	vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+
+	assert(vertices.empty() || vertices.back() < vertexCount);
+
+	std::vector<float> localPositions(3 * vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+		memcpy(localPositions.data() + 3 * i, positions + 3 * size_t(vertices[i]), 3 * sizeof(float));
+
+	std::vector<uint32_t> previous(indexCount);
+	for (size_t i = 0; i < indexCount; i++)
+		previous[i] = uint32_t(std::lower_bound(vertices.begin(), vertices.end(), indices[i]) - vertices.begin());
+
+	while (lods.size() < settings.maxLevels)
+	{
+		SimplifyOptions options;
+		options.targetIndexCount    = size_t(previous.size() / 3 * settings.reduction) * 3;
+		options.targetError         = settings.maxError;
+		options.preserveBorder      = settings.preserveBorder;
+
+		auto result = Simplify(localPositions.data(), vertices.size(), previous.data(), previous.size(), options);
+
+		if (result.indices.empty() || result.indices.size() > previous.size() * 0.9f)
+			break;
+
+		LODLevel level{ std::vector<uint32_t>(result.indices.size()), lods.back().error + result.error };
+
+		for (size_t i = 0; i < result.indices.size(); i++)
+			level.indices[i] = vertices[result.indices[i]];
+
+		lods.push_back(std::move(level));
+		previous = std::move(result.indices);
+	}
+
+	return lods;
+}
+
+// Builds chains for many shapes sharing one vertex buffer, largest shapes first.
+inline std::vector<std::vector<LODLevel>> BuildLODChains(ThreadPool& threads, const float* positions, const size_t vertexCount, const std::vector<std::vector<uint32_t>>& shapeIndices, const LODSettings& settings = {})
+{
+	std::vector<std::vector<LODLevel>>  chains(shapeIndices.size());
+	std::vector<size_t>                 order(shapeIndices.size());
+
+	std::iota(order.begin(), order.end(), size_t(0));
+	std::sort(order.begin(), order.end(),
+		[&](size_t lhs, size_t rhs) { return shapeIndices[lhs].size() > shapeIndices[rhs].size(); });
+
+	threads.ParallelFor(order.size(), 1,
+		[&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				const auto& indices = shapeIndices[order[i]];
+				chains[order[i]] = BuildLODChain(positions, vertexCount, indices.data(), indices.size(), settings);
+			}
+		});
+
+	return chains;
+}
+
+// projectionScale is viewportHeight / (2 * tan(fov / 2)), see Camera::GetProjectionScale
+inline float ScreenSpaceError(const float error, const float distance, const float projectionScale) noexcept
+{
+	return error * projectionScale / std::max(distance, 1e-4f);
+}
+
+// Coarsest level whose projected error stays under maxPixelError. TY is any
+// random access range of elements with an error member, e.g. LODLevel.
+template<typename TY>
+size_t SelectLOD(const TY& lods, const float distance, const float projectionScale, const float maxPixelError) noexcept
+{
+	size_t selected = 0;
+
+	for (size_t i = 1; i < lods.size(); i++)
+	{
+		if (ScreenSpaceError(lods[i].error, distance, projectionScale) > maxPixelError)
+			break;
+
+		selected = i;
+	}
+
+	return selected;
+}
@@ -0,0 +1,309 @@
+#pragma once
+
+#include "Geometry.hpp"
+#include "RadixSort.hpp"
+#include "Threading.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <vector>
+
+// Reorders triangles along a Morton curve through their centroids so neighbours in the
+// index buffer are neighbours in space. Vertex order follows for free wherever vertices
+// are renumbered in order of first use, e.g. MergeShapes.
+
+// Returns order[new] = old. groups, one per triangle, stay contiguous and ascending,
+// e.g. material ids so material runs survive the sort.
+inline std::vector<uint32_t> MortonTriangleOrder(ThreadPool& threads, const float* positions, const uint32_t* indices, const size_t indexCount, const std::span<const uint32_t> groups = {})
+{
+	const size_t triangleCount = indexCount / 3;
+
+	std::vector<float3> centroids(triangleCount);
+
+	threads.ParallelFor(triangleCount, 4096,
+		[&](size_t begin, size_t end)
+		{
+			for (size_t t = begin; t < end; t++)
+			{
+				const float3 a = LoadFloat3(positions + 3 * size_t(indices[3 * t + 0]));
+				const float3 b = LoadFloat3(positions + 3 * size_t(indices[3 * t + 1]));
+				const float3 c = LoadFloat3(positions + 3 * size_t(indices[3 * t + 2]));
+
+				centroids[t] = (a + b + c) / 3.0f;
+			}
+		});
+
+	AABB bounds;
+	for (const auto& c : centroids)
+	{
+		bounds.min = Min(bounds.min, c);
+		bounds.max = Max(bounds.max, c);
+	}
+
+	std::vector<uint32_t> order(triangleCount);
+	std::iota(order.begin(), order.end(), 0u);
+
+	std::vector<uint64_t> keys(triangleCount);
+
+	threads.ParallelFor(triangleCount, 4096,
+		[&](size_t begin, size_t end)
+		{
+			for (size_t t = begin; t < end; t++)
+				keys[t] = (groups.empty() ? 0ull : uint64_t(groups[t]) << 32) | MortonCode(centroids[t], bounds);
+		});
+
+	RadixSort(threads, keys, order);
+
+	return order;
+}
+
+// Tipsify (Sander et al. 2007) vertex cache ordering, returns order[new] = old. Vertices
+// are numbered by first use so dead ends resume in the incoming triangle order, which
+// is what makes a Morton sorted input pay off.
+inline std::vector<uint32_t> TipsifyTriangleOrder(const uint32_t* indices, const size_t indexCount, const size_t cacheSize = 16)
+{
+	const size_t triangleCount = indexCount / 3;
+
+	std::vector<uint32_t> order;
+	order.reserve(triangleCount);
+
+	// Local vertex ids in order of first use
+	std::vector<uint32_t> sortedIds(indices, indices + 3 * triangleCount);
+	std::sort(sortedIds.begin(), sortedIds.end());
+	sortedIds.erase(std::unique(sortedIds.begin(), sortedIds.end()), sortedIds.end());
+
+	const size_t vertexCount = sortedIds.size();
+
+	std::vector<uint32_t> firstUse(vertexCount, UINT32_MAX);
+	std::vector<uint32_t> local(3 * triangleCount);
+	uint32_t              nextId = 0;
+
+	for (size_t i = 0; i < 3 * triangleCount; i++)
+	{
+		const size_t sorted = size_t(std::lower_bound(sortedIds.begin(), sortedIds.end(), indices[i]) - sortedIds.begin());
+
+		if (firstUse[sorted] == UINT32_MAX)
+			firstUse[sorted] = nextId++;
+
+		local[i] = firstUse[sorted];
+	}
+
+	// Vertex to triangle adjacency
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (const uint32_t v : local)
+		offsets[v + 1]++;
+
+	for (size_t v = 0; v < vertexCount; v++)
+		offsets[v + 1] += offsets[v];
+
+	std::vector<uint32_t> adjacency(local.size());
+	{
+		std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+
+		for (size_t i = 0; i < local.size(); i++)
+			adjacency[cursor[local[i]]++] = uint32_t(i / 3);
+	}
+
+	std::vector<uint32_t>   live(vertexCount);
+	std::vector<size_t>     cacheTime(vertexCount, 0);
+	std::vector<uint8_t>    emitted(triangleCount, 0);
+	std::vector<uint32_t>   deadEnd;
+	std::vector<uint32_t>   candidates;
+
+	for (size_t v = 0; v < vertexCount; v++)
+		live[v] = offsets[v + 1] - offsets[v];
+
+	size_t      timestamp   = cacheSize + 1;
+	uint32_t    cursor      = 0;
+	int64_t     fanning     = vertexCount ? 0 : -1;
+
+	while (fanning >= 0)
+	{
+		candidates.clear();
+
+		for (uint32_t i = offsets[fanning]; i < offsets[fanning + 1]; i++)
+		{
+			const uint32_t t = adjacency[i];
+
+			if (emitted[t])
+				continue;
+
+			for (size_t c = 0; c < 3; c++)
+			{
+				const uint32_t v = local[3 * t + c];
+
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+
+				if (timestamp - cacheTime[v] > cacheSize)
+					cacheTime[v] = timestamp++;
+			}
+
+			emitted[t] = 1;
+			order.push_back(t);
+		}
+
+		// Next fanning vertex: the candidate that stays longest in the cache
+		int64_t best         = -1;
+		int64_t bestPriority = -1;
+
+		for (const uint32_t v : candidates)
+		{
+			if (!live[v])
+				continue;
+
+			int64_t priority = 0;
+			if (timestamp - cacheTime[v] + 2 * live[v] <= cacheSize)
+				priority = int64_t(timestamp - cacheTime[v]);
+
+			if (priority > bestPriority)
+			{
+				best            = v;
+				bestPriority    = priority;
+			}
+		}
+
+		if (best < 0)
+		{
+			while (!deadEnd.empty() && best < 0)
+			{
+				const uint32_t v = deadEnd.back();
+				deadEnd.pop_back();
+
+				if (live[v])
+					best = v;
+			}
+
+			while (best < 0 && cursor < vertexCount)
+			{
+				if (live[cursor])
+					best = cursor;
+
+				cursor++;
+			}
+		}
+
+		fanning = best;
+	}
+
+	return order;
+}
+
+// Morton order followed by Tipsify within each group run, returns order[new] = old
+inline std::vector<uint32_t> SpatialTriangleOrder(ThreadPool& threads, const float* positions, const uint32_t* indices, const size_t indexCount, const std::span<const uint32_t> groups = {}, const size_t cacheSize = 16)
+{
+	const auto morton = MortonTriangleOrder(threads, positions, indices, indexCount, groups);
+
+	std::vector<uint32_t> sorted(3 * morton.size());
+	for (size_t t = 0; t < morton.size(); t++)
+	{
+		for (size_t c = 0; c < 3; c++)
+			sorted[3 * t + c] = indices[3 * size_t(morton[t]) + c];
+	}
+
+	std::vector<uint32_t> order;
+	order.reserve(morton.size());
+
+	for (size_t first = 0; first < morton.size();)
+	{
+		size_t last = first + 1;
+		while (!groups.empty() && last < morton.size() && groups[morton[last]] == groups[morton[first]])
+			last++;
+
+		if (groups.empty())
+			last = morton.size();
+
+		for (const uint32_t t : TipsifyTriangleOrder(sorted.data() + 3 * first, 3 * (last - first), cacheSize))
+			order.push_back(morton[first + t]);
+
+		first = last;
+	}
+
+	return order;
+}
+
+// Reorders per triangle data, valuesPerTriangle is 3 for index or other per corner arrays.
+// order may also be a subset, e.g. the kept triangles from CleanupTriangles.
+template<typename TY>
+void ApplyTriangleOrder(const std::vector<uint32_t>& order, std::vector<TY>& data, const size_t valuesPerTriangle = 1)
+{
+	if (data.empty())
+		return;
+
+	std::vector<TY> sorted(order.size() * valuesPerTriangle);
+
+	for (size_t t = 0; t < order.size(); t++)
+	{
+		for (size_t i = 0; i < valuesPerTriangle; i++)
+			sorted[t * valuesPerTriangle + i] = data[size_t(order[t]) * valuesPerTriangle + i];
+	}
+
+	data.swap(sorted);
+}
+
+// Locality of an index buffer. Misses are counted against a FIFO post-transform cache.
+struct IndexLocality
+{
+	size_t  triangles       = 0;
+	size_t  vertices        = 0;    // unique vertices referenced
+	size_t  cacheMisses     = 0;
+	double  centroidSteps   = 0.0;  // sum of distances between consecutive triangle centroids
+
+	double ACMR()           const noexcept { return triangles ? double(cacheMisses) / triangles : 0.0; }   // misses per triangle
+	double ATVR()           const noexcept { return vertices ? double(cacheMisses) / vertices : 0.0; }     // misses per vertex, 1 is ideal
+	double MeanStep()       const noexcept { return triangles > 1 ? centroidSteps / (triangles - 1) : 0.0; }
+
+	IndexLocality& operator += (const IndexLocality& rhs) noexcept
+	{
+		triangles       += rhs.triangles;
+		vertices        += rhs.vertices;
+		cacheMisses     += rhs.cacheMisses;
+		centroidSteps   += rhs.centroidSteps;
+
+		return *this;
+	}
+};
+
+inline IndexLocality AnalyzeLocality(const float* positions, const uint32_t* indices, const size_t indexCount, const size_t cacheSize = 16)
+{
+	IndexLocality out;
+	out.triangles = indexCount / 3;
+
+	std::vector<uint32_t> unique(indices, indices + out.triangles * 3);
+	std::sort(unique.begin(), unique.end());
+	out.vertices = size_t(std::unique(unique.begin(), unique.end()) - unique.begin());
+
+	std::vector<uint32_t>   cache(cacheSize, UINT32_MAX);
+	size_t                  head = 0;
+
+	float3 previous;
+
+	for (size_t t = 0; t < out.triangles; t++)
+	{
+		float3 centroid;
+
+		for (size_t i = 0; i < 3; i++)
+		{
+			const uint32_t v = indices[3 * t + i];
+
+			if (std::find(cache.begin(), cache.end(), v) == cache.end())
+			{
+				cache[head] = v;
+				head        = (head + 1) % cacheSize;
+				out.cacheMisses++;
+			}
+
+			centroid += LoadFloat3(positions + 3 * size_t(v)) / 3.0f;
+		}
+
+		if (t)
+			out.centroidSteps += Length(centroid - previous);
+
+		previous = centroid;
+	}
+
+	return out;
+}
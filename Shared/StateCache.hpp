@@ -0,0 +1,354 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// Drops *Set* calls that would rebind what is already bound. Slot ranges are trimmed
+// to the slots that change. Other calls go to Context() directly, call Invalidate
+// afterwards if they changed bindings behind the cache's back.
+//
+// API names the context, object and value types and the slot counts, D3D11StateTypes
+// in D3D11StateCache.hpp for ID3D11DeviceContext. Nothing here includes d3d11.h, so
+// the filtering runs against a recording mock as well.
+
+struct StateCacheStats
+{
+	size_t issued   = 0;
+	size_t skipped  = 0;
+
+	void Reset() noexcept { *this = {}; }
+};
+
+namespace StateCacheDetail
+{
+	// Bound values of a slot range, unknown until first set or cleared
+	template<typename TY, size_t COUNT>
+	struct Slots
+	{
+		TY      values[COUNT]   = {};
+		bool    known[COUNT]    = {};
+
+		void Clear() noexcept
+		{
+			std::fill_n(values, COUNT, TY{});
+			std::fill_n(known, COUNT, true);
+		}
+
+		void Invalidate() noexcept
+		{
+			std::fill_n(known, COUNT, false);
+		}
+
+		// Updates the slots and narrows [first, last) to the ones that changed, empty if none did
+		template<typename GET>
+		void Update(const uint32_t start, const uint32_t count, GET&& Get, uint32_t& first, uint32_t& last) noexcept
+		{
+			first   = UINT32_MAX;
+			last    = 0;
+
+			for (uint32_t i = 0; i < count && start + i < COUNT; i++)
+			{
+				const TY        value   = Get(i);
+				const uint32_t  slot    = start + i;
+
+				if (known[slot] && std::memcmp(&values[slot], &value, sizeof(TY)) == 0)
+					continue;
+
+				values[slot]    = value;
+				known[slot]     = true;
+				first           = std::min(first, slot);
+				last            = slot + 1;
+			}
+		}
+	};
+
+	template<typename API>
+	struct VertexBinding
+	{
+		typename API::Buffer*   buffer  = nullptr;
+		uint32_t                stride  = 0;
+		uint32_t                offset  = 0;
+	};
+
+	template<typename API>
+	struct IndexBinding
+	{
+		typename API::Buffer*   buffer  = nullptr;
+		typename API::Format    format  = {};
+		uint32_t                offset  = 0;
+	};
+
+	// Whole array state, count included since setting fewer entries unbinds the rest
+	template<typename TY, size_t COUNT>
+	struct Array
+	{
+		TY          values[COUNT]   = {};
+		uint32_t    count           = 0;
+		bool        known           = false;
+
+		void Clear() noexcept
+		{
+			*this       = {};
+			known       = true;
+		}
+
+		bool Update(const uint32_t newCount, const TY* newValues) noexcept
+		{
+			TY              next[COUNT] = {};
+			const uint32_t  n           = std::min<uint32_t>(newCount, COUNT);
+
+			if (n)
+				std::memcpy(next, newValues, n * sizeof(TY));
+
+			if (known && count == n && std::memcmp(next, values, sizeof(next)) == 0)
+				return false;
+
+			std::memcpy(values, next, sizeof(next));
+			count   = n;
+			known   = true;
+			return true;
+		}
+	};
+
+	template<typename TY>
+	struct Value
+	{
+		TY      value = {};
+		bool    known = false;
+
+		void Clear() noexcept
+		{
+			value = {};
+			known = true;
+		}
+
+		bool Update(const TY next) noexcept
+		{
+			if (known && std::memcmp(&value, &next, sizeof(TY)) == 0)
+				return false;
+
+			value = next;
+			known = true;
+			return true;
+		}
+	};
+
+	template<typename API>
+	struct ShaderStage
+	{
+		Value<void*>                                                    shader;
+		Slots<typename API::Buffer*, API::constantBufferSlots>          constantBuffers;
+
+		void Clear() noexcept       { shader.Clear(); constantBuffers.Clear(); }
+		void Invalidate() noexcept  { shader.known = false; constantBuffers.Invalidate(); }
+	};
+
+	template<typename API>
+	struct RenderTargets
+	{
+		typename API::RenderTargetView* views[API::renderTargetSlots]   = {};
+		typename API::DepthStencilView* depth                           = nullptr;
+	};
+}
+
+template<typename API>
+class StateCache
+{
+public:
+	explicit StateCache(typename API::Context* context = nullptr) noexcept : context{ context } {}
+
+	typename API::Context*  Context()   const noexcept { return context; }
+	const StateCacheStats&  Stats()     const noexcept { return stats; }
+	StateCacheStats&        Stats()           noexcept { return stats; }
+
+	// Nothing is assumed about the bound state, the next call of each kind is issued
+	void Invalidate() noexcept
+	{
+		inputLayout.known   = false;
+		topology.known      = false;
+		indexBuffer.known   = false;
+		viewports.known     = false;
+		scissorRects.known  = false;
+		renderTargets.known = false;
+
+		vertexBuffers.Invalidate();
+		vs.Invalidate();
+		gs.Invalidate();
+		ps.Invalidate();
+	}
+
+	// For constant buffers bound directly, e.g. with *SetConstantBuffers1 offsets
+	void InvalidateConstantBuffers() noexcept
+	{
+		vs.constantBuffers.Invalidate();
+		gs.constantBuffers.Invalidate();
+		ps.constantBuffers.Invalidate();
+	}
+
+	// Always issued, afterwards everything is known to be unbound
+	void ClearState()
+	{
+		context->ClearState();
+		stats.issued++;
+
+		inputLayout.Clear();
+		topology.Clear();
+		indexBuffer.Clear();
+		viewports.Clear();
+		scissorRects.Clear();
+		renderTargets.Clear();
+
+		vertexBuffers.Clear();
+		vs.Clear();
+		gs.Clear();
+		ps.Clear();
+	}
+
+	void IASetInputLayout(typename API::InputLayout* layout)
+	{
+		if (Count(inputLayout.Update(layout)))
+			context->IASetInputLayout(layout);
+	}
+
+	void IASetPrimitiveTopology(const typename API::Topology primitiveTopology)
+	{
+		if (Count(topology.Update(primitiveTopology)))
+			context->IASetPrimitiveTopology(primitiveTopology);
+	}
+
+	void IASetVertexBuffers(const uint32_t start, const uint32_t count, typename API::Buffer* const* buffers, const uint32_t* strides, const uint32_t* offsets)
+	{
+		uint32_t first, last;
+		vertexBuffers.Update(start, count, [&](uint32_t i) { return StateCacheDetail::VertexBinding<API>{ buffers[i], strides[i], offsets[i] }; }, first, last);
+
+		if (Count(first < last))
+			context->IASetVertexBuffers(first, last - first, buffers + (first - start), strides + (first - start), offsets + (first - start));
+	}
+
+	void IASetIndexBuffer(typename API::Buffer* buffer, const typename API::Format format, const uint32_t offset)
+	{
+		if (Count(indexBuffer.Update({ buffer, format, offset })))
+			context->IASetIndexBuffer(buffer, format, offset);
+	}
+
+	void VSSetShader(typename API::VertexShader* shader, typename API::ClassInstance* const* classInstances, const uint32_t classInstanceCount)
+	{
+		if (Count(SetShader(vs, shader, classInstanceCount)))
+			context->VSSetShader(shader, classInstances, classInstanceCount);
+	}
+
+	void GSSetShader(typename API::GeometryShader* shader, typename API::ClassInstance* const* classInstances, const uint32_t classInstanceCount)
+	{
+		if (Count(SetShader(gs, shader, classInstanceCount)))
+			context->GSSetShader(shader, classInstances, classInstanceCount);
+	}
+
+	void PSSetShader(typename API::PixelShader* shader, typename API::ClassInstance* const* classInstances, const uint32_t classInstanceCount)
+	{
+		if (Count(SetShader(ps, shader, classInstanceCount)))
+			context->PSSetShader(shader, classInstances, classInstanceCount);
+	}
+
+	void VSSetConstantBuffers(const uint32_t start, const uint32_t count, typename API::Buffer* const* buffers)
+	{
+		uint32_t first, last;
+		if (SetConstantBuffers(vs, start, count, buffers, first, last))
+			context->VSSetConstantBuffers(first, last - first, buffers + (first - start));
+	}
+
+	void GSSetConstantBuffers(const uint32_t start, const uint32_t count, typename API::Buffer* const* buffers)
+	{
+		uint32_t first, last;
+		if (SetConstantBuffers(gs, start, count, buffers, first, last))
+			context->GSSetConstantBuffers(first, last - first, buffers + (first - start));
+	}
+
+	void PSSetConstantBuffers(const uint32_t start, const uint32_t count, typename API::Buffer* const* buffers)
+	{
+		uint32_t first, last;
+		if (SetConstantBuffers(ps, start, count, buffers, first, last))
+			context->PSSetConstantBuffers(first, last - first, buffers + (first - start));
+	}
+
+	void RSSetViewports(const uint32_t count, const typename API::Viewport* values)
+	{
+		if (Count(viewports.Update(count, values)))
+			context->RSSetViewports(count, values);
+	}
+
+	void RSSetScissorRects(const uint32_t count, const typename API::Rect* values)
+	{
+		if (Count(scissorRects.Update(count, values)))
+			context->RSSetScissorRects(count, values);
+	}
+
+	void OMSetRenderTargets(const uint32_t count, typename API::RenderTargetView* const* views, typename API::DepthStencilView* depth)
+	{
+		StateCacheDetail::RenderTargets<API> next;
+		std::copy_n(views, std::min<uint32_t>(count, API::renderTargetSlots), next.views);
+		next.depth = depth;
+
+		if (Count(renderTargets.Update(next)))
+			context->OMSetRenderTargets(count, views, depth);
+	}
+
+	void Draw(const uint32_t vertexCount, const uint32_t startVertex)
+	{
+		context->Draw(vertexCount, startVertex);
+	}
+
+	void DrawIndexed(const uint32_t indexCount, const uint32_t startIndex, const int32_t baseVertex)
+	{
+		context->DrawIndexed(indexCount, startIndex, baseVertex);
+	}
+
+	void DrawInstanced(const uint32_t vertexCount, const uint32_t instanceCount, const uint32_t startVertex, const uint32_t startInstance)
+	{
+		context->DrawInstanced(vertexCount, instanceCount, startVertex, startInstance);
+	}
+
+	void DrawIndexedInstanced(const uint32_t indexCount, const uint32_t instanceCount, const uint32_t startIndex, const int32_t baseVertex, const uint32_t startInstance)
+	{
+		context->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+	}
+
+private:
+	bool Count(const bool issue) noexcept
+	{
+		(issue ? stats.issued : stats.skipped)++;
+		return issue;
+	}
+
+	// Class instances are not tracked, such calls are always issued
+	bool SetShader(StateCacheDetail::ShaderStage<API>& stage, void* shader, const uint32_t classInstanceCount) noexcept
+	{
+		const bool changed = stage.shader.Update(shader);
+
+		if (classInstanceCount)
+			stage.shader.known = false;
+
+		return changed || classInstanceCount;
+	}
+
+	bool SetConstantBuffers(StateCacheDetail::ShaderStage<API>& stage, const uint32_t start, const uint32_t count, typename API::Buffer* const* buffers, uint32_t& first, uint32_t& last) noexcept
+	{
+		stage.constantBuffers.Update(start, count, [&](uint32_t i) { return buffers[i]; }, first, last);
+		return Count(first < last);
+	}
+
+	typename API::Context*  context = nullptr;
+	StateCacheStats         stats;
+
+	StateCacheDetail::Value<typename API::InputLayout*>                                         inputLayout;
+	StateCacheDetail::Value<typename API::Topology>                                             topology;
+	StateCacheDetail::Value<StateCacheDetail::IndexBinding<API>>                                indexBuffer;
+	StateCacheDetail::Value<StateCacheDetail::RenderTargets<API>>                               renderTargets;
+	StateCacheDetail::Array<typename API::Viewport, API::viewportSlots>                         viewports;
+	StateCacheDetail::Array<typename API::Rect, API::viewportSlots>                             scissorRects;
+	StateCacheDetail::Slots<StateCacheDetail::VertexBinding<API>, API::vertexBufferSlots>       vertexBuffers;
+
+	StateCacheDetail::ShaderStage<API> vs;
+	StateCacheDetail::ShaderStage<API> gs;
+	StateCacheDetail::ShaderStage<API> ps;
+};
@@ -0,0 +1,205 @@
+#pragma once
+
+#include "Geometry.hpp"
+#include "Normals.hpp"
+#include "Threading.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+// Per vertex tangents following MikkTSpace: per triangle tangents from the position
+// and texcoord derivatives, projected onto the vertex normal and weighted by the
+// projected corner angle, then summed over the corners of a vertex that share a UV
+// orientation. Vertices used with both orientations, i.e. on a mirror seam, are split.
+// Sums run over a fixed corner order so results do not depend on the thread count.
+
+struct Tangent
+{
+	float3  direction;
+	float   sign = 1.0f;    // bitangent = sign * Cross(normal, direction)
+};
+
+struct TangentMesh
+{
+	std::vector<uint32_t>   source;     // NormalMesh vertex of each vertex
+	std::vector<Tangent>    tangents;
+	std::vector<uint32_t>   indices;
+};
+
+namespace TangentsDetail
+{
+	constexpr size_t grainSize = 4096;
+
+	struct TriangleTangent
+	{
+		float3  direction;          // unit, zero when the texcoords are degenerate
+		bool    preserving = true;  // MikkTSpace's ORIENT_PRESERVING
+	};
+
+	inline float3 Project(const float3 v, const float3 n) noexcept
+	{
+		return Normalize(v - n * Dot(n, v));
+	}
+
+	// Any unit vector perpendicular to n, used when no corner contributes
+	inline float3 Perpendicular(const float3 n) noexcept
+	{
+		const float3 axis = std::abs(n.x) < 0.9f ? float3{ 1, 0, 0 } : float3{ 0, 1, 0 };
+		return Project(axis, n);
+	}
+}
+
+// texcoords are uv pairs indexed by NormalVertex::attribute, UINT32_MAX reads as (0, 0)
+inline TangentMesh GenerateTangents(ThreadPool& threads, const float* positions, const float* texcoords, const NormalMesh& mesh)
+{
+	using namespace TangentsDetail;
+
+	const size_t cornerCount    = mesh.indices.size();
+	const size_t triangleCount  = cornerCount / 3;
+	const size_t vertexCount    = mesh.vertices.size();
+
+	auto Position = [&](const uint32_t vertex)
+	{
+		return LoadFloat3(positions + 3 * size_t(mesh.vertices[vertex].position));
+	};
+
+	auto UV = [&](const uint32_t vertex, float& u, float& v)
+	{
+		const uint32_t idx = mesh.vertices[vertex].attribute;
+
+		u = idx == UINT32_MAX ? 0.0f : texcoords[2 * size_t(idx) + 0];
+		v = idx == UINT32_MAX ? 0.0f : texcoords[2 * size_t(idx) + 1];
+	};
+
+	// Triangle tangents. Winding is clockwise here while MikkTSpace expects counter
+	// clockwise, so the orientation test is flipped to produce the same signs.
+	std::vector<TriangleTangent> triangles(triangleCount);
+
+	threads.ParallelFor(triangleCount, grainSize,
+		[&](size_t begin, size_t end)
+		{
+			for (size_t t = begin; t < end; t++)
+			{
+				const uint32_t* tri = mesh.indices.data() + 3 * t;
+
+				float u0, v0, u1, v1, u2, v2;
+				UV(tri[0], u0, v0);
+				UV(tri[1], u1, v1);
+				UV(tri[2], u2, v2);
+
+				const float3 d1 = Position(tri[1]) - Position(tri[0]);
+				const float3 d2 = Position(tri[2]) - Position(tri[0]);
+
+				const float t21x = u1 - u0, t21y = v1 - v0;
+				const float t31x = u2 - u0, t31y = v2 - v0;
+
+				const float signedAreaSTx2  = t21x * t31y - t21y * t31x;
+				const float sign            = signedAreaSTx2 > 0.0f ? 1.0f : -1.0f;
+				const float3 os             = d1 * t31y - d2 * t21y;
+
+				triangles[t].preserving = !(signedAreaSTx2 > 0.0f);
+				triangles[t].direction  = std::abs(signedAreaSTx2) > FLT_MIN ? Normalize(os * sign) : float3{};
+			}
+		});
+
+	// Corners of each vertex, in corner order
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (const uint32_t v : mesh.indices)
+		offsets[v + 1]++;
+
+	for (size_t v = 0; v < vertexCount; v++)
+		offsets[v + 1] += offsets[v];
+
+	std::vector<uint32_t> corners(cornerCount);
+	{
+		std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+
+		for (uint32_t c = 0; c < cornerCount; c++)
+			corners[cursor[mesh.indices[c]]++] = c;
+	}
+
+	// Sum per vertex and orientation, [2 * v] preserving, [2 * v + 1] mirrored
+	std::vector<float3> sums(2 * vertexCount);
+	std::vector<uint8_t> used(2 * vertexCount, 0);
+
+	threads.ParallelFor(vertexCount, grainSize,
+		[&](size_t begin, size_t end)
+		{
+			for (size_t v = begin; v < end; v++)
+			{
+				const float3 n = mesh.vertices[v].normal;
+				const float3 p = Position(uint32_t(v));
+
+				for (uint32_t i = offsets[v]; i < offsets[v + 1]; i++)
+				{
+					const uint32_t  c       = corners[i];
+					const uint32_t* tri     = mesh.indices.data() + 3 * (c / 3);
+					const uint32_t  corner  = c % 3;
+					const auto&     face    = triangles[c / 3];
+					const size_t    slot    = 2 * v + (face.preserving ? 0 : 1);
+
+					used[slot] = 1;
+
+					if (Dot(face.direction, face.direction) == 0.0f)
+						continue;
+
+					const float3 e0     = Project(Position(tri[(corner + 1) % 3]) - p, n);
+					const float3 e1     = Project(Position(tri[(corner + 2) % 3]) - p, n);
+					const float  angle  = std::acos(std::clamp(Dot(e0, e1), -1.0f, 1.0f));
+
+					sums[slot] += Project(face.direction, n) * angle;
+				}
+			}
+		});
+
+	// New vertex per used (vertex, orientation) pair, in vertex order
+	TangentMesh out;
+	std::vector<uint32_t> remap(2 * vertexCount, UINT32_MAX);
+
+	for (size_t slot = 0; slot < 2 * vertexCount; slot++)
+	{
+		if (!used[slot])
+			continue;
+
+		const float3 n = mesh.vertices[slot / 2].normal;
+		const float3 t = Dot(sums[slot], sums[slot]) > 0.0f ? Normalize(sums[slot]) : Perpendicular(n);
+
+		remap[slot] = (uint32_t)out.source.size();
+		out.source.push_back(uint32_t(slot / 2));
+		out.tangents.push_back({ t, slot % 2 == 0 ? 1.0f : -1.0f });
+	}
+
+	out.indices.resize(cornerCount);
+
+	threads.ParallelFor(cornerCount, grainSize,
+		[&](size_t begin, size_t end)
+		{
+			for (size_t c = begin; c < end; c++)
+				out.indices[c] = remap[2 * size_t(mesh.indices[c]) + (triangles[c / 3].preserving ? 0 : 1)];
+		});
+
+	return out;
+}
+
+// Shapes largest first, each also spreads its triangles and vertices over the pool
+inline std::vector<TangentMesh> GenerateTangents(ThreadPool& threads, const float* positions, const float* texcoords, const std::vector<NormalMesh>& meshes)
+{
+	std::vector<TangentMesh>    out(meshes.size());
+	std::vector<size_t>         order(meshes.size());
+
+	std::iota(order.begin(), order.end(), size_t(0));
+	std::sort(order.begin(), order.end(),
+		[&](size_t lhs, size_t rhs) { return meshes[lhs].indices.size() > meshes[rhs].indices.size(); });
+
+	threads.ParallelFor(order.size(), 1,
+		[&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				out[order[i]] = GenerateTangents(threads, positions, texcoords, meshes[order[i]]);
+		});
+
+	return out;
+}
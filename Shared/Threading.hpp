@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	explicit ThreadPool(size_t workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1)
+	{
+		workers.reserve(workerCount);
+
+		for (size_t i = 0; i < workerCount; i++)
+			workers.emplace_back([this] { WorkerLoop(); });
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::scoped_lock lock{ m };
+			running = false;
+		}
+
+		cv.notify_all();
+
+		for (auto& worker : workers)
+			worker.join();
+	}
+
+	ThreadPool(const ThreadPool&)               = delete;
+	ThreadPool& operator = (const ThreadPool&)  = delete;
+
+	// Worker threads plus the calling thread
+	size_t ThreadCount() const noexcept { return workers.size() + 1; }
+
+	void Push(std::function<void()> task)
+	{
+		{
+			std::scoped_lock lock{ m };
+			tasks.push_back(std::move(task));
+		}
+
+		cv.notify_one();
+	}
+
+	// Runs fn(begin, end) over [0, count) in chunks of grainSize. The calling thread
+	// takes part, and keeps draining the queue while waiting, so nesting is safe.
+	template<typename FN>
+	void ParallelFor(const size_t count, const size_t grainSize, FN&& fn)
+	{
+		if (!count)
+			return;
+
+		const size_t grain      = std::max<size_t>(1, grainSize);
+		const size_t chunkCount = (count + grain - 1) / grain;
+
+		if (chunkCount == 1 || workers.empty())
+		{
+			fn(size_t(0), count);
+			return;
+		}
+
+		std::atomic_size_t  nextChunk   = 0;
+		std::atomic_size_t  pending     = 0;
+
+		auto RunChunks = [&]()
+		{
+			for (size_t chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++)
+			{
+				const size_t begin  = chunk * grain;
+				const size_t end    = std::min(count, begin + grain);
+
+				fn(begin, end);
+			}
+		};
+
+		const size_t helperCount = std::min(workers.size(), chunkCount - 1);
+		pending = helperCount;
+
+		for (size_t i = 0; i < helperCount; i++)
+		{
+			Push([&]()
+			{
+				RunChunks();
+
+				std::scoped_lock lock{ m };
+				if (--pending == 0)
+					cv.notify_all();
+			});
+		}
+
+		RunChunks();
+
+		while (pending)
+		{
+			if (!RunOne())
+			{
+				std::unique_lock lock{ m };
+				cv.wait(lock, [&] { return !pending || !tasks.empty(); });
+			}
+		}
+	}
+
+private:
+	bool RunOne()
+	{
+		std::function<void()> task;
+
+		{
+			std::scoped_lock lock{ m };
+
+			if (tasks.empty())
+				return false;
+
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+
+		task();
+
+		return true;
+	}
+
+	void WorkerLoop()
+	{
+		while (true)
+		{
+			std::function<void()> task;
+
+			{
+				std::unique_lock lock{ m };
+				cv.wait(lock, [&] { return !running || !tasks.empty(); });
+
+				if (tasks.empty())
+					return;
+
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+
+			task();
+		}
+	}
+
+	std::mutex                          m;
+	std::condition_variable             cv;
+	std::deque<std::function<void()>>   tasks;
+	std::vector<std::thread>            workers;
+	bool                                running = true;
+};
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <vector>
+
+// Transient textures of offscreen and post processing passes. The planner gives each
+// request a slot, requests with equal descriptors and disjoint pass ranges share one,
+// which is the aliasing D3D11 allows without placed resources. The pool keeps slot
+// textures across frames. No API calls, the caller creates and releases textures.
+
+struct TextureKey
+{
+	uint32_t width          = 0;
+	uint32_t height         = 0;
+	uint32_t depth          = 1;    // above 1 a volume texture
+	uint32_t mipLevels      = 1;
+	uint32_t arraySize      = 1;
+	uint32_t format         = 0;    // DXGI_FORMAT
+	uint32_t sampleCount    = 1;
+	uint32_t bindFlags      = 0;
+	uint32_t bytesPerTexel  = 4;
+
+	bool operator == (const TextureKey&) const noexcept = default;
+
+	// Estimate, mip chains as 4/3 of the top level
+	size_t Bytes() const noexcept
+	{
+		const size_t top = size_t(width) * height * depth * arraySize * sampleCount * bytesPerTexel;
+		return mipLevels > 1 ? top * 4 / 3 : top;
+	}
+};
+
+// Used from the start of firstPass until the end of lastPass
+struct TransientRequest
+{
+	TextureKey  key;
+	uint32_t    firstPass   = 0;
+	uint32_t    lastPass    = 0;
+};
+
+struct AliasingPlan
+{
+	std::vector<uint32_t>   slotOf;     // per request
+	std::vector<TextureKey> slots;
+
+	size_t unaliasedBytes   = 0;    // one texture per request
+	size_t aliasedBytes     = 0;    // one texture per slot
+	size_t peakLiveBytes    = 0;    // most bytes in use during one pass, the bound for any aliasing
+};
+
+// Requests in order of their first pass take the free slot of their descriptor that
+// was released last, or a new slot. Greedy by start is optimal for intervals, so per
+// descriptor the slot count equals the most overlapping requests.
+inline AliasingPlan PlanAliasing(const std::span<const TransientRequest> requests)
+{
+	AliasingPlan plan;
+	plan.slotOf.resize(requests.size());
+
+	std::vector<uint32_t> order(requests.size());
+	std::iota(order.begin(), order.end(), 0u);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return requests[a].firstPass < requests[b].firstPass; });
+
+	std::vector<uint32_t> busyUntil;    // per slot, last pass of its current request
+
+	for (const uint32_t r : order)
+	{
+		const auto& request = requests[r];
+
+		uint32_t slot = uint32_t(plan.slots.size());
+
+		for (uint32_t s = 0; s < plan.slots.size(); s++)
+		{
+			if (plan.slots[s] == request.key && busyUntil[s] < request.firstPass && (slot == plan.slots.size() || busyUntil[s] > busyUntil[slot]))
+				slot = s;
+		}
+
+		if (slot == plan.slots.size())
+		{
+			plan.slots.push_back(request.key);
+			busyUntil.push_back(request.lastPass);
+			plan.aliasedBytes += request.key.Bytes();
+		}
+		else
+			busyUntil[slot] = request.lastPass;
+
+		plan.slotOf[r]          = slot;
+		plan.unaliasedBytes     += request.key.Bytes();
+	}
+
+	// Live bytes per pass from start and end events
+	std::vector<std::pair<uint32_t, int64_t>> events;
+	for (const auto& request : requests)
+	{
+		events.push_back({ request.firstPass, int64_t(request.key.Bytes()) });
+		events.push_back({ request.lastPass + 1, -int64_t(request.key.Bytes()) });
+	}
+
+	std::sort(events.begin(), events.end());
+
+	int64_t live = 0;
+	for (size_t i = 0; i < events.size(); i++)
+	{
+		live += events[i].second;
+
+		if (i + 1 == events.size() || events[i + 1].first != events[i].first)
+			plan.peakLiveBytes = std::max(plan.peakLiveBytes, size_t(live));
+	}
+
+	return plan;
+}
+
+// Slot textures kept across frames by descriptor. RESOURCE is any handle, Create(key)
+// and Release(resource) are the API side.
+template<typename RESOURCE>
+class TransientPool
+{
+public:
+	// Resources for every slot of the plan, reusing the pool's textures first
+	template<typename CREATE>
+	void Acquire(const AliasingPlan& plan, std::vector<RESOURCE>& resources, CREATE&& Create)
+	{
+		resources.resize(plan.slots.size());
+
+		for (size_t s = 0; s < plan.slots.size(); s++)
+		{
+			Entry* match = nullptr;
+
+			for (auto& entry : entries)
+			{
+				if (entry.lastFrame != frame && entry.key == plan.slots[s])
+				{
+					match = &entry;
+					break;
+				}
+			}
+
+			if (!match)
+			{
+				entries.push_back({ plan.slots[s], Create(plan.slots[s]), frame });
+				match = &entries.back();
+				created++;
+			}
+			else
+				reused++;
+
+			match->lastFrame    = frame;
+			resources[s]        = match->resource;
+		}
+	}
+
+	// Releases textures no frame acquired for more than maxIdleFrames
+	template<typename RELEASE>
+	void EndFrame(const uint64_t maxIdleFrames, RELEASE&& Release)
+	{
+		const auto last = std::remove_if(entries.begin(), entries.end(),
+			[&](Entry& entry)
+			{
+				if (frame - entry.lastFrame <= maxIdleFrames)
+					return false;
+
+				Release(entry.resource);
+				return true;
+			});
+
+		entries.erase(last, entries.end());
+		frame++;
+	}
+
+	// Everything, e.g. when the window size changed every descriptor
+	template<typename RELEASE>
+	void Clear(RELEASE&& Release)
+	{
+		for (auto& entry : entries)
+			Release(entry.resource);
+
+		entries.clear();
+	}
+
+	size_t PooledBytes() const noexcept
+	{
+		size_t bytes = 0;
+		for (const auto& entry : entries)
+			bytes += entry.key.Bytes();
+
+		return bytes;
+	}
+
+	size_t Count()      const noexcept { return entries.size(); }
+	size_t Created()    const noexcept { return created; }
+	size_t Reused()     const noexcept { return reused; }
+
+private:
+	struct Entry
+	{
+		TextureKey  key;
+		RESOURCE    resource;
+		uint64_t    lastFrame;
+	};
+
+	std::vector<Entry>  entries;
+	uint64_t            frame   = 1;
+	size_t              created = 0;
+	size_t              reused  = 0;
+};
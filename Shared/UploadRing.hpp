@@ -0,0 +1,104 @@
+#pragma once
+
+#include "FrameFences.hpp"
+#include "RingAllocator.hpp"
+
+#include <d3d11.h>
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+// Transient data streamed every frame, e.g. debug lines, particles or instance data,
+// suballocated from one large dynamic buffer. Writes map with MAP_WRITE_NO_OVERWRITE,
+// the fences keep slices alive until the GPU finished the frames that read them.
+
+struct UploadSlice
+{
+	ID3D11Buffer*   buffer  = nullptr;
+	UINT            offset  = 0;    // bytes, as IASetVertexBuffers and IASetIndexBuffer take it
+	UINT            size    = 0;
+
+	explicit operator bool () const noexcept { return buffer != nullptr; }
+};
+
+class UploadRing
+{
+public:
+	UploadRing() = default;
+
+	UploadRing(const UploadRing&)               = delete;
+	UploadRing& operator = (const UploadRing&)  = delete;
+
+	~UploadRing()
+	{
+		if (buffer)
+			buffer->Release();
+	}
+
+	// bindFlags e.g. D3D11_BIND_VERTEX_BUFFER | D3D11_BIND_INDEX_BUFFER
+	bool Create(ID3D11Device* device, const size_t capacity, const UINT bindFlags, const size_t alignment = 16)
+	{
+		D3D11_BUFFER_DESC   bufferDesc = { 0 };
+		bufferDesc.ByteWidth            = (UINT)(capacity / alignment * alignment);
+		bufferDesc.Usage                = D3D11_USAGE_DYNAMIC;
+		bufferDesc.BindFlags            = bindFlags;
+		bufferDesc.CPUAccessFlags       = D3D11_CPU_ACCESS_WRITE;
+
+		if (FAILED(device->CreateBuffer(&bufferDesc, nullptr, &buffer)))
+			return false;
+
+		this->device    = device;
+		ring            = RingAllocator{ bufferDesc.ByteWidth, alignment };
+
+		return true;
+	}
+
+	// Copies size bytes into a new slice. A full ring waits for the oldest frame in flight,
+	// an empty slice means size exceeds the ring or the map failed.
+	UploadSlice Write(ID3D11DeviceContext* context, const void* data, const size_t size)
+	{
+		const size_t offset = ring.Allocate(size, [&] { return fences.WaitOldest(context); }, &waits);
+
+		if (offset == RingAllocator::invalid)
+			return {};
+
+		// The first map has to discard, afterwards slices in use are never touched
+		D3D11_MAPPED_SUBRESOURCE mapped = { 0 };
+		if (FAILED(context->Map(buffer, 0, firstMap ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE, 0, &mapped)))
+			return {};
+
+		std::memcpy(static_cast<uint8_t*>(mapped.pData) + offset, data, size);
+		context->Unmap(buffer, 0);
+
+		firstMap = false;
+
+		return { buffer, UINT(offset), UINT(size) };
+	}
+
+	template<typename TY>
+	UploadSlice Write(ID3D11DeviceContext* context, const std::span<const TY> values)
+	{
+		return Write(context, values.data(), values.size_bytes());
+	}
+
+	// Fences the slices written this frame and reclaims those of frames the GPU finished
+	void EndFrame(ID3D11DeviceContext* context)
+	{
+		ring.EndFrame(frame);
+		fences.Signal(device, context, frame++);
+		ring.Retire(fences.Poll(context));
+	}
+
+	const RingAllocator&    Allocator() const noexcept { return ring; }
+	size_t                  Waits()     const noexcept { return waits; }   // writes that stalled on a full ring
+
+private:
+	ID3D11Device*   device      = nullptr;
+	ID3D11Buffer*   buffer      = nullptr;
+	RingAllocator   ring;
+	FrameFences     fences;
+	uint64_t        frame       = 1;
+	size_t          waits       = 0;
+	bool            firstMap    = true;
+};
@@ -0,0 +1,295 @@
+#pragma once
+
+#include "Geometry.hpp"
+#include "SIMD.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Compact vertex encodings:
+//  positions   R16G16B16A16_UNORM, relative to an AABB    (12 -> 8 bytes)
+//  normals     R16G16_SNORM, octahedral                    (12 -> 4 bytes)
+//  uvs         R16G16_FLOAT                                 (8 -> 4 bytes)
+
+struct PositionQuantization
+{
+	float3 offset;
+	float3 scale = { 1.0f, 1.0f, 1.0f };    // decoded = offset + unorm * scale
+
+	static PositionQuantization FromAABB(const AABB& aabb) noexcept
+	{
+		const float3 extents = aabb.Extents();
+
+		return {
+			aabb.min,
+			{
+				extents.x > 0.0f ? extents.x : 1.0f,
+				extents.y > 0.0f ? extents.y : 1.0f,
+				extents.z > 0.0f ? extents.z : 1.0f,
+			} };
+	}
+};
+
+inline void EncodePosition(const float* xyz, const PositionQuantization& q, uint16_t* out) noexcept
+{
+	const float offset[3]   = { q.offset.x, q.offset.y, q.offset.z };
+	const float scale[3]    = { q.scale.x,  q.scale.y,  q.scale.z };
+
+	for (size_t i = 0; i < 3; i++)
+	{
+		const float t = std::min(std::max((xyz[i] - offset[i]) / scale[i], 0.0f), 1.0f);
+		out[i] = (uint16_t)std::nearbyint(t * 65535.0f);
+	}
+
+	out[3] = 0;
+}
+
+inline float3 DecodePosition(const uint16_t* in, const PositionQuantization& q) noexcept
+{
+	return {
+		q.offset.x + in[0] / 65535.0f * q.scale.x,
+		q.offset.y + in[1] / 65535.0f * q.scale.y,
+		q.offset.z + in[2] / 65535.0f * q.scale.z };
+}
+
+// out receives four uint16 per vertex
+inline void EncodePositions(const float* positions, const size_t count, const PositionQuantization& q, uint16_t* out) noexcept
+{
+	const __m128    offset      = _mm_setr_ps(q.offset.x, q.offset.y, q.offset.z, 0.0f);
+	const __m128    scale       = _mm_setr_ps(q.scale.x, q.scale.y, q.scale.z, 1.0f);
+	const __m128    one         = _mm_set1_ps(1.0f);
+	const __m128    unorm       = _mm_set1_ps(65535.0f);
+	const __m128i   xyzMask     = _mm_setr_epi32(-1, -1, -1, 0);
+
+	auto Encode = [&](const __m128 p)
+	{
+		__m128 t = _mm_div_ps(_mm_sub_ps(p, offset), scale);
+		t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), one);
+
+		return _mm_and_si128(_mm_cvtps_epi32(_mm_mul_ps(t, unorm)), xyzMask);
+	};
+
+	size_t i = 0;
+
+	// Unaligned four wide loads read one float past each vertex, stop before the last one
+	for (; i + 3 <= count; i += 2)
+	{
+		const __m128i a = Encode(_mm_loadu_ps(positions + 3 * i));
+		const __m128i b = Encode(_mm_loadu_ps(positions + 3 * i + 3));
+
+		_mm_storeu_si128((__m128i*)(out + 4 * i), PackLow16(a, b));
+	}
+
+	for (; i < count; i++)
+		EncodePosition(positions + 3 * i, q, out + 4 * i);
+}
+
+inline float EncodeSnorm16(const float v) noexcept
+{
+	return std::nearbyint(std::min(std::max(v, -1.0f), 1.0f) * 32767.0f);
+}
+
+inline void EncodeOctahedral(const float* n, int16_t* out) noexcept
+{
+	const float s = std::max(std::abs(n[0]) + std::abs(n[1]) + std::abs(n[2]), 1e-20f);
+
+	float x = n[0] / s;
+	float y = n[1] / s;
+
+	if (n[2] < 0.0f)
+	{
+		const float ox = (1.0f - std::abs(y)) * std::copysign(1.0f, x);
+		const float oy = (1.0f - std::abs(x)) * std::copysign(1.0f, y);
+		x = ox;
+		y = oy;
+	}
+
+	out[0] = (int16_t)EncodeSnorm16(x);
+	out[1] = (int16_t)EncodeSnorm16(y);
+}
+
+inline float3 DecodeOctahedral(const int16_t* in) noexcept
+{
+	float x = std::max(in[0] / 32767.0f, -1.0f);
+	float y = std::max(in[1] / 32767.0f, -1.0f);
+
+	const float z = 1.0f - std::abs(x) - std::abs(y);
+
+	if (z < 0.0f)
+	{
+		const float ox = (1.0f - std::abs(y)) * std::copysign(1.0f, x);
+		const float oy = (1.0f - std::abs(x)) * std::copysign(1.0f, y);
+		x = ox;
+		y = oy;
+	}
+
+	return Normalize({ x, y, z });
+}
+
+// out receives two int16 per normal
+inline void EncodeNormals(const float* normals, const size_t count, int16_t* out) noexcept
+{
+	const __m128 one        = _mm_set1_ps(1.0f);
+	const __m128 snorm      = _mm_set1_ps(32767.0f);
+	const __m128 epsilon    = _mm_set1_ps(1e-20f);
+
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x, y, z;
+		LoadTransposed4(normals + 3 * i, x, y, z);
+
+		const __m128 s = _mm_max_ps(_mm_add_ps(_mm_add_ps(Abs(x), Abs(y)), Abs(z)), epsilon);
+		x = _mm_div_ps(x, s);
+		y = _mm_div_ps(y, s);
+
+		const __m128 lower  = _mm_cmplt_ps(z, _mm_setzero_ps());
+		const __m128 wx     = CopySign(_mm_sub_ps(one, Abs(y)), x);
+		const __m128 wy     = CopySign(_mm_sub_ps(one, Abs(x)), y);
+
+		x = _mm_mul_ps(_mm_min_ps(_mm_max_ps(Select(lower, wx, x), _mm_sub_ps(_mm_setzero_ps(), one)), one), snorm);
+		y = _mm_mul_ps(_mm_min_ps(_mm_max_ps(Select(lower, wy, y), _mm_sub_ps(_mm_setzero_ps(), one)), one), snorm);
+
+		const __m128i ix = _mm_cvtps_epi32(x);
+		const __m128i iy = _mm_cvtps_epi32(y);
+
+		_mm_storeu_si128((__m128i*)(out + 2 * i), _mm_packs_epi32(_mm_unpacklo_epi32(ix, iy), _mm_unpackhi_epi32(ix, iy)));
+	}
+
+	for (; i < count; i++)
+		EncodeOctahedral(normals + 3 * i, out + 2 * i);
+}
+
+// Round to nearest even, denormals flush to zero
+inline uint16_t FloatToHalf(const float f) noexcept
+{
+	uint32_t bits;
+	memcpy(&bits, &f, sizeof(bits));
+
+	const uint32_t sign = (bits >> 16) & 0x8000;
+	const uint32_t abs  = bits & 0x7fffffff;
+
+	if (abs > 0x7f800000)
+		return uint16_t(sign | 0x7e00);
+
+	if (abs >= 0x477ff000)
+		return uint16_t(sign | 0x7c00);
+
+	if (abs < 0x38800000)
+		return uint16_t(sign);
+
+	const uint32_t rounded = abs + 0xfff + ((abs >> 13) & 1);
+
+	return uint16_t(sign | ((rounded >> 13) - (112 << 10)));
+}
+
+inline float HalfToFloat(const uint16_t h) noexcept
+{
+	const uint32_t sign     = uint32_t(h & 0x8000) << 16;
+	const uint32_t exponent = (h >> 10) & 0x1f;
+	const uint32_t mantissa = h & 0x3ff;
+
+	uint32_t bits;
+
+	if (exponent == 0x1f)
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	else if (exponent == 0)
+		bits = sign; // denormals flush to zero, matching FloatToHalf
+	else
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+
+	float f;
+	memcpy(&f, &bits, sizeof(f));
+
+	return f;
+}
+
+// Converts count floats, e.g. 2 * uvCount for texcoords
+inline void EncodeHalfs(const float* in, const size_t count, uint16_t* out) noexcept
+{
+	const __m128i absMask   = _mm_set1_epi32(0x7fffffff);
+	const __m128i infinity  = _mm_set1_epi32(0x7f800000);
+	const __m128i overflow  = _mm_set1_epi32(0x477ff000 - 1);
+	const __m128i underflow = _mm_set1_epi32(0x38800000);
+	const __m128i rebias    = _mm_set1_epi32(112 << 10);
+	const __m128i roundBias = _mm_set1_epi32(0xfff);
+	const __m128i one       = _mm_set1_epi32(1);
+
+	auto Convert = [&](const __m128i bits)
+	{
+		const __m128i sign  = _mm_and_si128(_mm_srli_epi32(bits, 16), _mm_set1_epi32(0x8000));
+		const __m128i abs   = _mm_and_si128(bits, absMask);
+
+		const __m128i odd       = _mm_and_si128(_mm_srli_epi32(abs, 13), one);
+		const __m128i rounded   = _mm_add_epi32(_mm_add_epi32(abs, roundBias), odd);
+		__m128i       half      = _mm_sub_epi32(_mm_srli_epi32(rounded, 13), rebias);
+
+		const __m128i isNaN     = _mm_cmpgt_epi32(abs, infinity);
+		const __m128i isInf     = _mm_cmpgt_epi32(abs, overflow);
+		const __m128i isZero    = _mm_cmplt_epi32(abs, underflow);
+
+		half = _mm_or_si128(_mm_andnot_si128(isInf, half), _mm_and_si128(isInf, _mm_set1_epi32(0x7c00)));
+		half = _mm_or_si128(_mm_andnot_si128(isNaN, half), _mm_and_si128(isNaN, _mm_set1_epi32(0x7e00)));
+		half = _mm_andnot_si128(isZero, half);
+
+		return _mm_or_si128(half, sign);
+	};
+
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m128i a = Convert(_mm_castps_si128(_mm_loadu_ps(in + i)));
+		const __m128i b = Convert(_mm_castps_si128(_mm_loadu_ps(in + i + 4)));
+
+		_mm_storeu_si128((__m128i*)(out + i), PackLow16(a, b));
+	}
+
+	for (; i < count; i++)
+		out[i] = FloatToHalf(in[i]);
+}
+
+struct QuantizationError
+{
+	float positionMax       = 0.0f;
+	float positionRMS       = 0.0f;
+	float normalMaxDegrees  = 0.0f;
+	float uvMax             = 0.0f;
+};
+
+inline void MeasurePositionError(const float* positions, const uint16_t* encoded, const size_t count, const PositionQuantization& q, QuantizationError& error) noexcept
+{
+	double sum = 0.0;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const float d = Length(DecodePosition(encoded + 4 * i, q) - LoadFloat3(positions + 3 * i));
+
+		error.positionMax = std::max(error.positionMax, d);
+		sum += double(d) * d;
+	}
+
+	error.positionRMS = count ? float(std::sqrt(sum / count)) : 0.0f;
+}
+
+inline void MeasureNormalError(const float* normals, const int16_t* encoded, const size_t count, QuantizationError& error) noexcept
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		const float3 source = Normalize(LoadFloat3(normals + 3 * i));
+
+		if (Length(source) <= 0.0f)
+			continue;
+
+		const float c = std::min(std::max(Dot(source, DecodeOctahedral(encoded + 2 * i)), -1.0f), 1.0f);
+		error.normalMaxDegrees = std::max(error.normalMaxDegrees, std::acos(c) * 57.2957795f);
+	}
+}
+
+inline void MeasureHalfError(const float* source, const uint16_t* encoded, const size_t count, QuantizationError& error) noexcept
+{
+	for (size_t i = 0; i < count; i++)
+		error.uvMax = std::max(error.uvMax, std::abs(HalfToFloat(encoded[i]) - source[i]));
+}
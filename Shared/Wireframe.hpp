@@ -0,0 +1,257 @@
+#pragma once
+
+#include "Bounds.hpp"
+#include "Geometry.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+// Wireframe without a geometry shader: triangles are expanded so every vertex carries
+// its triangle's three positions, the vertex shader then computes the same edge
+// distances GeometryShader2 does. The CPU reference below renders both paths.
+
+// Vertex k of the output holds the three vertices of the triangle containing index k,
+// so ranges into the index buffer become vertex ranges of the expanded buffer.
+inline std::vector<uint8_t> ExpandTriangles(const void* vertices, const size_t stride, const uint32_t* indices, const size_t indexCount, const std::span<const IndexedRange> ranges)
+{
+	const auto* source = static_cast<const uint8_t*>(vertices);
+
+	std::vector<uint8_t> out(indexCount * 3 * stride);
+
+	for (const auto& range : ranges)
+	{
+		for (uint32_t i = range.startIndex; i < range.startIndex + range.indexCount; i += 3)
+		{
+			for (uint32_t corner = 0; corner < 3; corner++)
+			{
+				uint8_t* dst = out.data() + size_t(i + corner) * 3 * stride;
+
+				for (uint32_t v = 0; v < 3; v++)
+					memcpy(dst + v * stride, source + size_t(indices[i + v] + range.baseVertex) * stride, stride);
+			}
+		}
+	}
+
+	return out;
+}
+
+struct ClipPosition
+{
+	float x = 0.0f;
+	float y = 0.0f;
+	float z = 0.0f;
+	float w = 0.0f;
+};
+
+// Row-vector (DirectXMath layout) transform, matches mul(pvt, float4(p, 1)) in the shaders
+inline ClipPosition TransformPoint(const float3 p, const float (&m)[4][4]) noexcept
+{
+	return {
+		p.x * m[0][0] + p.y * m[1][0] + p.z * m[2][0] + m[3][0],
+		p.x * m[0][1] + p.y * m[1][1] + p.z * m[2][1] + m[3][1],
+		p.x * m[0][2] + p.y * m[1][2] + p.z * m[2][2] + m[3][2],
+		p.x * m[0][3] + p.y * m[1][3] + p.z * m[2][3] + m[3][3] };
+}
+
+// Distance of a corner to its opposite edge in units of viewportScale * NDC, GeometryShader2's formula
+inline float EdgeDistance(const ClipPosition (&clip)[3], const float viewportScaleX, const float viewportScaleY, const uint32_t corner) noexcept
+{
+	float x[3], y[3];
+	for (int i = 0; i < 3; i++)
+	{
+		x[i] = viewportScaleX * clip[i].x / clip[i].w;
+		y[i] = viewportScaleY * clip[i].y / clip[i].w;
+	}
+
+	const float v0x = x[2] - x[1], v0y = y[2] - y[1];
+	const float v1x = x[2] - x[0], v1y = y[2] - y[0];
+	const float v2x = x[1] - x[0], v2y = y[1] - y[0];
+
+	const float area = std::abs(v1x * v2y - v1y * v2x);
+
+	switch (corner)
+	{
+	case 0:     return area / std::sqrt(v0x * v0x + v0y * v0y);
+	case 1:     return area / std::sqrt(v1x * v1x + v1y * v1y);
+	default:    return area / std::sqrt(v2x * v2x + v2y * v2y);
+	}
+}
+
+// PixelShader2 output, the red channel is enough to compare images
+inline float WireframeShade(const float3 dist) noexcept
+{
+	const float d = std::min(dist.x, std::min(dist.y, dist.z)) / 2.0f;
+	const float I = std::exp2(-2.0f * d * d);
+
+	return 0.5f * (1.0f - I);
+}
+
+struct WireframeImage
+{
+	uint32_t            width   = 0;
+	uint32_t            height  = 0;
+	std::vector<float>  color;      // -1 where nothing was drawn
+	std::vector<float>  depth;
+
+	WireframeImage(const uint32_t w, const uint32_t h) : width{ w }, height{ h }, color(size_t(w) * h, -1.0f), depth(size_t(w) * h, 1.0f) {}
+};
+
+struct WireframeVertex
+{
+	ClipPosition    clip;
+	float3          dist;
+};
+
+namespace WireframeDetail
+{
+	inline float EdgeFunction(const float ax, const float ay, const float bx, const float by, const float px, const float py) noexcept
+	{
+		return (px - ax) * (by - ay) - (py - ay) * (bx - ax);
+	}
+
+	// Minimal D3D11 style rasterizer: clockwise front faces, back faces culled, depth LESS,
+	// perspective correct attributes. Triangles crossing w = 0 are skipped, both paths alike.
+	inline void Rasterize(WireframeImage& image, const WireframeVertex (&v)[3])
+	{
+		float sx[3], sy[3], sz[3], invW[3];
+
+		for (int i = 0; i < 3; i++)
+		{
+			if (v[i].clip.w <= 0.0f)
+				return;
+
+			invW[i] = 1.0f / v[i].clip.w;
+			sx[i]   = (v[i].clip.x * invW[i] * 0.5f + 0.5f) * image.width;
+			sy[i]   = (0.5f - v[i].clip.y * invW[i] * 0.5f) * image.height;
+			sz[i]   = v[i].clip.z * invW[i];
+		}
+
+		const float area = EdgeFunction(sx[0], sy[0], sx[2], sy[2], sx[1], sy[1]);
+
+		if (area <= 0.0f)
+			return;
+
+		const int minX = std::max(0, int(std::floor(std::min({ sx[0], sx[1], sx[2] }))));
+		const int minY = std::max(0, int(std::floor(std::min({ sy[0], sy[1], sy[2] }))));
+		const int maxX = std::min(int(image.width) - 1,  int(std::ceil(std::max({ sx[0], sx[1], sx[2] }))));
+		const int maxY = std::min(int(image.height) - 1, int(std::ceil(std::max({ sy[0], sy[1], sy[2] }))));
+
+		for (int y = minY; y <= maxY; y++)
+		{
+			for (int x = minX; x <= maxX; x++)
+			{
+				const float px = x + 0.5f;
+				const float py = y + 0.5f;
+
+				const float b0 = EdgeFunction(sx[1], sy[1], sx[2], sy[2], px, py) / -area;
+				const float b1 = EdgeFunction(sx[2], sy[2], sx[0], sy[0], px, py) / -area;
+				const float b2 = 1.0f - b0 - b1;
+
+				if (b0 < 0.0f || b1 < 0.0f || b2 < 0.0f)
+					continue;
+
+				const float  z      = b0 * sz[0] + b1 * sz[1] + b2 * sz[2];
+				const size_t pixel  = size_t(y) * image.width + x;
+
+				if (z < 0.0f || z >= image.depth[pixel])
+					continue;
+
+				const float p0  = b0 * invW[0];
+				const float p1  = b1 * invW[1];
+				const float p2  = b2 * invW[2];
+				const float sum = p0 + p1 + p2;
+
+				const float3 dist = (v[0].dist * p0 + v[1].dist * p1 + v[2].dist * p2) / sum;
+
+				image.depth[pixel] = z;
+				image.color[pixel] = WireframeShade(dist);
+			}
+		}
+	}
+}
+
+// Reference of VertexShader2 + GeometryShader2 over indexed triangles
+inline void RenderWireframeGS(WireframeImage& image, const float* positions, const uint32_t* indices, const std::span<const IndexedRange> ranges, const float (&m)[4][4], const float viewportScaleX, const float viewportScaleY)
+{
+	for (const auto& range : ranges)
+	{
+		for (uint32_t i = range.startIndex; i < range.startIndex + range.indexCount; i += 3)
+		{
+			ClipPosition clip[3];
+			for (uint32_t v = 0; v < 3; v++)
+				clip[v] = TransformPoint(LoadFloat3(positions + 3 * size_t(indices[i + v] + range.baseVertex)), m);
+
+			WireframeVertex triangle[3];
+			for (uint32_t v = 0; v < 3; v++)
+			{
+				float dist[3] = {};
+				dist[v] = EdgeDistance(clip, viewportScaleX, viewportScaleY, v);
+
+				triangle[v] = { clip[v], { dist[0], dist[1], dist[2] } };
+			}
+
+			WireframeDetail::Rasterize(image, triangle);
+		}
+	}
+}
+
+// Reference of the expanded path, each vertex only sees its own three positions and
+// its vertex id. expanded is ExpandTriangles output for float xyz positions.
+inline void RenderWireframeExpanded(WireframeImage& image, const float* expanded, const std::span<const IndexedRange> ranges, const float (&m)[4][4], const float viewportScaleX, const float viewportScaleY)
+{
+	auto VertexShader = [&](const uint32_t vertexId) -> WireframeVertex
+	{
+		const float* p = expanded + size_t(vertexId) * 9;
+
+		const ClipPosition clip[3] = {
+			TransformPoint(LoadFloat3(p + 0), m),
+			TransformPoint(LoadFloat3(p + 3), m),
+			TransformPoint(LoadFloat3(p + 6), m) };
+
+		const uint32_t corner = vertexId % 3;
+
+		float dist[3] = {};
+		dist[corner] = EdgeDistance(clip, viewportScaleX, viewportScaleY, corner);
+
+		return { clip[corner], { dist[0], dist[1], dist[2] } };
+	};
+
+	for (const auto& range : ranges)
+	{
+		for (uint32_t i = range.startIndex; i < range.startIndex + range.indexCount; i += 3)
+		{
+			const WireframeVertex triangle[3] = { VertexShader(i), VertexShader(i + 1), VertexShader(i + 2) };
+			WireframeDetail::Rasterize(image, triangle);
+		}
+	}
+}
+
+struct ImageDifference
+{
+	size_t  pixels              = 0;    // drawn in both
+	size_t  coverageMismatch    = 0;    // drawn in only one
+	float   maxDifference       = 0.0f;
+};
+
+inline ImageDifference CompareImages(const WireframeImage& a, const WireframeImage& b) noexcept
+{
+	ImageDifference out;
+
+	for (size_t i = 0; i < a.color.size() && i < b.color.size(); i++)
+	{
+		const bool drawnA = a.color[i] >= 0.0f;
+		const bool drawnB = b.color[i] >= 0.0f;
+
+		if (drawnA != drawnB)
+			out.coverageMismatch++;
+		else if (drawnA)
+		{
+			out.pixels++;
+			out.maxDifference = std::max(out.maxDifference, std::abs(a.color[i] - b.color[i]));
+		}
+	}
+
+	return out;
+}
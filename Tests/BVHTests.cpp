@@ -0,0 +1,146 @@
+#include "Check.hpp"
+#include "TestMeshes.hpp"
+
+#include "BVH.hpp"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Closest hit over every triangle, what the BVH has to agree with
+static float BruteForce(const TestMesh& mesh, const Ray& ray)
+{
+	float closest = ray.tMax;
+
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+	{
+		const float3 v0 = LoadFloat3(&mesh.positions[3 * size_t(mesh.indices[i])]);
+		const float3 e1 = LoadFloat3(&mesh.positions[3 * size_t(mesh.indices[i + 1])]) - v0;
+		const float3 e2 = LoadFloat3(&mesh.positions[3 * size_t(mesh.indices[i + 2])]) - v0;
+
+		const float3 p   = Cross(ray.direction, e2);
+		const float  det = Dot(e1, p);
+
+		if (std::abs(det) < 1e-12f)
+			continue;
+
+		const float3 s = ray.origin - v0;
+		const float  u = Dot(s, p) / det;
+		const float3 q = Cross(s, e1);
+		const float  v = Dot(ray.direction, q) / det;
+		const float  t = Dot(e2, q) / det;
+
+		if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t > 0.0f && t < closest)
+			closest = t;
+	}
+
+	return closest;
+}
+
+static TriangleBVH Build(const TestMesh& mesh, const BVHBuildMode mode)
+{
+	ThreadPool          threads{ 0 };
+	const IndexedRange  shape{ 0, uint32_t(mesh.indices.size()), 0 };
+
+	TriangleBVH bvh;
+	bvh.Build(threads, mesh.positions.data(), mesh.indices.data(), { &shape, 1 }, mode);
+
+	return bvh;
+}
+
+// Rays from above towards random points of the mesh's xz extent
+static bool MatchesBruteForce(const TestMesh& mesh, const TriangleBVH& bvh, const float extent)
+{
+	std::mt19937                            random{ 5 };
+	std::uniform_real_distribution<float>   position{ -extent, extent };
+
+	for (int r = 0; r < 500; r++)
+	{
+		const Ray   ray     = { { position(random), 10.0f * extent, position(random) }, Normalize(float3{ 0.01f, -1.0f, 0.02f }) };
+		const auto  hit     = bvh.Intersect(ray);
+		const float closest = BruteForce(mesh, ray);
+
+		if (hit.Hit() != (closest != ray.tMax) || (hit.Hit() && std::abs(hit.t - closest) > 1e-3f * closest))
+			return false;
+	}
+
+	return true;
+}
+
+static void TestGrid()
+{
+	const auto mesh = MakeGrid(64);
+
+	for (const auto mode : { BVHBuildMode::SAH, BVHBuildMode::LBVH })
+	{
+		const auto bvh = Build(mesh, mode);
+
+		CHECK(bvh.TriangleCount() == mesh.indices.size() / 3);
+		CHECK(bvh.Depth() <= 64);
+		CHECK(MatchesBruteForce(mesh, bvh, 1.0f));
+	}
+}
+
+// Every triangle in the same place, all Morton codes equal
+static void TestDuplicates()
+{
+	TestMesh mesh;
+	mesh.positions = { -1.0f, 0.0f, -1.0f, 1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f };
+
+	for (uint32_t t = 0; t < 20000; t++)
+		mesh.indices.insert(mesh.indices.end(), { 0, 2, 1 });
+
+	for (const auto mode : { BVHBuildMode::SAH, BVHBuildMode::LBVH })
+	{
+		const auto bvh = Build(mesh, mode);
+
+		CHECK(bvh.Depth() <= 64);
+		CHECK(bvh.Intersect({ { 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f } }).Hit());
+	}
+}
+
+// Triangles at exponentially growing distances, SAH splits peel a few off the far end
+// at a time instead of halving, the tree has to stay within the traversal stack
+static void TestLopsided()
+{
+	TestMesh mesh;
+
+	for (uint32_t t = 0; t < 2000; t++)
+	{
+		const float     x       = std::pow(1.02f, float(t));
+		const uint32_t  base    = uint32_t(mesh.VertexCount());
+
+		mesh.positions.insert(mesh.positions.end(), { x, 0.0f, -0.5f, 1.01f * x, 0.0f, -0.5f, x, 0.0f, 0.5f });
+		mesh.indices.insert(mesh.indices.end(), { base, base + 2, base + 1 });
+	}
+
+	const auto bvh = Build(mesh, BVHBuildMode::SAH);
+
+	CHECK(bvh.Depth() <= 64);
+
+	for (uint32_t t = 0; t < 2000; t += 37)
+	{
+		const float x   = std::pow(1.02f, float(t));
+		const auto  hit = bvh.Intersect({ { 1.005f * x, 1.0f, -0.25f }, { 0.0f, -1.0f, 0.0f } });
+
+		CHECK(hit.Hit() && hit.triangle == t);
+	}
+}
+
+static void TestEmpty()
+{
+	const auto bvh = Build({}, BVHBuildMode::SAH);
+
+	CHECK(bvh.TriangleCount() == 0);
+	CHECK(!bvh.Intersect({ { 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f } }).Hit());
+}
+
+int main()
+{
+	TestGrid();
+	TestDuplicates();
+	TestLopsided();
+	TestEmpty();
+
+	return CheckResult("BVHTests");
+}
@@ -0,0 +1,208 @@
+#include "Check.hpp"
+#include "RecordingContext.hpp"
+#include "TestMeshes.hpp"
+
+#include "Batching.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <vector>
+
+using Triangle = std::array<uint32_t, 3>;
+
+// A grid cut into shapes with a coarser second level each, and per face materials in
+// runs of random length, -1 among them
+struct Scene
+{
+	TestMesh                            mesh;
+	std::vector<std::vector<uint32_t>>  shapeIndices;
+	std::vector<std::vector<uint32_t>>  coarseIndices;
+	std::vector<std::vector<int>>       materials;
+	MergedGeometry                      geometry;
+
+	std::vector<std::span<const int>> FaceMaterials() const
+	{
+		return { materials.begin(), materials.end() };
+	}
+};
+
+static Scene MakeScene(const size_t shapeCount, const int materialCount, const uint32_t seed)
+{
+	Scene scene;
+	scene.mesh = MakeGrid(64);
+
+	std::mt19937                        random{ seed };
+	std::uniform_int_distribution<int>  material{ -1, materialCount - 1 };
+	std::uniform_int_distribution<int>  runLength{ 1, 40 };
+
+	const size_t triangles = scene.mesh.indices.size() / 3;
+
+	for (size_t s = 0; s < shapeCount; s++)
+	{
+		const size_t first  = triangles * s / shapeCount;
+		const size_t last   = triangles * (s + 1) / shapeCount;
+
+		auto& indices = scene.shapeIndices.emplace_back(scene.mesh.indices.begin() + 3 * first, scene.mesh.indices.begin() + 3 * last);
+		scene.coarseIndices.emplace_back(indices.begin(), indices.begin() + 3 * ((last - first) / 4));
+
+		auto& faces = scene.materials.emplace_back();
+
+		while (faces.size() < last - first)
+			faces.insert(faces.end(), std::min<size_t>(runLength(random), last - first - faces.size()), material(random));
+	}
+
+	std::vector<std::vector<std::span<const uint32_t>>> lists;
+	for (size_t s = 0; s < shapeCount; s++)
+		lists.push_back({ scene.shapeIndices[s], scene.coarseIndices[s] });
+
+	scene.geometry = MergeShapes(scene.mesh.positions.data(), scene.mesh.VertexCount(), lists);
+
+	return scene;
+}
+
+// Triangles of one level with merged buffer indices, in shape and face order, with their materials
+static void LevelTriangles(const Scene& scene, const size_t level, std::vector<Triangle>& triangles, std::vector<int>& materials)
+{
+	for (size_t s = 0; s < scene.geometry.shapes.size(); s++)
+	{
+		const auto& shape   = scene.geometry.shapes[s];
+		const auto& range   = shape.ranges[level];
+
+		for (uint32_t face = 0; face < range.indexCount / 3 && face < scene.materials[s].size(); face++)
+		{
+			Triangle tri;
+			for (size_t k = 0; k < 3; k++)
+				tri[k] = scene.geometry.indices[range.startIndex + 3 * face + k] + uint32_t(shape.baseVertex);
+
+			triangles.push_back(tri);
+			materials.push_back(scene.materials[s][face]);
+		}
+	}
+}
+
+// Every face exactly once, in the batch of its material, in shape and face order within it
+static void CheckBatches(const Scene& scene, const MaterialBatches& batches, const size_t level)
+{
+	std::vector<Triangle>   triangles;
+	std::vector<int>        materials;
+	LevelTriangles(scene, level, triangles, materials);
+
+	std::vector<int> distinct = materials;
+	std::sort(distinct.begin(), distinct.end());
+	distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+
+	CHECK(batches.batches.size() == distinct.size());
+	CHECK(batches.indices.size() == 3 * triangles.size());
+
+	uint32_t next = 0;
+
+	for (size_t b = 0; b < batches.batches.size() && b < distinct.size(); b++)
+	{
+		const auto& batch = batches.batches[b];
+
+		CHECK(batch.material == distinct[b]);
+		CHECK(batch.startIndex == next && batch.indexCount > 0 && batch.indexCount % 3 == 0);
+
+		std::vector<Triangle> expected;
+		for (size_t t = 0; t < triangles.size(); t++)
+		{
+			if (materials[t] == batch.material)
+				expected.push_back(triangles[t]);
+		}
+
+		std::vector<Triangle> batched(batch.indexCount / 3);
+		for (size_t t = 0; t < batched.size(); t++)
+			std::copy_n(batches.indices.begin() + batch.startIndex + 3 * t, 3, batched[t].begin());
+
+		CHECK(batched == expected);
+
+		next += batch.indexCount;
+	}
+
+	CHECK(next == batches.indices.size());
+	CHECK(batches.maxIndex == *std::max_element(batches.indices.begin(), batches.indices.end()));
+	CHECK(batches.Fits16BitIndices() == (batches.maxIndex < 0x10000));
+}
+
+static void TestManyMaterials()
+{
+	for (const int materialCount : { 1, 3, 12, 40 })
+	{
+		const auto scene = MakeScene(24, materialCount, uint32_t(materialCount));
+
+		CheckBatches(scene, BatchByMaterial(scene.geometry, scene.FaceMaterials()), 0);
+
+		// The coarse level has fewer faces than material entries, the rest are ignored
+		CheckBatches(scene, BatchByMaterial(scene.geometry, scene.FaceMaterials(), 1), 1);
+	}
+
+	// Nothing to batch
+	const auto empty = BatchByMaterial(MergedGeometry{}, {});
+	CHECK(empty.batches.empty() && empty.indices.empty());
+}
+
+// Per shape and material runs against one draw per material, through the state cache
+static void TestDrawCounts()
+{
+	const auto  scene           = MakeScene(24, 12, 7);
+	const auto  faceMaterials   = scene.FaceMaterials();
+	const auto  batches         = BatchByMaterial(scene.geometry, faceMaterials);
+
+	const uint32_t  stride  = 12;
+	const uint32_t  offset  = 0;
+
+	MockBuffer          vertices, mergedIndices, batchIndices;
+	MockBuffer* const   vertexBuffers[] = { &vertices };
+
+	// Without batching, one draw per run of a material within a shape
+	RecordingContext    runsContext;
+	MockStateCache      runs{ &runsContext };
+
+	for (size_t s = 0; s < scene.geometry.shapes.size(); s++)
+	{
+		const auto& shape = scene.geometry.shapes[s];
+		const auto& faces = scene.materials[s];
+
+		for (size_t face = 0; face < faces.size();)
+		{
+			size_t end = face + 1;
+			while (end < faces.size() && faces[end] == faces[face])
+				end++;
+
+			runs.IASetVertexBuffers(0, 1, vertexBuffers, &stride, &offset);
+			runs.IASetIndexBuffer(&mergedIndices, 0, 0);
+			runs.DrawIndexed(uint32_t(3 * (end - face)), shape.ranges[0].startIndex + uint32_t(3 * face), shape.baseVertex);
+
+			face = end;
+		}
+	}
+
+	CHECK(runsContext.Count("DrawIndexed") == CountMaterialRuns(faceMaterials));
+	CHECK(CountMaterialRuns(faceMaterials) > 10 * batches.batches.size());
+
+	RecordingContext    batchedContext;
+	MockStateCache      batched{ &batchedContext };
+
+	for (const auto& batch : batches.batches)
+	{
+		batched.IASetVertexBuffers(0, 1, vertexBuffers, &stride, &offset);
+		batched.IASetIndexBuffer(&batchIndices, 0, 0);
+		batched.DrawIndexed(batch.indexCount, batch.startIndex, 0);
+	}
+
+	CHECK(batchedContext.Count("IASetVertexBuffers") == 1);
+	CHECK(batchedContext.Count("IASetIndexBuffer") == 1);
+	CHECK(batchedContext.Count("DrawIndexed") == batches.batches.size());
+	CHECK(batches.batches.size() == 13);
+}
+
+int main()
+{
+	TestManyMaterials();
+	TestDrawCounts();
+
+	return CheckResult("BatchingTests");
+}
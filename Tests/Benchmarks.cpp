@@ -0,0 +1,513 @@
+#include "TestMeshes.hpp"
+
+#include "BVH.hpp"
+#include "Bounds.hpp"
+#include "CommandBuffer.hpp"
+#include "Culling.hpp"
+#include "FrameGraph.hpp"
+#include "MeshCodec.hpp"
+#include "Meshlets.hpp"
+#include "ParallelCommands.hpp"
+#include "RingAllocator.hpp"
+#include "TransientTextures.hpp"
+#include "Threading.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string_view>
+#include <vector>
+
+// Timings of the Shared components, kept out of ObjLoader so its startup only loads.
+// Benchmarks [filter] runs the benchmarks whose name contains filter.
+
+using Clock = std::chrono::high_resolution_clock;
+
+static double Milliseconds(const Clock::time_point begin, const Clock::time_point end)
+{
+	return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+static void MeshCodec(const TestMesh& mesh)
+{
+	const auto encodedVertices  = EncodeVertexBuffer(mesh.positions.data(), mesh.VertexCount(), 3 * sizeof(float));
+	const auto encodedIndices   = EncodeIndexBuffer(mesh.indices.data(), mesh.indices.size());
+
+	const size_t rawBytes       = mesh.positions.size() * sizeof(float) + mesh.indices.size() * sizeof(uint32_t);
+	const size_t encodedBytes   = encodedVertices.size() + encodedIndices.size();
+
+	std::vector<float>      positions(mesh.positions.size());
+	std::vector<uint32_t>   indices(mesh.indices.size());
+
+	const size_t    repeats = 20;
+	bool            decoded = true;
+
+	const auto decodeBegin = Clock::now();
+
+	for (size_t repeat = 0; repeat < repeats; repeat++)
+	{
+		decoded &= DecodeVertexBuffer(encodedVertices.data(), encodedVertices.size(), positions.data(), mesh.VertexCount(), 3 * sizeof(float));
+		decoded &= DecodeIndexBuffer(encodedIndices.data(), encodedIndices.size(), indices.data(), indices.size());
+	}
+
+	const auto      decodeEnd   = Clock::now();
+	const double    seconds     = Milliseconds(decodeBegin, decodeEnd) / 1000.0 / repeats;
+
+	printf("mesh codec: %zu -> %zu bytes, decoded at %.2f GB/s%s\n", rawBytes, encodedBytes,
+		rawBytes / std::max(seconds, 1e-9) / 1e9, decoded ? "" : ", DECODE FAILED");
+}
+
+// Meshlets of a closed sphere at the default and a smaller size, culled from outside
+static void MeshletCulling()
+{
+	const auto sphere = MakeSphere(256, 512);
+
+	const float eye[3]      = { 0.0f, 0.0f, -10.0f };
+	const float target[3]   = { 0.0f, 0.0f, 0.0f };
+
+	float pv[4][4];
+	MakeViewProjection(eye, target, 3.1415927f / 4.0f, 1.0f, 0.1f, 100.0f, pv);
+
+	const Frustum frustum = ExtractFrustum(pv);
+
+	for (const auto limits : { MeshletLimits{}, MeshletLimits{ 64, 32 } })
+	{
+		const auto buildBegin   = Clock::now();
+		const auto meshlets     = BuildMeshlets(sphere.positions.data(), sphere.VertexCount(), sphere.indices.data(), sphere.indices.size(), limits);
+		const auto buildEnd     = Clock::now();
+
+		std::vector<uint32_t> visible;
+
+		const auto cullBegin    = Clock::now();
+		const auto stats        = CullMeshlets(meshlets, frustum, { eye[0], eye[1], eye[2] }, visible);
+		const auto cullEnd      = Clock::now();
+
+		printf("meshlets: %zu/%zu limits, %zu meshlets built in %.3f ms, culled in %.3f ms, %zu backface culled, triangles %zu / %zu\n",
+			limits.maxVertices, limits.maxTriangles, stats.meshlets, Milliseconds(buildBegin, buildEnd), Milliseconds(cullBegin, cullEnd),
+			stats.backfaceCulled, stats.trianglesVisible, stats.trianglesTotal);
+	}
+}
+
+// Bounds of every shape and sub-mesh recomputed as on a hot reload, the grid cut into
+// 1024 shapes of two sub-meshes each
+static void BoundsReload(ThreadPool& threads, const TestMesh& mesh)
+{
+	const size_t    shapeCount  = 1024;
+	const size_t    repeats     = 20;
+
+	// Shapes as index runs of whole triangles, their vertex ranges over the whole grid
+	const size_t shapeIndices = mesh.indices.size() / shapeCount / 6 * 6;
+
+	std::vector<VertexRange>    shapes;
+	std::vector<IndexedRange>   subMeshes;
+
+	for (size_t s = 0; s < shapeCount; s++)
+	{
+		const uint32_t start = uint32_t(s * shapeIndices);
+
+		shapes.push_back({ uint32_t(s * mesh.VertexCount() / shapeCount), uint32_t(mesh.VertexCount() / shapeCount) });
+		subMeshes.push_back({ start, uint32_t(shapeIndices / 2), 0 });
+		subMeshes.push_back({ start + uint32_t(shapeIndices / 2), uint32_t(shapeIndices / 2), 0 });
+	}
+
+	ThreadPool single{ 0 };
+
+	for (ThreadPool* pool : { &single, &threads })
+	{
+		size_t rows = 0;
+
+		const auto reloadBegin = Clock::now();
+
+		for (size_t repeat = 0; repeat < repeats; repeat++)
+		{
+			rows += ComputeBounds(*pool, mesh.positions.data(), shapes).Size();
+			rows += ComputeBounds(*pool, mesh.positions.data(), mesh.indices.data(), subMeshes).Size();
+		}
+
+		const auto reloadEnd = Clock::now();
+
+		printf("bounds: %zu shapes and %zu sub-meshes over %zu vertices, %zu threads, %s, recomputed in %.3f ms%s\n",
+			shapes.size(), subMeshes.size(), mesh.VertexCount(), pool->ThreadCount(), HasAVX2() ? "AVX2" : "scalar",
+			Milliseconds(reloadBegin, reloadEnd) / repeats, rows == repeats * (shapes.size() + subMeshes.size()) ? "" : ", MISMATCH");
+	}
+}
+
+// Random boxes around the origin, the camera looks at them from outside
+static void FrustumCulling(ThreadPool& threads)
+{
+	const size_t    boxCount    = 200000;
+	const size_t    repeats     = 50;
+
+	std::mt19937                            random{ 3 };
+	std::uniform_real_distribution<float>   position{ -50.0f, 50.0f };
+	std::uniform_real_distribution<float>   size{ 0.1f, 2.0f };
+
+	BoundsTable bounds;
+	bounds.Resize(boxCount);
+
+	for (size_t i = 0; i < boxCount; i++)
+	{
+		const float3 min = { position(random), position(random), position(random) };
+		bounds.SetAABB(i, { min, min + float3{ size(random), size(random), size(random) } });
+	}
+
+	const float eye[3]      = { 0.0f, 5.0f, -80.0f };
+	const float target[3]   = { 0.0f, 0.0f, 0.0f };
+
+	float pv[4][4];
+	MakeViewProjection(eye, target, 3.1415927f / 4.0f, 1.0f, 0.1f, 200.0f, pv);
+
+	const Frustum frustum = ExtractFrustum(pv);
+
+	std::vector<uint32_t> reference(boxCount);
+	reference.resize(CullingDetail::CullScalar(frustum, bounds, 0, boxCount, reference.data()));
+
+	std::vector<uint32_t> visible;
+	ThreadPool            single{ 0 };
+
+	for (ThreadPool* pool : { &single, &threads })
+	{
+		const auto cullBegin = Clock::now();
+
+		for (size_t repeat = 0; repeat < repeats; repeat++)
+			FrustumCull(*pool, frustum, bounds, visible);
+
+		const auto cullEnd = Clock::now();
+
+		printf("frustum culling: %zu boxes, %zu visible, %zu threads, %s, %.3f ms%s\n", boxCount, visible.size(), pool->ThreadCount(),
+			HasAVX2() ? "AVX2" : "scalar", Milliseconds(cullBegin, cullEnd) / repeats, visible == reference ? "" : ", MISMATCH");
+	}
+}
+
+// Build times of both modes and the rate of rays cast down at the grid
+static void BVHBuild(ThreadPool& threads, const TestMesh& mesh)
+{
+	const IndexedRange shape{ 0, uint32_t(mesh.indices.size()), 0 };
+
+	for (const auto mode : { BVHBuildMode::SAH, BVHBuildMode::LBVH })
+	{
+		TriangleBVH bvh;
+
+		const auto buildBegin = Clock::now();
+		bvh.Build(threads, mesh.positions.data(), mesh.indices.data(), { &shape, 1 }, mode);
+		const auto buildEnd = Clock::now();
+
+		const size_t rayCount   = 256 * 256;
+		size_t       hits       = 0;
+
+		const auto castBegin = Clock::now();
+
+		for (size_t r = 0; r < rayCount; r++)
+		{
+			const float x = 2.0f * (r % 256) / 255.0f - 1.0f;
+			const float z = 2.0f * (r / 256) / 255.0f - 1.0f;
+
+			hits += bvh.Intersect({ { x, 1.0f, z }, { 0.0f, -1.0f, 0.0f } }).Hit();
+		}
+
+		const auto castEnd = Clock::now();
+
+		printf("%s BVH: %zu triangles, %zu nodes, depth %zu in %.3f ms, %zu rays (%zu hits) in %.3f ms\n",
+			mode == BVHBuildMode::SAH ? "SAH" : "LBVH", bvh.TriangleCount(), bvh.NodeCount(), bvh.Depth(),
+			Milliseconds(buildBegin, buildEnd), rayCount, hits, Milliseconds(castBegin, castEnd));
+	}
+}
+
+// Recording and sorting at a draw count well beyond the sample scene
+static void CommandRecording(ThreadPool& threads)
+{
+	const size_t    drawCount   = 1 << 17;
+	const size_t    repeats     = 20;
+	uint32_t        random      = 1;
+
+	CommandBuffer commands;
+	commands.Reserve(drawCount);
+
+	double recordTime   = 0.0;
+	double sortTime     = 0.0;
+
+	for (size_t repeat = 0; repeat < repeats; repeat++)
+	{
+		commands.Clear();
+
+		const auto recordBegin = Clock::now();
+
+		for (size_t i = 0; i < drawCount; i++)
+		{
+			random = random * 1664525u + 1013904223u;
+			commands.Draw(MakeSortKey(random >> 30, (random >> 24) & 1, (random >> 12) & 0xff, float(random & 0xfff)), { uint16_t(random & 1), uint16_t(random % 6), 36, uint32_t(36 * i) });
+		}
+
+		const auto sortBegin = Clock::now();
+		commands.Sort(threads);
+		const auto sortEnd = Clock::now();
+
+		recordTime  += Milliseconds(recordBegin, sortBegin);
+		sortTime    += Milliseconds(sortBegin, sortEnd);
+	}
+
+	printf("command buffer: %zu draws recorded in %.3f ms, sorted in %.3f ms on %zu threads\n", drawCount,
+		recordTime / repeats, sortTime / repeats, threads.ThreadCount());
+}
+
+// The same draws recorded in parallel chunks, doubling the thread count up to the pool's
+static void ParallelRecording(ThreadPool& threads)
+{
+	const size_t drawCount  = 1 << 17;
+	const size_t repeats    = 20;
+
+	auto Record = [](CommandBuffer& out, const size_t begin, const size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			uint32_t r = uint32_t(i) * 2654435761u;
+			r ^= r >> 15;
+
+			out.Draw(MakeSortKey(r >> 30, (r >> 24) & 1, (r >> 12) & 0xff, float(r & 0xfff)), { uint16_t(r & 1), uint16_t(r % 6), 36, uint32_t(36 * i) });
+		}
+	};
+
+	double singleThreaded = 0.0;
+
+	for (size_t threadCount = 1; threadCount <= threads.ThreadCount(); threadCount *= 2)
+	{
+		ThreadPool          pool{ threadCount - 1 };
+		ParallelRecorder    recorder;
+		CommandBuffer       merged;
+
+		merged.Reserve(drawCount);
+
+		const auto recordBegin = Clock::now();
+
+		for (size_t repeat = 0; repeat < repeats; repeat++)
+		{
+			merged.Clear();
+			recorder.Record(pool, drawCount, 4096, merged, Record);
+		}
+
+		const auto      recordEnd   = Clock::now();
+		const double    duration    = Milliseconds(recordBegin, recordEnd) / repeats;
+
+		if (threadCount == 1)
+			singleThreaded = duration;
+
+		printf("parallel recording: %zu threads, %zu draws in %.3f ms, %.2fx\n", threadCount, merged.Size(), duration, singleThreaded / duration);
+	}
+}
+
+// Small allocations from a 4 MB ring with three frames in flight
+static void RingAllocation()
+{
+	const size_t    allocationCount = 1 << 20;
+	RingAllocator   allocator{ 4 * 1024 * 1024, 16 };
+	uint64_t        frame           = 1;
+	size_t          failed          = 0;
+
+	const auto allocateBegin = Clock::now();
+
+	for (size_t i = 0; i < allocationCount; i++)
+	{
+		failed += allocator.Allocate(64 + 16 * (i % 61)) == RingAllocator::invalid;
+
+		if (i % 1024 == 1023)
+		{
+			allocator.EndFrame(frame++);
+
+			if (frame > 3)
+				allocator.Retire(frame - 3);
+		}
+	}
+
+	const auto allocateEnd = Clock::now();
+
+	printf("ring allocator: %zu allocations in %.3f ms, %zu failed\n", allocationCount, Milliseconds(allocateBegin, allocateEnd), failed);
+}
+
+// UploadRing's CPU side: 64 KB writes, 16 per frame, into a 4 MB ring in host memory with
+// the GPU two frames behind. Mapping the real buffer needs a device and is not included.
+static void UploadStreaming()
+{
+	const size_t            writeSize   = 64 * 1024;
+	const size_t            writeCount  = 1024;
+	const uint64_t          latency     = 2;
+
+	RingAllocator           ring{ 4 * 1024 * 1024, 16 };
+	std::vector<uint8_t>    buffer(ring.Capacity());
+	std::vector<uint8_t>    payload(writeSize, 1);
+	uint64_t                frame       = 1;
+	uint64_t                completed   = 0;
+	size_t                  waits       = 0;
+
+	const auto uploadBegin = Clock::now();
+
+	for (size_t i = 0; i < writeCount; i++)
+	{
+		const size_t offset = ring.Allocate(payload.size(), [&] { return ++completed; }, &waits);
+
+		if (offset != RingAllocator::invalid)
+			std::memcpy(buffer.data() + offset, payload.data(), payload.size());
+
+		if (i % 16 == 15)
+		{
+			ring.EndFrame(frame++);
+
+			if (frame > latency + 1)
+				ring.Retire(completed = std::max(completed, frame - latency - 1));
+		}
+	}
+
+	const auto      uploadEnd   = Clock::now();
+	const double    duration    = Milliseconds(uploadBegin, uploadEnd);
+	const double    megabytes   = double(writeSize * writeCount) / (1024.0 * 1024.0);
+
+	printf("upload ring: %.0f MB in %.3f ms, %.2f GB/s, %zu waits on a full ring\n", megabytes, duration, megabytes / duration * 1000.0 / 1024.0, waits);
+}
+
+// Transient targets of a typical post chain at 1080p: scene color and depth, a bloom
+// pyramid blurred twice per level through ping pong targets, then tonemapping
+static void TransientMemory()
+{
+	auto Key = [](const uint32_t width, const uint32_t height, const uint32_t format, const uint32_t bytesPerTexel, const uint32_t bindFlags)
+	{
+		TextureKey key;
+		key.width           = width;
+		key.height          = height;
+		key.format          = format;
+		key.bindFlags       = bindFlags;
+		key.bytesPerTexel   = bytesPerTexel;
+
+		return key;
+	};
+
+	// DXGI_FORMAT_R16G16B16A16_FLOAT, D32_FLOAT and R8G8B8A8_UNORM, render target | shader resource or depth stencil
+	const uint32_t width        = 1920;
+	const uint32_t height       = 1080;
+	const uint32_t targetBinds  = 0x28;
+
+	std::vector<TransientRequest>   requests;
+	std::vector<size_t>             pyramid;
+	uint32_t                        pass = 1;
+
+	const size_t sceneColor = requests.size();
+	requests.push_back({ Key(width, height, 10, 8, targetBinds), 0, 0 });
+	requests.push_back({ Key(width, height, 40, 4, 0x40), 0, 0 });
+
+	for (uint32_t level = 1; level <= 4; level++)
+	{
+		const auto key = Key(std::max(1u, width >> level), std::max(1u, height >> level), 10, 8, targetBinds);
+
+		// Downsample, then blur horizontally into a temporary and vertically back, twice
+		pyramid.push_back(requests.size());
+		requests.push_back({ key, pass++, 0 });
+
+		for (size_t blur = 0; blur < 2; blur++, pass += 2)
+			requests.push_back({ key, pass, pass + 1 });
+	}
+
+	// Tonemapping reads the scene and every level
+	const uint32_t tonemap = pass;
+
+	requests[sceneColor].lastPass = tonemap;
+	for (const size_t level : pyramid)
+		requests[level].lastPass = tonemap;
+
+	requests.push_back({ Key(width, height, 28, 4, targetBinds), tonemap, tonemap });
+
+	const auto planBegin    = Clock::now();
+	const auto plan         = PlanAliasing(requests);
+	const auto planEnd      = Clock::now();
+
+	printf("transient textures: %zu requests in %zu textures, %.1f MB without aliasing, %.1f MB aliased, %.1f MB peak live, planned in %.3f ms\n",
+		requests.size(), plan.slots.size(), plan.unaliasedBytes / (1024.0 * 1024.0), plan.aliasedBytes / (1024.0 * 1024.0), plan.peakLiveBytes / (1024.0 * 1024.0),
+		Milliseconds(planBegin, planEnd));
+}
+
+// Declaring and compiling 512 passes in chains of 8 at 1080p, every fourth chain ends nowhere
+static void FrameGraphCompile()
+{
+	const size_t    passCount   = 512;
+	const size_t    repeats     = 100;
+
+	FrameGraph<int> graph;
+	double          declare     = 0.0;
+	double          compile     = 0.0;
+
+	for (size_t repeat = 0; repeat < repeats; repeat++)
+	{
+		const auto declareBegin = Clock::now();
+
+		graph.Reset();
+
+		const auto          output      = graph.Import("back buffer", 1);
+		FrameGraphResource  previous    = 0;
+
+		for (size_t i = 0; i < passCount; i++)
+		{
+			TextureKey key;
+			key.width           = 1920u >> (i % 4);
+			key.height          = 1080u >> (i % 4);
+			key.format          = 10;       // DXGI_FORMAT_R16G16B16A16_FLOAT
+			key.bindFlags       = 0x20;     // render target
+			key.bytesPerTexel   = 8;
+
+			const auto target = graph.CreateTexture("target", key);
+
+			graph.AddPass("post",
+				[&](auto& pass)
+				{
+					if (i % 8)
+						pass.Read(previous);
+
+					pass.Write(target);
+
+					if (i % 8 == 7 && i % 32 != 31)
+						pass.Write(output);
+				},
+				nullptr);
+
+			previous = target;
+		}
+
+		const auto compileBegin = Clock::now();
+		graph.Compile();
+		const auto compileEnd = Clock::now();
+
+		declare += Milliseconds(declareBegin, compileBegin);
+		compile += Milliseconds(compileBegin, compileEnd);
+	}
+
+	printf("frame graph: %zu passes, %zu culled, %zu transient textures in %zu slots, declared in %.3f ms, compiled in %.3f ms\n",
+		graph.PassCount(), graph.CulledPasses(), graph.Plan().slotOf.size(), graph.Plan().slots.size(), declare / repeats, compile / repeats);
+}
+
+int main(int argc, const char* argv[])
+{
+	const std::string_view filter = argc > 1 ? argv[1] : "";
+
+	auto Run = [&](const std::string_view name, auto&& benchmark)
+	{
+		if (name.find(filter) != std::string_view::npos)
+			benchmark();
+	};
+
+	ThreadPool threads;
+
+	// About half a million triangles
+	const auto mesh = MakeGrid(512);
+
+	Run("codec",      [&] { MeshCodec(mesh); });
+	Run("meshlets",   [&] { MeshletCulling(); });
+	Run("bounds",     [&] { BoundsReload(threads, mesh); });
+	Run("culling",    [&] { FrustumCulling(threads); });
+	Run("bvh",        [&] { BVHBuild(threads, mesh); });
+	Run("commands",   [&] { CommandRecording(threads); });
+	Run("parallel",   [&] { ParallelRecording(threads); });
+	Run("ring",       [&] { RingAllocation(); });
+	Run("upload",     [&] { UploadStreaming(); });
+	Run("transient",  [&] { TransientMemory(); });
+	Run("framegraph", [&] { FrameGraphCompile(); });
+
+	return 0;
+}
@@ -0,0 +1,170 @@
+#include "Check.hpp"
+
+#include "Bounds.hpp"
+#include "Threading.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static std::vector<float> RandomPositions(const size_t vertexCount, const uint32_t seed)
+{
+	std::mt19937                            random{ seed };
+	std::uniform_real_distribution<float>   coordinate{ -100.0f, 100.0f };
+
+	std::vector<float> positions(3 * vertexCount);
+	for (auto& p : positions)
+		p = coordinate(random);
+
+	return positions;
+}
+
+static bool SameAABB(const AABB& a, const AABB& b)
+{
+	return a.min.x == b.min.x && a.min.y == b.min.y && a.min.z == b.min.z
+		&& a.max.x == b.max.x && a.max.y == b.max.y && a.max.z == b.max.z;
+}
+
+// The AVX2 radius uses fused multiply adds, the scalar one does not
+static bool NearlyEqual(const float a, const float b)
+{
+	return std::abs(a - b) <= 1e-5f * std::max({ 1.0f, std::abs(a), std::abs(b) });
+}
+
+// Every AVX2 kernel against its scalar reference, over lengths and starts that leave
+// tails of every size
+static void TestKernels()
+{
+	using namespace BoundsDetail;
+
+	if (!HasAVX2())
+	{
+		std::printf("BoundsTests: no AVX2, only the scalar path runs\n");
+		return;
+	}
+
+	const size_t    vertexCount = 2048;
+	const auto      positions   = RandomPositions(vertexCount, 1);
+
+	std::mt19937                            random{ 2 };
+	std::uniform_int_distribution<uint32_t> vertex{ 0, 1023 };
+
+	std::vector<uint32_t> indices(vertexCount);
+	for (auto& i : indices)
+		i = vertex(random);
+
+	const float3    center  = { 1.0f, -2.0f, 3.0f };
+	const int32_t   base    = 1000;
+
+	std::vector<size_t> lengths;
+	for (size_t n = 0; n <= 40; n++)
+		lengths.push_back(n);
+
+	for (const size_t n : { 255, 256, 257, 1001, 1023 })
+		lengths.push_back(n);
+
+	for (const size_t begin : { 0, 1, 3, 7 })
+	{
+		for (const size_t n : lengths)
+		{
+			const size_t end = begin + n;
+
+			auto Contiguous = [](size_t v) { return v; };
+			auto Indexed    = [&](size_t v) { return indices[v] + base; };
+			auto Offset     = [&](size_t v) { return v + base; };
+
+			CHECK(SameAABB(AccumulateAABBContiguousAVX2(positions.data(), begin, end), AccumulateAABB(positions.data(), begin, end, Contiguous)));
+			CHECK(SameAABB(AccumulateAABBIndexedAVX2(positions.data(), indices.data(), base, begin, end), AccumulateAABB(positions.data(), begin, end, Indexed)));
+
+			CHECK(NearlyEqual(AccumulateRadiusSqAVX2(positions.data(), nullptr, base, begin, end, center), AccumulateRadiusSq(positions.data(), begin, end, center, Offset)));
+			CHECK(NearlyEqual(AccumulateRadiusSqAVX2(positions.data(), indices.data(), base, begin, end, center), AccumulateRadiusSq(positions.data(), begin, end, center, Indexed)));
+		}
+	}
+}
+
+// Whole tables against a brute force pass, with ranges split into several jobs and
+// ones too short for a single SIMD iteration
+static void TestComputeBounds()
+{
+	const size_t    chunk       = BoundsDetail::chunkSize;
+	const size_t    vertexCount = 3 * chunk + 1000;
+	const auto      positions   = RandomPositions(vertexCount, 3);
+
+	const std::vector<VertexRange> ranges = {
+		{ 0, uint32_t(2 * chunk + 5) },
+		{ uint32_t(2 * chunk + 5), 7 },
+		{ 17, 0 },
+		{ 100, uint32_t(chunk) },
+		{ uint32_t(vertexCount - 9), 9 },
+	};
+
+	std::vector<uint32_t> indices;
+	for (size_t i = 0; i < chunk + 13; i++)
+		indices.push_back(uint32_t(i * 7919 % 5000));
+
+	const std::vector<IndexedRange> indexed = {
+		{ 0, uint32_t(chunk + 13), 0 },
+		{ 5, 3, int32_t(vertexCount - 5000) },
+		{ 0, 0, 0 },
+		{ 1000, 21, 77 },
+	};
+
+	auto Reference = [&](auto&& index, const size_t count, AABB& aabb, float& radius)
+	{
+		aabb = BoundsDetail::AccumulateAABB(positions.data(), 0, count, index);
+
+		if (aabb.Empty())
+			aabb = AABB{ {}, {} };
+
+		radius = std::sqrt(BoundsDetail::AccumulateRadiusSq(positions.data(), 0, count, aabb.Center(), index));
+	};
+
+	ThreadPool single{ 0 };
+	ThreadPool workers{ 3 };
+
+	for (ThreadPool* threads : { &single, &workers })
+	{
+		const auto table = ComputeBounds(*threads, positions.data(), ranges);
+		CHECK(table.Size() == ranges.size());
+
+		for (size_t row = 0; row < ranges.size() && row < table.Size(); row++)
+		{
+			AABB    aabb;
+			float   radius;
+			Reference([&](size_t v) { return v + ranges[row].firstVertex; }, ranges[row].vertexCount, aabb, radius);
+
+			CHECK(SameAABB(table.GetAABB(row), aabb));
+			CHECK(NearlyEqual(table.GetSphere(row).radius, radius));
+		}
+
+		const auto indexedTable = ComputeBounds(*threads, positions.data(), indices.data(), indexed);
+		CHECK(indexedTable.Size() == indexed.size());
+
+		for (size_t row = 0; row < indexed.size() && row < indexedTable.Size(); row++)
+		{
+			const auto& range = indexed[row];
+
+			AABB    aabb;
+			float   radius;
+			Reference([&](size_t v) { return indices[range.startIndex + v] + range.baseVertex; }, range.indexCount, aabb, radius);
+
+			CHECK(SameAABB(indexedTable.GetAABB(row), aabb));
+			CHECK(NearlyEqual(indexedTable.GetSphere(row).radius, radius));
+		}
+
+		// Empty ranges collapse to the origin
+		CHECK(table.GetSphere(2).radius == 0.0f && SameAABB(table.GetAABB(2), AABB{ {}, {} }));
+		CHECK(indexedTable.GetSphere(2).radius == 0.0f && SameAABB(indexedTable.GetAABB(2), AABB{ {}, {} }));
+	}
+}
+
+int main()
+{
+	TestKernels();
+	TestComputeBounds();
+
+	return CheckResult("BoundsTests");
+}
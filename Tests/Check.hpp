@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdio>
+
+// Minimal checks for the headless tests. A failed check prints its location and
+// expression, the test's main returns CheckResult().
+
+inline int checkFailures = 0;
+
+#define CHECK(condition)                                                                    \
+	do                                                                                      \
+	{                                                                                       \
+		if (!(condition))                                                                   \
+		{                                                                                   \
+			std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);       \
+			checkFailures++;                                                                \
+		}                                                                                   \
+	} while (0)
+
+inline int CheckResult(const char* name)
+{
+	std::printf("%s: %s\n", name, checkFailures ? "FAILED" : "passed");
+	return checkFailures ? 1 : 0;
+}
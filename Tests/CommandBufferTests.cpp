@@ -0,0 +1,160 @@
+#include "Check.hpp"
+
+#include "CommandBuffer.hpp"
+#include "Threading.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Packets carry their recording position in start, keys[start] is their key
+struct Recorded
+{
+	std::vector<uint64_t>   keys;
+	CommandBuffer           commands;
+};
+
+static Recorded Record(const size_t count, const uint32_t distinctKeys, const uint32_t seed)
+{
+	std::mt19937 random{ seed };
+
+	Recorded out;
+	out.commands.Reserve(count);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const uint32_t k    = random() % distinctKeys;
+		const uint64_t key  = MakeSortKey(k % 3, (k / 3) % 5, k / 15, float(k % 7));
+
+		out.keys.push_back(key);
+		out.commands.Draw(key, { uint16_t(k % 2), uint16_t(k % 6), 36, uint32_t(i) });
+	}
+
+	return out;
+}
+
+static std::vector<uint32_t> ReplayOrder(const CommandBuffer& commands, const size_t begin = 0, const size_t end = SIZE_MAX)
+{
+	std::vector<uint32_t> order;
+	commands.ForEach([&](const DrawPacket& packet) { order.push_back(packet.start); }, begin, end);
+
+	return order;
+}
+
+// Pass, then pipeline, then material, then depth front to back
+static void TestKeyLayout()
+{
+	CHECK(MakeSortKey(1, 0, 0, 0.0f) > MakeSortKey(0, 0xfff, 0xffff, 1e30f));
+	CHECK(MakeSortKey(0, 1, 0, 0.0f) > MakeSortKey(0, 0, 0xffff, 1e30f));
+	CHECK(MakeSortKey(0, 0, 1, 0.0f) > MakeSortKey(0, 0, 0, 1e30f));
+	CHECK(MakeSortKey(0, 0, 0, 2.0f) > MakeSortKey(0, 0, 0, 1.0f));
+	CHECK(MakeSortKey(0, 0, 0, 1.0f) > MakeSortKey(0, 0, 0, 0.5f));
+
+	// Behind the camera counts as depth 0, fields too wide for their bits are masked
+	CHECK(MakeSortKey(0, 0, 0, -5.0f) == MakeSortKey(0, 0, 0, 0.0f));
+	CHECK(MakeSortKey(0x11, 0x1001, 0x10001, 0.0f) == MakeSortKey(1, 1, 1, 0.0f));
+}
+
+// Every packet is replayed once, in key order, equal keys in recording order
+static void TestSortOrder(ThreadPool& threads)
+{
+	for (const uint32_t distinctKeys : { 1u, 7u, 200u, 100000u })
+	{
+		for (const size_t count : { size_t(0), size_t(1), size_t(1000), size_t(100000) })
+		{
+			auto recorded = Record(count, distinctKeys, uint32_t(count + distinctKeys));
+			recorded.commands.Sort(threads);
+
+			const auto order = ReplayOrder(recorded.commands);
+
+			std::vector<uint32_t> expected(count);
+			for (uint32_t i = 0; i < count; i++)
+				expected[i] = i;
+
+			std::stable_sort(expected.begin(), expected.end(), [&](uint32_t a, uint32_t b) { return recorded.keys[a] < recorded.keys[b]; });
+
+			CHECK(order == expected);
+		}
+	}
+}
+
+// Thread count changes the sort's work split but never its output
+static void TestSortThreads()
+{
+	ThreadPool  single{ 0 };
+	ThreadPool  several{ 3 };
+
+	auto a = Record(50000, 64, 9);
+	auto b = Record(50000, 64, 9);
+
+	a.commands.Sort(single);
+	b.commands.Sort(several);
+
+	CHECK(ReplayOrder(a.commands) == ReplayOrder(b.commands));
+}
+
+// Appended parts replay like one buffer recorded in their order, slices cover the order once
+static void TestAppendAndSlices(ThreadPool& threads)
+{
+	std::mt19937 random{ 4 };
+
+	CommandBuffer               serial;
+	CommandBuffer               merged;
+	std::vector<CommandBuffer>  parts(5);
+
+	// Packets already in the buffer stay ahead of the appended ones
+	merged.Draw(MakeSortKey(0, 0, 0, 0.0f), { 0, 0, 3, 0 });
+	serial.Draw(MakeSortKey(0, 0, 0, 0.0f), { 0, 0, 3, 0 });
+
+	uint32_t id = 1;
+	for (auto& part : parts)
+	{
+		const size_t count = random() % 3000;
+
+		for (size_t i = 0; i < count; i++, id++)
+		{
+			const uint64_t key = MakeSortKey(0, random() % 4, random() % 4, 0.0f);
+
+			part.Draw(key, { 0, 0, 3, id });
+			serial.Draw(key, { 0, 0, 3, id });
+		}
+	}
+
+	merged.Append(threads, parts);
+
+	CHECK(merged.Size() == serial.Size());
+
+	merged.Sort(threads);
+	serial.Sort(threads);
+
+	const auto order = ReplayOrder(merged);
+
+	CHECK(order == ReplayOrder(serial));
+
+	std::vector<uint32_t> sliced;
+	for (size_t begin = 0; begin < merged.Size(); begin += 777)
+	{
+		const auto slice = ReplayOrder(merged, begin, begin + 777);
+		sliced.insert(sliced.end(), slice.begin(), slice.end());
+	}
+
+	CHECK(sliced == order);
+	CHECK(ReplayOrder(merged, merged.Size(), SIZE_MAX).empty());
+
+	merged.Clear();
+	CHECK(merged.Size() == 0);
+	CHECK(ReplayOrder(merged).empty());
+}
+
+int main()
+{
+	ThreadPool threads{ 3 };
+
+	TestKeyLayout();
+	TestSortOrder(threads);
+	TestSortThreads();
+	TestAppendAndSlices(threads);
+
+	return CheckResult("CommandBufferTests");
+}
@@ -0,0 +1,199 @@
+#include "Check.hpp"
+
+#include "FrameGraph.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Resources are plain ints here, 0 is null
+using Graph = FrameGraph<int>;
+
+static TextureKey Key(const uint32_t size)
+{
+	TextureKey key;
+	key.width   = size;
+	key.height  = size;
+	key.format  = 10;
+
+	return key;
+}
+
+static std::vector<std::string> OrderNames(const Graph& graph)
+{
+	std::vector<std::string> names;
+	for (const auto p : graph.Order())
+		names.push_back(graph.PassName(p));
+
+	return names;
+}
+
+// Only what reaches an imported resource or a side effect survives
+static void TestCulling()
+{
+	Graph graph;
+
+	const auto output   = graph.Import("output", 1);
+	const auto a        = graph.CreateTexture("a", Key(64));
+	const auto b        = graph.CreateTexture("b", Key(64));
+	const auto unused   = graph.CreateTexture("unused", Key(64));
+
+	graph.AddPass("write a",        [&](auto& pass) { pass.Write(a); }, nullptr);
+	graph.AddPass("a to b",         [&](auto& pass) { pass.Read(a); pass.Write(b); }, nullptr);
+	graph.AddPass("dead end",       [&](auto& pass) { pass.Read(a); pass.Write(unused); }, nullptr);
+	graph.AddPass("present",        [&](auto& pass) { pass.Read(b); pass.Write(output); }, nullptr);
+	graph.AddPass("nothing",        [&](auto&) {}, nullptr);
+	graph.AddPass("readback",       [&](auto& pass) { pass.Read(unused); pass.SideEffect(); }, nullptr);
+
+	CHECK(graph.Compile());
+	CHECK(graph.CulledPasses() == 1);
+	CHECK(OrderNames(graph) == (std::vector<std::string>{ "write a", "a to b", "dead end", "present", "readback" }));
+
+	// Without the side effect the readback chain goes as well
+	graph.Reset();
+
+	const auto output2  = graph.Import("output", 1);
+	const auto c        = graph.CreateTexture("c", Key(64));
+	const auto d        = graph.CreateTexture("d", Key(64));
+
+	graph.AddPass("write c",        [&](auto& pass) { pass.Write(c); }, nullptr);
+	graph.AddPass("c to d",         [&](auto& pass) { pass.Read(c); pass.Write(d); }, nullptr);
+	graph.AddPass("present",        [&](auto& pass) { pass.Write(output2); }, nullptr);
+
+	CHECK(graph.Compile());
+	CHECK(graph.CulledPasses() == 2);
+	CHECK(OrderNames(graph) == (std::vector<std::string>{ "present" }));
+	CHECK(graph.Plan().slots.empty());
+}
+
+// Writers run in declaration order and before readers, wherever the readers were declared
+static void TestOrdering()
+{
+	Graph graph;
+
+	const auto output   = graph.Import("output", 1);
+	const auto shadow   = graph.CreateTexture("shadow", Key(1024));
+	const auto scene    = graph.CreateTexture("scene", Key(256));
+
+	graph.AddPass("lighting",       [&](auto& pass) { pass.Read(shadow); pass.Write(scene); }, nullptr);
+	graph.AddPass("tonemap",        [&](auto& pass) { pass.Read(scene); pass.Write(output); }, nullptr);
+	graph.AddPass("shadow",         [&](auto& pass) { pass.Write(shadow); }, nullptr);
+	graph.AddPass("decals",         [&](auto& pass) { pass.Write(scene); }, nullptr);
+	graph.AddPass("ui",             [&](auto& pass) { pass.Write(output); }, nullptr);
+
+	CHECK(graph.Compile());
+	CHECK(graph.CulledPasses() == 0);
+	CHECK(OrderNames(graph) == (std::vector<std::string>{ "shadow", "lighting", "decals", "tonemap", "ui" }));
+
+	// The shadow map lives until lighting, the scene from lighting to tonemapping
+	const auto& plan = graph.Plan();
+
+	CHECK(plan.slotOf.size() == 2);
+	CHECK(plan.slots.size() == 2);
+	CHECK(plan.peakLiveBytes == Key(1024).Bytes() + Key(256).Bytes());
+}
+
+// Passes depending on each other's output cannot be ordered
+static void TestCycle()
+{
+	Graph graph;
+
+	const auto output   = graph.Import("output", 1);
+	const auto x        = graph.CreateTexture("x", Key(64));
+	const auto y        = graph.CreateTexture("y", Key(64));
+
+	graph.AddPass("x to y",         [&](auto& pass) { pass.Read(x); pass.Write(y); }, nullptr);
+	graph.AddPass("y to x",         [&](auto& pass) { pass.Read(y); pass.Write(x); }, nullptr);
+	graph.AddPass("present",        [&](auto& pass) { pass.Read(x); pass.Write(output); }, nullptr);
+
+	CHECK(!graph.Compile());
+	CHECK(graph.Order().empty());
+	CHECK(graph.Plan().slots.empty());
+
+	// A cycle among culled passes does not matter
+	graph.Reset();
+
+	const auto output2  = graph.Import("output", 1);
+	const auto u        = graph.CreateTexture("u", Key(64));
+	const auto v        = graph.CreateTexture("v", Key(64));
+
+	graph.AddPass("u to v",         [&](auto& pass) { pass.Read(u); pass.Write(v); }, nullptr);
+	graph.AddPass("v to u",         [&](auto& pass) { pass.Read(v); pass.Write(u); }, nullptr);
+	graph.AddPass("present",        [&](auto& pass) { pass.Write(output2); }, nullptr);
+
+	CHECK(graph.Compile());
+	CHECK(graph.CulledPasses() == 2);
+}
+
+// A chain of equal targets ping pongs between two textures, passes see them through Get
+static void TestExecute()
+{
+	Graph               graph;
+	TransientPool<int>  pool;
+
+	int                         nextTexture = 100;
+	std::vector<std::string>    ran;
+	std::vector<int>            seen;
+
+	const auto output = graph.Import("output", 1);
+
+	FrameGraphResource previous = Graph::none;
+
+	for (int i = 0; i < 6; i++)
+	{
+		const auto target = graph.CreateTexture("target", Key(128));
+
+		graph.AddPass("blur " + std::to_string(i),
+			[&](auto& pass)
+			{
+				if (previous != Graph::none)
+					pass.Read(previous);
+
+				pass.Write(target);
+			},
+			[&, i, target](const Graph& g) { ran.push_back("blur " + std::to_string(i)); seen.push_back(g.Get(target)); });
+
+		previous = target;
+	}
+
+	graph.AddPass("present", [&](auto& pass) { pass.Read(previous); pass.Write(output); },
+		[&](const Graph& g) { ran.push_back("present"); seen.push_back(g.Get(output)); });
+
+	CHECK(graph.Compile());
+
+	// Compiled but not executed, transients have no texture yet
+	CHECK(graph.Get(previous) == 0);
+
+	graph.Execute(pool, [&](const TextureKey&) { return nextTexture++; });
+
+	CHECK(graph.Plan().slots.size() == 2);
+	CHECK(pool.Created() == 2);
+	CHECK(ran.size() == 7 && ran.front() == "blur 0" && ran.back() == "present");
+	CHECK(seen.size() == 7);
+
+	for (size_t i = 0; i + 1 < 6; i++)
+		CHECK(seen[i] != 0 && seen[i] != seen[i + 1] && (i < 2 || seen[i] == seen[i - 2]));
+
+	CHECK(seen.back() == 1);
+	CHECK(graph.Get(output) == 1);
+	CHECK(graph.Get(previous) == seen[5]);
+
+	// After Reset nothing compiled is left, old handles resolve to null
+	graph.Reset();
+
+	CHECK(graph.Order().empty());
+	CHECK(graph.Plan().slots.empty());
+	CHECK(graph.CulledPasses() == 0);
+	CHECK(graph.Get(previous) == 0);
+	CHECK(graph.Get(output) == 0);
+}
+
+int main()
+{
+	TestCulling();
+	TestOrdering();
+	TestCycle();
+	TestExecute();
+
+	return CheckResult("FrameGraphTests");
+}
@@ -0,0 +1,169 @@
+#include "Check.hpp"
+#include "TestMeshes.hpp"
+
+#include "Instancing.hpp"
+#include "Threading.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <vector>
+
+static bool Near(const float3 a, const float3 b)
+{
+	return Length(a - b) <= 1e-4f;
+}
+
+// Copies of a grid moved along x, the last one with a vertex nudged out of place
+static void TestFindInstances()
+{
+	const auto  grid    = MakeGrid(8);
+	const auto  count   = uint32_t(grid.VertexCount());
+
+	std::vector<float>                  positions;
+	std::vector<std::vector<uint32_t>>  shapes;
+
+	for (uint32_t copy = 0; copy < 4; copy++)
+	{
+		for (size_t i = 0; i < grid.positions.size(); i++)
+			positions.push_back(grid.positions[i] + (i % 3 == 0 ? 3.0f * copy : 0.0f));
+
+		auto& indices = shapes.emplace_back(grid.indices);
+		for (auto& v : indices)
+			v += copy * count;
+	}
+
+	positions[3 * (3 * size_t(count) + 5) + 1] += 0.01f;
+
+	const std::vector<std::span<const uint32_t>> spans(shapes.begin(), shapes.end());
+	const auto groups = FindInstances(positions.data(), spans, {}, 1e-5f);
+
+	CHECK(groups.size() == 2);
+	CHECK(groups[0].prototype == 0 && groups[0].shapes == std::vector<uint32_t>({ 0, 1, 2 }));
+	CHECK(groups[1].prototype == 3 && groups[1].shapes == std::vector<uint32_t>({ 3 }));
+
+	for (size_t i = 0; i < groups[0].transforms.size(); i++)
+		CHECK(Near(groups[0].transforms[i].Apply(float3{ 0.0f, 0.0f, 0.0f }), { 3.0f * i, 0.0f, 0.0f }));
+
+	// Different materials keep copies apart
+	std::vector<std::vector<int>> materials(shapes.size(), std::vector<int>(grid.indices.size() / 3, 0));
+	materials[1][0] = 1;
+
+	const std::vector<std::span<const int>> materialSpans(materials.begin(), materials.end());
+	CHECK(FindInstances(positions.data(), spans, materialSpans, 1e-5f).size() == 3);
+}
+
+// Groups of instances scattered around the camera, more rows than one cull chunk
+static std::vector<InstanceGroup> MakeGroups(const uint32_t seed)
+{
+	std::mt19937                            random{ seed };
+	std::uniform_real_distribution<float>   position{ -100.0f, 100.0f };
+
+	std::vector<InstanceGroup> groups;
+
+	for (const size_t count : { 3000, 1, 0, 2500, 40 })
+	{
+		auto& group = groups.emplace_back();
+
+		for (size_t i = 0; i < count; i++)
+			group.transforms.push_back(InstanceTransform::Translation({ position(random), position(random), position(random) }));
+
+		group.shapes.resize(count);
+	}
+
+	return groups;
+}
+
+// Draws and transforms against culling each instance on its own, group by group
+static void TestDraws()
+{
+	const auto groups = MakeGroups(6);
+
+	BoundsTable prototypes;
+	prototypes.Resize(groups.size());
+
+	for (size_t g = 0; g < groups.size(); g++)
+	{
+		const float size = 0.5f + g;
+
+		prototypes.SetAABB(g, { { -size, -size, -size }, { size, size, size } });
+		prototypes.SetSphere(g, { { 0.0f, 0.0f, 0.0f }, size * 1.7320508f });
+	}
+
+	const auto instances = ComputeInstanceBounds(groups, prototypes);
+
+	CHECK(instances.firstRow.size() == groups.size() + 1);
+	CHECK(instances.bounds.Size() == instances.firstRow.back() && instances.bounds.Size() > CullingDetail::chunkSize);
+
+	const float     eye[3]      = { 0.0f, 0.0f, 0.0f };
+	const float     target[3]   = { 1.0f, 0.2f, 0.5f };
+	const float3    camera      = { eye[0], eye[1], eye[2] };
+
+	float pv[4][4];
+	MakeViewProjection(eye, target, 3.1415927f / 3.0f, 1.0f, 0.1f, 150.0f, pv);
+
+	const Frustum frustum = ExtractFrustum(pv);
+
+	auto SelectLevel = [&](const uint32_t group, const BoundingSphere& bounds)
+	{
+		return std::min(uint32_t(Length(bounds.center - camera) / 25.0f) + group % 2, 4u);
+	};
+
+	// Per group and level, the visible instances in order
+	std::vector<InstanceDraw>       expectedDraws;
+	std::vector<InstanceTransform>  expectedTransforms;
+
+	for (uint32_t g = 0; g < groups.size(); g++)
+	{
+		for (uint32_t level = 0; level <= 4; level++)
+		{
+			const uint32_t first = uint32_t(expectedTransforms.size());
+
+			for (size_t i = 0; i < groups[g].transforms.size(); i++)
+			{
+				const size_t row = instances.firstRow[g] + i;
+
+				CHECK(Near(instances.bounds.GetAABB(row).Center(), groups[g].transforms[i].Apply(float3{ 0.0f, 0.0f, 0.0f })));
+
+				if (CullingDetail::IsVisible(frustum, instances.bounds, row) && SelectLevel(g, instances.bounds.GetSphere(row)) == level)
+					expectedTransforms.push_back(groups[g].transforms[i]);
+			}
+
+			if (expectedTransforms.size() > first)
+				expectedDraws.push_back({ g, level, first, uint32_t(expectedTransforms.size()) - first });
+		}
+	}
+
+	CHECK(expectedDraws.size() > 8 && expectedTransforms.size() < instances.bounds.Size() / 2);
+
+	ThreadPool single{ 0 };
+	ThreadPool workers{ 3 };
+
+	for (ThreadPool* pool : { &single, &workers })
+	{
+		std::vector<InstanceTransform>  transforms;
+		std::vector<InstanceDraw>       draws;
+
+		BuildInstanceDraws(*pool, frustum, groups, instances, SelectLevel, transforms, draws);
+
+		CHECK(draws.size() == expectedDraws.size() && transforms.size() == expectedTransforms.size());
+
+		for (size_t d = 0; d < draws.size() && d < expectedDraws.size(); d++)
+		{
+			CHECK(draws[d].group == expectedDraws[d].group && draws[d].level == expectedDraws[d].level);
+			CHECK(draws[d].firstInstance == expectedDraws[d].firstInstance && draws[d].instanceCount == expectedDraws[d].instanceCount);
+		}
+
+		for (size_t i = 0; i < transforms.size() && i < expectedTransforms.size(); i++)
+			CHECK(std::equal(&transforms[i].rows[0][0], &transforms[i].rows[0][0] + 12, &expectedTransforms[i].rows[0][0]));
+	}
+}
+
+int main()
+{
+	TestFindInstances();
+	TestDraws();
+
+	return CheckResult("InstancingTests");
+}
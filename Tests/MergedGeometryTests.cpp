@@ -0,0 +1,237 @@
+#include "Check.hpp"
+#include "RecordingContext.hpp"
+#include "TestMeshes.hpp"
+
+#include "MergedGeometry.hpp"
+
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <vector>
+
+using ShapeIndexLists = std::vector<std::vector<std::span<const uint32_t>>>;
+
+// Every merged index, offset by its shape's base vertex, lands on the position the
+// source index pointed at
+static void CheckSamePositions(const TestMesh& mesh, const ShapeIndexLists& lists, const MergedGeometry& geometry)
+{
+	CHECK(geometry.shapes.size() == lists.size());
+
+	for (size_t s = 0; s < geometry.shapes.size() && s < lists.size(); s++)
+	{
+		const auto& shape = geometry.shapes[s];
+
+		CHECK(shape.ranges.size() == lists[s].size());
+
+		for (size_t l = 0; l < shape.ranges.size() && l < lists[s].size(); l++)
+		{
+			const auto& range = shape.ranges[l];
+			CHECK(range.indexCount == lists[s][l].size());
+
+			for (uint32_t i = 0; i < range.indexCount; i++)
+			{
+				const uint32_t local = geometry.indices[range.startIndex + i];
+				const uint32_t from  = lists[s][l][i];
+				const size_t   to    = size_t(shape.baseVertex) + local;
+
+				CHECK(local < shape.vertexCount);
+				CHECK(geometry.positions[3 * to + 0] == mesh.positions[3 * from + 0]);
+				CHECK(geometry.positions[3 * to + 1] == mesh.positions[3 * from + 1]);
+				CHECK(geometry.positions[3 * to + 2] == mesh.positions[3 * from + 2]);
+			}
+		}
+	}
+}
+
+// Shapes take consecutive vertex ranges, shared source vertices are copied into each
+static void TestBaseVertex()
+{
+	const auto grid = MakeGrid(8);
+
+	// The lower and the upper half, overlapping in the middle row
+	const size_t half = grid.indices.size() / 2;
+
+	const std::vector<uint32_t> lower(grid.indices.begin(), grid.indices.begin() + half);
+	const std::vector<uint32_t> upper(grid.indices.begin() + half, grid.indices.end());
+	const std::vector<uint32_t> single = { 80, 0, 40 };
+
+	const ShapeIndexLists   lists       = { { lower }, { upper }, { single } };
+	const auto              geometry    = MergeShapes(grid.positions.data(), grid.VertexCount(), lists);
+
+	CheckSamePositions(grid, lists, geometry);
+
+	CHECK(geometry.shapes[0].baseVertex == 0);
+	CHECK(geometry.shapes[0].vertexCount == 5 * 9);
+	CHECK(geometry.shapes[1].baseVertex == 5 * 9);
+	CHECK(geometry.shapes[1].vertexCount == 5 * 9);
+	CHECK(geometry.shapes[2].baseVertex == 10 * 9);
+	CHECK(geometry.shapes[2].vertexCount == 3);
+
+	// Local indices number vertices in first use order
+	CHECK(geometry.indices[geometry.shapes[2].ranges[0].startIndex + 0] == 0);
+	CHECK(geometry.indices[geometry.shapes[2].ranges[0].startIndex + 1] == 1);
+	CHECK(geometry.indices[geometry.shapes[2].ranges[0].startIndex + 2] == 2);
+
+	CHECK(geometry.positions.size() == 3 * (10 * 9 + 3));
+	CHECK(geometry.maxShapeVertices == 5 * 9);
+}
+
+// 16 bit indices depend on the largest shape, not on the merged vertex count
+static void Test16BitFit()
+{
+	const uint32_t      limit = 0x10000;
+	std::vector<float>  positions(3 * size_t(2 * limit + 1));
+
+	std::iota(positions.begin(), positions.end(), 0.0f);
+
+	std::vector<uint32_t> first(limit);
+	std::vector<uint32_t> second(limit);
+	std::vector<uint32_t> large(limit + 1);
+
+	std::iota(first.begin(), first.end(), 0u);
+	std::iota(second.begin(), second.end(), limit);
+	std::iota(large.begin(), large.end(), 0u);
+
+	// Triangles are not required here, every list is one index run
+	const auto fits = MergeShapes(positions.data(), positions.size() / 3, { { first }, { second } });
+
+	CHECK(fits.positions.size() / 3 == 2 * size_t(limit));
+	CHECK(fits.maxShapeVertices == limit);
+	CHECK(fits.Fits16BitIndices());
+
+	const auto indices16 = fits.Indices16();
+	CHECK(indices16.size() == fits.indices.size());
+
+	for (size_t i = 0; i < indices16.size(); i++)
+		CHECK(indices16[i] == fits.indices[i]);
+
+	const auto tooLarge = MergeShapes(positions.data(), positions.size() / 3, { { first }, { large } });
+
+	CHECK(tooLarge.maxShapeVertices == limit + 1);
+	CHECK(!tooLarge.Fits16BitIndices());
+}
+
+// A shape's LODs follow one another, shapes follow one another, and vertices only a
+// coarser level uses still belong to the shape's range
+static void TestLODRanges()
+{
+	const auto grid = MakeGrid(4);
+
+	const std::vector<uint32_t> full(grid.indices.begin(), grid.indices.end());
+	const std::vector<uint32_t> coarse  = { 0, 24, 4, 0, 20, 24 };
+	const std::vector<uint32_t> coarser = { 0, 20, 24 };
+	const std::vector<uint32_t> other   = { 12, 6, 7 };
+
+	const ShapeIndexLists   lists       = { { full, coarse, coarser }, {}, { other, coarser } };
+	const auto              geometry    = MergeShapes(grid.positions.data(), grid.VertexCount(), lists);
+
+	CheckSamePositions(grid, lists, geometry);
+
+	uint32_t next = 0;
+
+	for (const auto& shape : geometry.shapes)
+	{
+		for (const auto& range : shape.ranges)
+		{
+			CHECK(range.startIndex == next);
+			next += range.indexCount;
+		}
+	}
+
+	CHECK(next == geometry.indices.size());
+
+	// The empty shape takes no vertices, the last one adds the corners the first level missed
+	CHECK(geometry.shapes[1].ranges.empty() && geometry.shapes[1].vertexCount == 0);
+	CHECK(geometry.shapes[1].baseVertex == geometry.shapes[2].baseVertex);
+	CHECK(geometry.shapes[2].vertexCount == 6);
+}
+
+// One shared vertex buffer and an index buffer per shape, as before merging
+static void DrawPerShape(MockStateCache& state, MockBuffer& vertices, std::vector<MockBuffer>& indexBuffers, const ShapeIndexLists& lists)
+{
+	const uint32_t stride = 12;
+	const uint32_t offset = 0;
+
+	MockBuffer* const vertexBuffers[] = { &vertices };
+
+	for (size_t s = 0; s < lists.size(); s++)
+	{
+		state.IASetVertexBuffers(0, 1, vertexBuffers, &stride, &offset);
+		state.IASetIndexBuffer(&indexBuffers[s], 0, 0);
+		state.DrawIndexed(uint32_t(lists[s][0].size()), 0, 0);
+	}
+}
+
+// The merged buffers, every shape a range of the index buffer drawn with its base vertex
+static void DrawMerged(MockStateCache& state, MockBuffer& vertices, MockBuffer& indices, const MergedGeometry& geometry)
+{
+	const uint32_t stride = 12;
+	const uint32_t offset = 0;
+
+	MockBuffer* const vertexBuffers[] = { &vertices };
+
+	for (const auto& shape : geometry.shapes)
+	{
+		state.IASetVertexBuffers(0, 1, vertexBuffers, &stride, &offset);
+		state.IASetIndexBuffer(&indices, 0, 0);
+		state.DrawIndexed(shape.ranges[0].indexCount, shape.ranges[0].startIndex, shape.baseVertex);
+	}
+}
+
+// Binds that reach the context while drawing every shape once, through the state cache
+static void TestDrawCommands()
+{
+	const auto      grid        = MakeGrid(32);
+	const size_t    shapeCount  = 16;
+	const size_t    shapeSize   = grid.indices.size() / shapeCount;
+
+	std::vector<std::vector<uint32_t>>  shapes;
+	ShapeIndexLists                     lists;
+
+	for (size_t s = 0; s < shapeCount; s++)
+		shapes.emplace_back(grid.indices.begin() + s * shapeSize, grid.indices.begin() + (s + 1) * shapeSize);
+
+	for (const auto& shape : shapes)
+		lists.push_back({ shape });
+
+	const auto geometry = MergeShapes(grid.positions.data(), grid.VertexCount(), lists);
+
+	MockBuffer              vertices;
+	MockBuffer              mergedIndices;
+	std::vector<MockBuffer> shapeIndices(shapeCount);
+
+	RecordingContext    perShapeContext;
+	MockStateCache      perShape{ &perShapeContext };
+
+	DrawPerShape(perShape, vertices, shapeIndices, lists);
+
+	CHECK(perShapeContext.Count("IASetVertexBuffers") == 1);
+	CHECK(perShapeContext.Count("IASetIndexBuffer") == shapeCount);
+	CHECK(perShapeContext.Count("DrawIndexed") == shapeCount);
+
+	RecordingContext    mergedContext;
+	MockStateCache      merged{ &mergedContext };
+
+	DrawMerged(merged, vertices, mergedIndices, geometry);
+
+	CHECK(mergedContext.Count("IASetVertexBuffers") == 1);
+	CHECK(mergedContext.Count("IASetIndexBuffer") == 1);
+	CHECK(mergedContext.Count("DrawIndexed") == shapeCount);
+
+	// Later frames keep everything bound, only the draws go through
+	mergedContext.calls.clear();
+	DrawMerged(merged, vertices, mergedIndices, geometry);
+
+	CHECK(mergedContext.calls.size() == shapeCount);
+	CHECK(mergedContext.Count("DrawIndexed") == shapeCount);
+}
+
+int main()
+{
+	TestBaseVertex();
+	Test16BitFit();
+	TestLODRanges();
+	TestDrawCommands();
+
+	return CheckResult("MergedGeometryTests");
+}
@@ -0,0 +1,182 @@
+#include "Check.hpp"
+#include "TestMeshes.hpp"
+
+#include "MeshCleanup.hpp"
+#include "SpatialSort.hpp"
+#include "Threading.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// remap[v] <= v and remap[remap[v]] == remap[v]
+static bool IsCanonical(const std::vector<uint32_t>& remap)
+{
+	for (size_t v = 0; v < remap.size(); v++)
+	{
+		if (remap[v] > v || remap[remap[v]] != remap[v])
+			return false;
+	}
+
+	return true;
+}
+
+// The grid twice, the copy's vertices moved by offset along each axis
+static TestMesh Doubled(const TestMesh& mesh, const float offset)
+{
+	TestMesh doubled = mesh;
+
+	for (size_t i = 0; i < mesh.positions.size(); i++)
+		doubled.positions.push_back(mesh.positions[i] + (i % 3 == 1 ? -offset : offset));
+
+	for (const uint32_t v : mesh.indices)
+		doubled.indices.push_back(v + uint32_t(mesh.VertexCount()));
+
+	return doubled;
+}
+
+static void TestWeld()
+{
+	// Grid spacing is 1/32, far above epsilon
+	const auto  grid    = MakeGrid(64);
+	const float epsilon = 1e-4f;
+	const auto  count   = grid.VertexCount();
+
+	ThreadPool single{ 0 };
+	ThreadPool workers{ 3 };
+
+	// Copies at 0.4 epsilon per axis are 0.7 epsilon away and weld into the originals
+	const auto near = Doubled(grid, 0.4f * epsilon);
+
+	CleanupStats stats;
+	const auto remap = WeldPositions(workers, near.positions.data(), near.VertexCount(), epsilon, stats);
+
+	CHECK(IsCanonical(remap));
+	CHECK(stats.vertices == 2 * count && stats.welded == count);
+
+	for (size_t v = 0; v < count; v++)
+		CHECK(remap[v] == v && remap[v + count] == v);
+
+	// The same remap on one thread
+	CleanupStats singleStats;
+	CHECK(WeldPositions(single, near.positions.data(), near.VertexCount(), epsilon, singleStats) == remap);
+
+	// Copies at 2 epsilon stay apart
+	const auto far = Doubled(grid, 2.0f * epsilon);
+
+	CleanupStats farStats;
+	const auto farRemap = WeldPositions(workers, far.positions.data(), far.VertexCount(), epsilon, farStats);
+
+	CHECK(IsCanonical(farRemap) && farStats.welded == 0);
+
+	// Epsilon 0 welds exact copies only, -0 with +0
+	const std::vector<float> exact = { 0.0f, 1.0f, 2.0f,   -0.0f, 1.0f, 2.0f,   0.0f, 1.0f, 2.0f + 1e-6f,   0.0f, 1.0f, 2.0f };
+
+	CleanupStats exactStats;
+	CHECK(WeldPositions(single, exact.data(), 4, 0.0f, exactStats) == std::vector<uint32_t>({ 0, 0, 2, 0 }));
+	CHECK(exactStats.welded == 2);
+}
+
+static void TestDegenerate()
+{
+	const float epsilon = 1e-3f;
+
+	const std::vector<float> positions = {
+		0.0f, 0.0f, 0.0f,
+		1.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f,
+		0.5f, 0.5f * epsilon, 0.0f,     // height half of epsilon over the 0-1 edge
+		0.5f, 2.0f * epsilon, 0.0f,     // twice epsilon
+	};
+
+	// Two with a repeated index, one too flat, one thin but kept, one regular
+	std::vector<uint32_t> indices = { 0, 0, 1,   0, 1, 1,   0, 3, 1,   0, 4, 1,   0, 2, 1 };
+
+	CleanupStats stats;
+	const auto kept = CleanupTriangles(positions.data(), {}, indices, epsilon, stats);
+
+	CHECK(kept == std::vector<uint32_t>({ 3, 4 }));
+	CHECK(indices == std::vector<uint32_t>({ 0, 4, 1,   0, 2, 1 }));
+	CHECK(stats.triangles == 5 && stats.degenerate == 3 && stats.duplicates == 0);
+
+	// Triangles that welding collapses
+	std::vector<uint32_t>   welded  = { 0, 3, 1,   0, 2, 1 };
+	const auto              remap   = std::vector<uint32_t>({ 0, 1, 2, 0, 4 });
+
+	CleanupStats weldStats;
+	CHECK(CleanupTriangles(positions.data(), remap, welded, epsilon, weldStats) == std::vector<uint32_t>({ 1 }));
+	CHECK(weldStats.degenerate == 1);
+}
+
+static void TestDuplicates()
+{
+	const std::vector<float> positions = {
+		0.0f, 0.0f, 0.0f,
+		1.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f,
+		1.0f, 1.0f, 0.0f,
+	};
+
+	// A triangle, two rotations of it, the opposite winding, another triangle and the
+	// first one again
+	std::vector<uint32_t> indices = { 0, 1, 2,   1, 2, 0,   2, 0, 1,   0, 2, 1,   1, 3, 2,   0, 1, 2 };
+
+	CleanupStats stats;
+	const auto kept = CleanupTriangles(positions.data(), {}, indices, 0.0f, stats);
+
+	// First occurrences survive in input order, the back face too
+	CHECK(kept == std::vector<uint32_t>({ 0, 3, 4 }));
+	CHECK(indices == std::vector<uint32_t>({ 0, 1, 2,   0, 2, 1,   1, 3, 2 }));
+	CHECK(stats.duplicates == 3 && stats.degenerate == 0);
+}
+
+// Per triangle and per corner data follow the kept triangles
+static void TestAttributesAligned()
+{
+	const float epsilon = 1e-4f;
+
+	// Both grid copies weld, so every triangle of the second is a duplicate. A strip of
+	// collapsed triangles ahead of them shifts every kept triangle.
+	auto mesh = Doubled(MakeGrid(16), 0.1f * epsilon);
+
+	const size_t gridTriangles = mesh.indices.size() / 6;
+
+	for (uint32_t v = 0; v < 16; v++)
+		mesh.indices.insert(mesh.indices.begin(), { v, v + 1, v });
+
+	std::vector<uint32_t> materials(mesh.indices.size() / 3);
+	std::vector<uint32_t> texcoords(mesh.indices);         // per corner, the corner's original vertex
+
+	for (size_t t = 0; t < materials.size(); t++)
+		materials[t] = uint32_t(t);
+
+	ThreadPool threads{ 2 };
+
+	CleanupStats    stats;
+	const auto      remap   = WeldPositions(threads, mesh.positions.data(), mesh.VertexCount(), epsilon, stats);
+	const auto      kept    = CleanupTriangles(mesh.positions.data(), remap, mesh.indices, epsilon, stats);
+
+	ApplyTriangleOrder(kept, materials);
+	ApplyTriangleOrder(kept, texcoords, 3);
+
+	CHECK(kept.size() == gridTriangles && kept.front() == 16);
+	CHECK(stats.degenerate == 16 && stats.duplicates == gridTriangles);
+	CHECK(materials.size() == kept.size() && texcoords.size() == mesh.indices.size());
+
+	for (size_t t = 0; t < kept.size() && t < materials.size(); t++)
+	{
+		CHECK(materials[t] == kept[t]);
+
+		for (size_t k = 0; k < 3; k++)
+			CHECK(remap[texcoords[3 * t + k]] == mesh.indices[3 * t + k]);
+	}
+}
+
+int main()
+{
+	TestWeld();
+	TestDegenerate();
+	TestDuplicates();
+	TestAttributesAligned();
+
+	return CheckResult("MeshCleanupTests");
+}
@@ -0,0 +1,156 @@
+#include "Check.hpp"
+#include "TestMeshes.hpp"
+
+#include "MeshCodec.hpp"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Decoded triangles may be rotated, but keep their order and winding
+static bool SameTriangles(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b)
+{
+	if (a.size() != b.size())
+		return false;
+
+	for (size_t t = 0; t + 2 < a.size(); t += 3)
+	{
+		bool match = false;
+
+		for (size_t r = 0; r < 3 && !match; r++)
+			match = a[t] == b[t + r] && a[t + 1] == b[t + (r + 1) % 3] && a[t + 2] == b[t + (r + 2) % 3];
+
+		if (!match)
+			return false;
+	}
+
+	return true;
+}
+
+static bool RoundTripIndices(const std::vector<uint32_t>& indices)
+{
+	const auto encoded = EncodeIndexBuffer(indices.data(), indices.size());
+
+	if (GetEncodedIndexCount(encoded.data(), encoded.size()) != indices.size())
+		return false;
+
+	std::vector<uint32_t> decoded(indices.size());
+
+	return DecodeIndexBuffer(encoded.data(), encoded.size(), decoded.data(), decoded.size()) && SameTriangles(indices, decoded);
+}
+
+static bool RoundTripVertices(const std::vector<uint8_t>& vertices, const size_t stride)
+{
+	const size_t    count   = vertices.size() / stride;
+	const auto      encoded = EncodeVertexBuffer(vertices.data(), count, stride);
+
+	std::vector<uint8_t> decoded(vertices.size(), 0xcd);
+
+	return DecodeVertexBuffer(encoded.data(), encoded.size(), decoded.data(), count, stride) && decoded == vertices;
+}
+
+static void TestEmpty()
+{
+	CHECK(RoundTripIndices({}));
+	CHECK(RoundTripVertices({}, 12));
+}
+
+static void TestDegenerate()
+{
+	// Repeated corners and repeated triangles
+	CHECK(RoundTripIndices({ 0, 0, 0, 0, 0, 1, 1, 1, 0, 0, 1, 2, 0, 1, 2, 2, 1, 0 }));
+
+	// Every vertex the same
+	const std::vector<float> same(3 * 100, 1.5f);
+	std::vector<uint8_t> bytes(same.size() * sizeof(float));
+	memcpy(bytes.data(), same.data(), bytes.size());
+
+	CHECK(RoundTripVertices(bytes, 12));
+}
+
+static void TestLargeMesh()
+{
+	// 257 x 257 vertices, indices beyond 16 bits
+	const auto mesh = MakeGrid(256);
+	CHECK(mesh.VertexCount() > 65535);
+	CHECK(RoundTripIndices(mesh.indices));
+
+	std::vector<uint8_t> bytes(mesh.positions.size() * sizeof(float));
+	memcpy(bytes.data(), mesh.positions.data(), bytes.size());
+
+	CHECK(RoundTripVertices(bytes, 12));
+
+	// Random order, no shared edges to exploit
+	std::mt19937 random{ 7 };
+	std::vector<uint32_t> scattered(3 * 30000);
+	for (auto& index : scattered)
+		index = random() % 100000;
+
+	CHECK(RoundTripIndices(scattered));
+}
+
+static void TestOddStrides()
+{
+	std::mt19937 random{ 11 };
+
+	// Odd word counts, vertex counts off the block and group sizes
+	for (const size_t stride : { 4, 12, 20, 28, 36 })
+	{
+		for (const size_t count : { 1, 15, 17, 255, 257, 1000 })
+		{
+			std::vector<uint8_t> bytes(stride * count);
+			for (auto& b : bytes)
+				b = uint8_t(random());
+
+			CHECK(RoundTripVertices(bytes, stride));
+		}
+	}
+}
+
+static void TestMalformed()
+{
+	const auto mesh     = MakeGrid(8);
+	auto       encoded  = EncodeIndexBuffer(mesh.indices.data(), mesh.indices.size());
+
+	std::vector<uint32_t> decoded(mesh.indices.size());
+
+	CHECK(!DecodeIndexBuffer(encoded.data(), encoded.size() - 1, decoded.data(), decoded.size()));
+	CHECK(!DecodeIndexBuffer(encoded.data(), encoded.size(), decoded.data(), decoded.size() - 3));
+
+	const auto vertices = EncodeVertexBuffer(mesh.positions.data(), mesh.VertexCount(), 12);
+	std::vector<float> positions(mesh.positions.size());
+
+	CHECK(!DecodeVertexBuffer(vertices.data(), vertices.size() - 1, positions.data(), mesh.VertexCount(), 12));
+	CHECK(!DecodeVertexBuffer(vertices.data(), vertices.size(), positions.data(), mesh.VertexCount(), 16));
+}
+
+// Index counts that are not whole triangles are rejected, not silently cut
+static void TestPartialTriangle()
+{
+	const std::vector<uint32_t> indices = { 0, 1, 2, 2, 1, 3, 3 };
+
+	for (const size_t count : { 1, 2, 4, 5, 7 })
+		CHECK(EncodeIndexBuffer(indices.data(), count).empty());
+
+	// A stream claiming 4 indices with the codes of one triangle
+	auto encoded = EncodeIndexBuffer(indices.data(), 3);
+	CHECK(encoded.size() > 2 && encoded[1] == 3);
+
+	encoded[1] = 4;
+
+	std::vector<uint32_t> decoded(4);
+	CHECK(GetEncodedIndexCount(encoded.data(), encoded.size()) == 4);
+	CHECK(!DecodeIndexBuffer(encoded.data(), encoded.size(), decoded.data(), decoded.size()));
+}
+
+int main()
+{
+	TestEmpty();
+	TestDegenerate();
+	TestLargeMesh();
+	TestOddStrides();
+	TestMalformed();
+	TestPartialTriangle();
+
+	return CheckResult("MeshCodecTests");
+}
@@ -0,0 +1,137 @@
+#include "Check.hpp"
+#include "TestMeshes.hpp"
+
+#include "Meshlets.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+static float3 Position(const TestMesh& mesh, const uint32_t vertex)
+{
+	return LoadFloat3(mesh.positions.data() + 3 * vertex);
+}
+
+// Limits hold, local indices stay inside their meshlet and the meshlets give back every
+// triangle of the input exactly once, in order
+static void CheckMeshlets(const TestMesh& mesh, const MeshletLimits limits)
+{
+	const auto out = BuildMeshlets(mesh.positions.data(), mesh.VertexCount(), mesh.indices.data(), mesh.indices.size(), limits);
+
+	CHECK(out.bounds.size() == out.meshlets.size());
+	CHECK(out.TriangleCount() == mesh.indices.size() / 3);
+
+	std::vector<uint32_t> triangles;
+	triangles.reserve(mesh.indices.size());
+
+	for (const auto& meshlet : out.meshlets)
+	{
+		CHECK(meshlet.vertexCount >= 1 && meshlet.vertexCount <= limits.maxVertices);
+		CHECK(meshlet.triangleCount >= 1 && meshlet.triangleCount <= limits.maxTriangles);
+
+		// No vertex twice within a meshlet
+		std::vector<uint32_t> vertices(out.vertices.begin() + meshlet.vertexOffset, out.vertices.begin() + meshlet.vertexOffset + meshlet.vertexCount);
+		std::sort(vertices.begin(), vertices.end());
+		CHECK(std::adjacent_find(vertices.begin(), vertices.end()) == vertices.end());
+
+		for (uint32_t i = 0; i < 3 * meshlet.triangleCount; i++)
+		{
+			const uint8_t local = out.triangles[meshlet.triangleOffset + i];
+
+			CHECK(local < meshlet.vertexCount);
+			triangles.push_back(out.vertices[meshlet.vertexOffset + local]);
+		}
+	}
+
+	CHECK(triangles == mesh.indices);
+}
+
+static void TestLimits()
+{
+	const auto grid     = MakeGrid(40);
+	const auto sphere   = MakeSphere(24, 48);
+
+	for (const auto& limits : { MeshletLimits{}, MeshletLimits{ 3, 1 }, MeshletLimits{ 16, 124 }, MeshletLimits{ 256, 8 }, MeshletLimits{ 32, 40 } })
+	{
+		CheckMeshlets(grid, limits);
+		CheckMeshlets(sphere, limits);
+	}
+
+	// Nothing in, nothing out
+	const auto empty = BuildMeshlets(nullptr, 0, nullptr, 0);
+	CHECK(empty.meshlets.empty() && empty.vertices.empty() && empty.triangles.empty());
+}
+
+// Seen from outside, the far side of a closed sphere faces away. Cone culling has to be
+// conservative, a culled meshlet holds no triangle facing the camera, and should take
+// a good share of the back half.
+static void TestConeCulling()
+{
+	const auto sphere = MakeSphere(64, 128);
+
+	// The test sphere is wound like the app's meshes
+	for (size_t i = 0; i < sphere.indices.size(); i += 3)
+	{
+		const float3 a = Position(sphere, sphere.indices[i + 0]);
+		const float3 b = Position(sphere, sphere.indices[i + 1]);
+		const float3 c = Position(sphere, sphere.indices[i + 2]);
+
+		CHECK(Dot(TriangleNormal(a, b, c), a + b + c) > 0.0f);
+	}
+
+	// Small meshlets, a full default one spans most of a ring
+	const auto meshlets = BuildMeshlets(sphere.positions.data(), sphere.VertexCount(), sphere.indices.data(), sphere.indices.size(), { 64, 32 });
+
+	const float     eye[3]      = { 0.0f, 0.0f, -10.0f };
+	const float     target[3]   = { 0.0f, 0.0f, 0.0f };
+	const float3    camera      = { eye[0], eye[1], eye[2] };
+
+	float pv[4][4];
+	MakeViewProjection(eye, target, 3.1415927f / 4.0f, 1.0f, 0.1f, 100.0f, pv);
+
+	std::vector<uint32_t>   visible;
+	const auto              stats = CullMeshlets(meshlets, ExtractFrustum(pv), camera, visible);
+
+	CHECK(stats.meshlets == meshlets.meshlets.size());
+	CHECK(stats.frustumCulled == 0);
+	CHECK(stats.trianglesTotal == sphere.indices.size() / 3);
+	CHECK(stats.visible == visible.size());
+	CHECK(stats.visible + stats.backfaceCulled == stats.meshlets);
+
+	size_t facing = 0;
+
+	for (size_t m = 0; m < meshlets.meshlets.size(); m++)
+	{
+		const auto& meshlet = meshlets.meshlets[m];
+		const bool  culled  = !std::binary_search(visible.begin(), visible.end(), uint32_t(m));
+
+		for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+		{
+			const uint8_t* local = meshlets.triangles.data() + meshlet.triangleOffset + 3 * t;
+
+			const float3 a = Position(sphere, meshlets.vertices[meshlet.vertexOffset + local[0]]);
+			const float3 b = Position(sphere, meshlets.vertices[meshlet.vertexOffset + local[1]]);
+			const float3 c = Position(sphere, meshlets.vertices[meshlet.vertexOffset + local[2]]);
+
+			const bool front = Dot(TriangleNormal(a, b, c), a - camera) < 0.0f;
+
+			facing += front;
+			CHECK(!(culled && front));
+		}
+	}
+
+	// A bit under half the sphere faces a camera at finite distance
+	const double culledShare    = 1.0 - double(stats.trianglesVisible) / stats.trianglesTotal;
+	const double backShare      = 1.0 - double(facing) / stats.trianglesTotal;
+
+	CHECK(backShare > 0.5 && backShare < 0.6);
+	CHECK(culledShare > 0.3 && culledShare <= backShare);
+}
+
+int main()
+{
+	TestLimits();
+	TestConeCulling();
+
+	return CheckResult("MeshletsTests");
+}
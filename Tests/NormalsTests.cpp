@@ -0,0 +1,289 @@
+#include "Check.hpp"
+#include "TestMeshes.hpp"
+
+#include "Normals.hpp"
+#include "Threading.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Eight corners of [-1, 1]^3, two triangles per face wound outwards
+static TestMesh MakeCube()
+{
+	TestMesh cube;
+
+	for (uint32_t v = 0; v < 8; v++)
+		cube.positions.insert(cube.positions.end(), { v & 1 ? 1.0f : -1.0f, v & 2 ? 1.0f : -1.0f, v & 4 ? 1.0f : -1.0f });
+
+	// -x, +x, -y, +y, -z, +z
+	const uint32_t faces[6][4] = { { 0, 2, 6, 4 }, { 1, 5, 7, 3 }, { 0, 4, 5, 1 }, { 2, 3, 7, 6 }, { 0, 1, 3, 2 }, { 4, 6, 7, 5 } };
+
+	for (const auto& face : faces)
+	{
+		const uint32_t triangles[2][3] = { { face[0], face[1], face[2] }, { face[0], face[2], face[3] } };
+
+		for (const auto& tri : triangles)
+		{
+			const float3 a = LoadFloat3(cube.positions.data() + 3 * tri[0]);
+			const float3 b = LoadFloat3(cube.positions.data() + 3 * tri[1]);
+			const float3 c = LoadFloat3(cube.positions.data() + 3 * tri[2]);
+
+			if (Dot(TriangleNormal(a, b, c), a + b + c) > 0.0f)
+				cube.indices.insert(cube.indices.end(), { tri[0], tri[1], tri[2] });
+			else
+				cube.indices.insert(cube.indices.end(), { tri[0], tri[2], tri[1] });
+		}
+	}
+
+	return cube;
+}
+
+static bool Near(const float3 a, const float3 b, const float tolerance = 1e-5f)
+{
+	return std::abs(a.x - b.x) <= tolerance && std::abs(a.y - b.y) <= tolerance && std::abs(a.z - b.z) <= tolerance;
+}
+
+// Every corner's vertex sits on the corner's position
+static void CheckPositions(const NormalInput& input, const NormalMesh& mesh)
+{
+	CHECK(mesh.indices.size() == input.indices.size());
+
+	for (size_t c = 0; c < mesh.indices.size(); c++)
+		CHECK(mesh.indices[c] < mesh.vertices.size() && mesh.vertices[mesh.indices[c]].position == input.indices[c]);
+}
+
+static void TestCube()
+{
+	const auto cube = MakeCube();
+
+	// Faces meet at 90 degrees, over the default 60 degree crease
+	const NormalInput   input   = { cube.indices, {}, {} };
+	const auto          creased = GenerateNormals(cube.positions.data(), input);
+
+	CheckPositions(input, creased);
+	CHECK(creased.vertices.size() == 24);
+
+	for (size_t c = 0; c < cube.indices.size(); c++)
+	{
+		const float3 n = creased.vertices[creased.indices[c]].normal;
+		CHECK(std::abs(std::abs(n.x) + std::abs(n.y) + std::abs(n.z) - 1.0f) < 1e-6f);
+	}
+
+	// A crease over 90 degrees smooths every corner, angle weights give the diagonals
+	NormalSettings smoothSettings;
+	smoothSettings.creaseAngle = 1.6f;
+
+	const auto smooth = GenerateNormals(cube.positions.data(), input, smoothSettings);
+
+	CheckPositions(input, smooth);
+	CHECK(smooth.vertices.size() == 8);
+
+	for (const auto& vertex : smooth.vertices)
+	{
+		const float3 p = LoadFloat3(cube.positions.data() + 3 * vertex.position);
+		CHECK(Near(vertex.normal, Normalize(p)));
+	}
+
+	// Attributes differ per corner, nothing welds
+	std::vector<uint32_t> attributes(cube.indices.size());
+	for (size_t c = 0; c < attributes.size(); c++)
+		attributes[c] = uint32_t(c);
+
+	CHECK(GenerateNormals(cube.positions.data(), { cube.indices, attributes, {} }, smoothSettings).vertices.size() == 36);
+}
+
+static void TestSmoothingGroups()
+{
+	const auto cube = MakeCube();
+
+	NormalSettings settings;
+	settings.creaseAngle = 1.6f;
+
+	auto VertexCount = [&](const std::vector<uint32_t>& faceGroups)
+	{
+		std::vector<uint32_t> groups;
+		for (const uint32_t group : faceGroups)
+			groups.insert(groups.end(), { group, group });
+
+		const NormalInput input = { cube.indices, {}, groups };
+		const auto        mesh  = GenerateNormals(cube.positions.data(), input, settings);
+
+		CheckPositions(input, mesh);
+		return mesh.vertices.size();
+	};
+
+	CHECK(VertexCount({ 1, 1, 1, 1, 1, 1 }) == 8);
+	CHECK(VertexCount({ 1, 2, 3, 4, 5, 6 }) == 24);
+
+	// Group 0 is flat, whatever the crease angle
+	CHECK(VertexCount({ 0, 0, 0, 0, 0, 0 }) == 24);
+
+	// The faces around corner 0 in one group and the faces around corner 7 in another,
+	// the six corners in between touch both
+	CHECK(VertexCount({ 1, 2, 1, 2, 1, 2 }) == 2 + 6 * 2);
+}
+
+// The pairwise comparison over every corner of a position, as the bucketed version must produce
+static std::vector<float3> ReferenceCornerNormals(const float* positions, const NormalInput& input, const NormalSettings& settings)
+{
+	const size_t cornerCount = input.indices.size();
+
+	std::vector<float3> faceNormals(cornerCount / 3);
+	std::vector<float>  weights(cornerCount);
+
+	for (size_t t = 0; t < faceNormals.size(); t++)
+		NormalsDetail::FaceData(positions, input.indices.data() + 3 * t, faceNormals[t], weights.data() + 3 * t, settings.weighting);
+
+	const float cosCrease = std::cos(settings.creaseAngle);
+
+	std::vector<float3> normals(cornerCount);
+
+	for (size_t c = 0; c < cornerCount; c++)
+	{
+		const uint32_t  group   = input.smoothingGroups[c / 3];
+		const float3    face    = faceNormals[c / 3];
+		float3          sum;
+
+		for (size_t other = 0; other < cornerCount; other++)
+		{
+			if (input.indices[other] != input.indices[c])
+				continue;
+
+			const bool smooth = other == c ||
+				(group != 0 && input.smoothingGroups[other / 3] == group && (Dot(face, face) == 0.0f || Dot(face, faceNormals[other / 3]) >= cosCrease));
+
+			if (smooth)
+				sum += faceNormals[other / 3] * weights[other];
+		}
+
+		normals[c] = Length(sum) > 0.0f ? Normalize(sum) : face;
+	}
+
+	return normals;
+}
+
+// Random smoothing groups over a sphere, vertices shared by several groups at every position
+static void TestBucketedGroups()
+{
+	const auto sphere = MakeSphere(16, 32);
+
+	std::mt19937                            random{ 5 };
+	std::uniform_int_distribution<uint32_t> group{ 0, 3 };
+
+	std::vector<uint32_t> groups(sphere.indices.size() / 3);
+	for (auto& g : groups)
+		g = group(random);
+
+	for (const auto weighting : { NormalWeighting::Angle, NormalWeighting::Area })
+	{
+		NormalSettings settings;
+		settings.weighting = weighting;
+
+		const NormalInput   input       = { sphere.indices, {}, groups };
+		const auto          mesh        = GenerateNormals(sphere.positions.data(), input, settings);
+		const auto          reference   = ReferenceCornerNormals(sphere.positions.data(), input, settings);
+
+		CheckPositions(input, mesh);
+
+		// Scalar face data against the SSE path, so only tiny differences
+		for (size_t c = 0; c < reference.size(); c++)
+			CHECK(Near(mesh.vertices[mesh.indices[c]].normal, reference[c]));
+
+		// No two vertices of one position hold the same normal
+		for (size_t i = 0; i < mesh.vertices.size(); i++)
+		{
+			for (size_t j = i + 1; j < mesh.vertices.size(); j++)
+			{
+				const auto& a = mesh.vertices[i];
+				const auto& b = mesh.vertices[j];
+
+				CHECK(!(a.position == b.position && !std::memcmp(&a.normal, &b.normal, sizeof(float3))));
+			}
+		}
+	}
+}
+
+// The four triangle SSE path against the scalar one, with a tail and degenerate triangles
+static void TestFaceData()
+{
+	auto sphere = MakeSphere(8, 16);
+
+	// One degenerate triangle in the first group of four, one in the tail
+	sphere.indices.insert(sphere.indices.begin(), { 3, 3, 7 });
+	sphere.indices.insert(sphere.indices.end(), { 1, 2, 1 });
+
+	const size_t triangleCount = sphere.indices.size() / 3;
+	CHECK(triangleCount % 4 != 0);
+
+	for (const auto weighting : { NormalWeighting::Angle, NormalWeighting::Area })
+	{
+		std::vector<float3> normals(triangleCount);
+		std::vector<float>  weights(3 * triangleCount);
+
+		NormalsDetail::ComputeFaceData(sphere.positions.data(), sphere.indices.data(), triangleCount, normals.data(), weights.data(), weighting);
+
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			float3  normal;
+			float   expected[3];
+
+			NormalsDetail::FaceData(sphere.positions.data(), sphere.indices.data() + 3 * t, normal, expected, weighting);
+
+			CHECK(Near(normals[t], normal, 1e-6f));
+
+			for (size_t k = 0; k < 3; k++)
+				CHECK(std::abs(weights[3 * t + k] - expected[k]) <= 1e-5f * std::max(1.0f, expected[k]));
+		}
+
+		// The degenerate triangles have no normal and no weight
+		for (const size_t t : { size_t(0), triangleCount - 1 })
+		{
+			CHECK(Dot(normals[t], normals[t]) == 0.0f);
+			CHECK(weights[3 * t] == 0.0f && weights[3 * t + 1] == 0.0f && weights[3 * t + 2] == 0.0f);
+		}
+	}
+}
+
+// Shapes run in parallel give the same meshes as one at a time
+static void TestThreads()
+{
+	const auto cube     = MakeCube();
+	const auto sphere   = MakeSphere(16, 32);
+
+	// Both shapes index one buffer, the sphere's vertices after the cube's
+	std::vector<float> positions = cube.positions;
+	positions.insert(positions.end(), sphere.positions.begin(), sphere.positions.end());
+
+	std::vector<uint32_t> sphereIndices = sphere.indices;
+	for (auto& v : sphereIndices)
+		v += uint32_t(cube.VertexCount());
+
+	const std::vector<NormalInput> shapes = { { cube.indices, {}, {} }, { sphereIndices, {}, {} } };
+
+	ThreadPool threads{ 2 };
+	const auto meshes = GenerateNormals(threads, positions.data(), shapes);
+
+	CHECK(meshes.size() == 2);
+
+	for (size_t s = 0; s < shapes.size() && s < meshes.size(); s++)
+	{
+		const auto single = GenerateNormals(positions.data(), shapes[s]);
+
+		CHECK(meshes[s].indices == single.indices);
+		CHECK(meshes[s].vertices.size() == single.vertices.size() && !std::memcmp(meshes[s].vertices.data(), single.vertices.data(), single.vertices.size() * sizeof(NormalVertex)));
+	}
+}
+
+int main()
+{
+	TestCube();
+	TestSmoothingGroups();
+	TestBucketedGroups();
+	TestFaceData();
+	TestThreads();
+
+	return CheckResult("NormalsTests");
+}
@@ -0,0 +1,88 @@
+#include "Check.hpp"
+
+#include "CommandBuffer.hpp"
+#include "ParallelCommands.hpp"
+#include "Threading.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Few distinct keys, so the stable sort exposes any change in recording order
+static void RecordRange(CommandBuffer& out, const size_t begin, const size_t end)
+{
+	for (size_t i = begin; i < end; i++)
+	{
+		uint32_t r = uint32_t(i) * 2654435761u;
+		r ^= r >> 15;
+
+		out.Draw(MakeSortKey(r & 1, (r >> 8) & 3, 0, 0.0f), { uint16_t(r & 1), uint16_t(r % 6), 36, uint32_t(i) });
+	}
+}
+
+static std::vector<uint32_t> ReplayOrder(CommandBuffer& commands, ThreadPool& threads)
+{
+	commands.Sort(threads);
+
+	std::vector<uint32_t> order;
+	commands.ForEach([&](const DrawPacket& packet) { order.push_back(packet.start); });
+
+	return order;
+}
+
+// Any thread count and grain size merges to what serial recording produces
+static void TestDeterminism()
+{
+	ThreadPool serialPool{ 0 };
+
+	for (const size_t count : { size_t(0), size_t(1), size_t(1000), size_t(50000) })
+	{
+		CommandBuffer serial;
+		RecordRange(serial, 0, count);
+
+		const auto expected = ReplayOrder(serial, serialPool);
+
+		for (size_t threadCount = 1; threadCount <= 8; threadCount++)
+		{
+			ThreadPool          pool{ threadCount - 1 };
+			ParallelRecorder    recorder;
+
+			for (const size_t grain : { size_t(0), size_t(1), size_t(7), size_t(4096), count + 1 })
+			{
+				CommandBuffer merged;
+				recorder.Record(pool, count, grain, merged, RecordRange);
+
+				CHECK(merged.Size() == count);
+				CHECK(ReplayOrder(merged, pool) == expected);
+			}
+		}
+	}
+}
+
+// Chunk buffers kept from a bigger frame must not leak packets into a smaller one,
+// and recording appends to what the output already holds
+static void TestReuse()
+{
+	ThreadPool          pool{ 3 };
+	ParallelRecorder    recorder;
+
+	CommandBuffer big;
+	recorder.Record(pool, 20000, 100, big, RecordRange);
+
+	CommandBuffer small;
+	RecordRange(small, 0, 5);
+	recorder.Record(pool, 300, 100, small, [](CommandBuffer& out, size_t begin, size_t end) { RecordRange(out, 5 + begin, 5 + end); });
+
+	CommandBuffer serial;
+	RecordRange(serial, 0, 305);
+
+	CHECK(small.Size() == 305);
+	CHECK(ReplayOrder(small, pool) == ReplayOrder(serial, pool));
+}
+
+int main()
+{
+	TestDeterminism();
+	TestReuse();
+
+	return CheckResult("ParallelCommandsTests");
+}
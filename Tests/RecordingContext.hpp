@@ -0,0 +1,92 @@
+#pragma once
+
+#include "StateCache.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A context that records the calls reaching it, for running StateCache and the draw
+// paths built on it headless
+
+// Stand-ins for the API objects, only their addresses matter
+struct MockBuffer {};
+struct MockInputLayout {};
+struct MockShader {};
+struct MockView {};
+
+struct MockViewport
+{
+	float x, y, width, height, minDepth, maxDepth;
+};
+
+struct MockRect
+{
+	int32_t left, top, right, bottom;
+};
+
+// Records every call that reaches it with the slot range it covers
+class RecordingContext
+{
+public:
+	struct Call
+	{
+		std::string name;
+		uint32_t    start   = 0;
+		uint32_t    count   = 0;
+
+		bool operator == (const Call&) const = default;
+	};
+
+	std::vector<Call> calls;
+
+	size_t Count(const std::string_view name) const
+	{
+		return size_t(std::count_if(calls.begin(), calls.end(), [&](const Call& call) { return call.name == name; }));
+	}
+
+	void ClearState()                                                                   { calls.push_back({ "ClearState" }); }
+	void IASetInputLayout(MockInputLayout*)                                             { calls.push_back({ "IASetInputLayout" }); }
+	void IASetPrimitiveTopology(int)                                                    { calls.push_back({ "IASetPrimitiveTopology" }); }
+	void IASetVertexBuffers(uint32_t start, uint32_t count, MockBuffer* const*, const uint32_t*, const uint32_t*) { calls.push_back({ "IASetVertexBuffers", start, count }); }
+	void IASetIndexBuffer(MockBuffer*, int, uint32_t)                                   { calls.push_back({ "IASetIndexBuffer" }); }
+	void VSSetShader(MockShader*, void* const*, uint32_t)                               { calls.push_back({ "VSSetShader" }); }
+	void GSSetShader(MockShader*, void* const*, uint32_t)                               { calls.push_back({ "GSSetShader" }); }
+	void PSSetShader(MockShader*, void* const*, uint32_t)                               { calls.push_back({ "PSSetShader" }); }
+	void VSSetConstantBuffers(uint32_t start, uint32_t count, MockBuffer* const*)       { calls.push_back({ "VSSetConstantBuffers", start, count }); }
+	void GSSetConstantBuffers(uint32_t start, uint32_t count, MockBuffer* const*)       { calls.push_back({ "GSSetConstantBuffers", start, count }); }
+	void PSSetConstantBuffers(uint32_t start, uint32_t count, MockBuffer* const*)       { calls.push_back({ "PSSetConstantBuffers", start, count }); }
+	void RSSetViewports(uint32_t count, const MockViewport*)                            { calls.push_back({ "RSSetViewports", 0, count }); }
+	void RSSetScissorRects(uint32_t count, const MockRect*)                             { calls.push_back({ "RSSetScissorRects", 0, count }); }
+	void OMSetRenderTargets(uint32_t count, MockView* const*, MockView*)                { calls.push_back({ "OMSetRenderTargets", 0, count }); }
+	void Draw(uint32_t, uint32_t)                                                       { calls.push_back({ "Draw" }); }
+	void DrawIndexed(uint32_t, uint32_t, int32_t)                                       { calls.push_back({ "DrawIndexed" }); }
+	void DrawInstanced(uint32_t, uint32_t, uint32_t, uint32_t)                          { calls.push_back({ "DrawInstanced" }); }
+	void DrawIndexedInstanced(uint32_t, uint32_t, uint32_t, int32_t, uint32_t)          { calls.push_back({ "DrawIndexedInstanced" }); }
+};
+
+struct MockStateTypes
+{
+	using Context           = RecordingContext;
+	using Buffer            = MockBuffer;
+	using InputLayout       = MockInputLayout;
+	using VertexShader      = MockShader;
+	using GeometryShader    = MockShader;
+	using PixelShader       = MockShader;
+	using ClassInstance     = void;
+	using RenderTargetView  = MockView;
+	using DepthStencilView  = MockView;
+	using Topology          = int;
+	using Format            = int;
+	using Viewport          = MockViewport;
+	using Rect              = MockRect;
+
+	static constexpr uint32_t vertexBufferSlots     = 32;
+	static constexpr uint32_t constantBufferSlots   = 14;
+	static constexpr uint32_t renderTargetSlots     = 8;
+	static constexpr uint32_t viewportSlots         = 16;
+};
+
+using MockStateCache = StateCache<MockStateTypes>;
@@ -0,0 +1,305 @@
+#include "Check.hpp"
+
+#include "RingAllocator.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <vector>
+
+static void TestAlignment()
+{
+	RingAllocator ring{ 1024, 64 };
+
+	CHECK(ring.Allocate(1) == 0);
+	CHECK(ring.Allocate(64) == 64);
+	CHECK(ring.Allocate(65) == 128);
+	CHECK(ring.Allocate(0) == 256);     // still takes one aligned block
+	CHECK(ring.Used() == 320);
+
+	CHECK(ring.Allocate(2048) == RingAllocator::invalid);
+	CHECK(ring.Used() == 320);
+
+	RingAllocator empty;
+	CHECK(empty.Allocate(1) == RingAllocator::invalid);
+}
+
+// Frames hold their bytes until they retire, oldest first, whatever completedFrame skips over
+static void TestFramesInFlight()
+{
+	RingAllocator ring{ 1000, 100 };
+
+	CHECK(ring.Allocate(300) == 0);
+	ring.EndFrame(1);
+	CHECK(ring.Allocate(300) == 300);
+	ring.EndFrame(2);
+	CHECK(ring.Allocate(300) == 600);
+	ring.EndFrame(3);
+
+	CHECK(ring.FramesInFlight() == 3);
+	CHECK(ring.Used() == 900);
+
+	// Full until the GPU is done with frame 1
+	CHECK(ring.Allocate(200) == RingAllocator::invalid);
+
+	ring.Retire(0);
+	CHECK(ring.FramesInFlight() == 3);
+
+	ring.Retire(1);
+	CHECK(ring.FramesInFlight() == 2);
+	CHECK(ring.Used() == 600);
+
+	// Retiring the same frame again frees nothing more
+	ring.Retire(1);
+	CHECK(ring.Used() == 600);
+
+	ring.Retire(3);
+	CHECK(ring.FramesInFlight() == 0);
+	CHECK(ring.Used() == 0);
+
+	// A frame without allocations still counts as in flight and frees nothing
+	ring.EndFrame(4);
+	CHECK(ring.FramesInFlight() == 1);
+	ring.Retire(4);
+	CHECK(ring.Used() == 0);
+}
+
+// Allocations never straddle the end, the skipped tail belongs to the frame that wrapped
+static void TestWrapAround()
+{
+	RingAllocator ring{ 1000, 100 };
+
+	CHECK(ring.Allocate(400) == 0);
+	ring.EndFrame(1);
+	CHECK(ring.Allocate(400) == 400);
+	ring.EndFrame(2);
+
+	// 200 left at the end, frame 1 is still in flight
+	CHECK(ring.Allocate(300) == RingAllocator::invalid);
+
+	ring.Retire(1);
+
+	CHECK(ring.Allocate(300) == 0);
+	CHECK(ring.Used() == 400 + 200 + 300);
+
+	// Between head and tail of a wrapped ring
+	CHECK(ring.Allocate(100) == 300);
+	CHECK(ring.Allocate(100) == RingAllocator::invalid);
+	ring.EndFrame(3);
+
+	// Frame 3 gives back the skipped tail along with its own bytes
+	ring.Retire(2);
+	CHECK(ring.Used() == 200 + 300 + 100);
+	ring.Retire(3);
+	CHECK(ring.Used() == 0);
+
+	// Empty again, so the whole capacity is available from the head onwards or from 0
+	CHECK(ring.Allocate(1000) == 0);
+	ring.EndFrame(4);
+	ring.Retire(4);
+	CHECK(ring.Allocate(1000) == 0);
+}
+
+// Random sizes with a few frames in flight: live allocations never overlap, stay
+// inside the ring and add up with the skipped tails to Used
+static void TestRandomFrames()
+{
+	const size_t    capacity    = 64 * 1024;
+	const size_t    alignment   = 16;
+	const uint64_t  latency     = 3;
+
+	struct Range
+	{
+		size_t offset;
+		size_t size;
+	};
+
+	RingAllocator                   ring{ capacity, alignment };
+	std::mt19937                    random{ 11 };
+	std::deque<std::vector<Range>>  live;           // per frame in flight
+	std::vector<Range>              current;
+	size_t                          failed = 0;
+
+	for (uint64_t frame = 1; frame <= 2000; frame++)
+	{
+		const size_t count = random() % 40;
+
+		for (size_t i = 0; i < count; i++)
+		{
+			const size_t size   = 1 + random() % 2048;
+			const size_t offset = ring.Allocate(size);
+
+			if (offset == RingAllocator::invalid)
+			{
+				failed++;
+				continue;
+			}
+
+			const Range range = { offset, ring.AlignUp(size) };
+
+			CHECK(offset % alignment == 0);
+			CHECK(offset + range.size <= capacity);
+
+			for (const auto& frameRanges : live)
+			{
+				for (const auto& other : frameRanges)
+					CHECK(offset + range.size <= other.offset || other.offset + other.size <= offset);
+			}
+
+			for (const auto& other : current)
+				CHECK(offset + range.size <= other.offset || other.offset + other.size <= offset);
+
+			current.push_back(range);
+		}
+
+		ring.EndFrame(frame);
+		live.push_back(std::move(current));
+		current.clear();
+
+		if (frame > latency)
+		{
+			ring.Retire(frame - latency);
+			live.pop_front();
+		}
+
+		size_t liveBytes = 0;
+		for (const auto& frameRanges : live)
+		{
+			for (const auto& range : frameRanges)
+				liveBytes += range.size;
+		}
+
+		CHECK(ring.FramesInFlight() == live.size());
+		CHECK(ring.Used() >= liveBytes && ring.Used() <= capacity);
+	}
+
+	// About 60 KB per frame with three in flight does not fit, some have to fail
+	CHECK(failed > 0);
+
+	ring.Retire(UINT64_MAX);
+	CHECK(ring.Used() == 0);
+	CHECK(ring.FramesInFlight() == 0);
+}
+
+// Frames complete in order once the simulated GPU gets to them
+class FakeGPU
+{
+public:
+	uint64_t WaitOldest() noexcept { return ++completed; }
+
+	uint64_t completed = 0;
+};
+
+static void TestWaiting()
+{
+	RingAllocator   ring{ 1000, 100 };
+	FakeGPU         gpu;
+	size_t          waits = 0;
+
+	auto Wait = [&] { return gpu.WaitOldest(); };
+
+	// Nothing in flight, nothing to wait for
+	CHECK(ring.Allocate(500, Wait, &waits) == 0);
+	CHECK(waits == 0);
+	ring.EndFrame(1);
+
+	CHECK(ring.Allocate(400, Wait, &waits) == 500);
+	ring.EndFrame(2);
+
+	// Needs frame 1 back, one wait
+	CHECK(ring.Allocate(300, Wait, &waits) == 0);
+	CHECK(waits == 1);
+	CHECK(gpu.completed == 1);
+	CHECK(ring.FramesInFlight() == 1);
+
+	// Larger than the ring, returned without waiting on anything
+	CHECK(ring.Allocate(2000, Wait, &waits) == RingAllocator::invalid);
+	CHECK(waits == 1);
+	CHECK(gpu.completed == 1);
+
+	// A frame whose completion is never reported stops the wait instead of spinning
+	ring.EndFrame(3);
+	CHECK(ring.Allocate(900, [&] { return uint64_t(1); }, &waits) == RingAllocator::invalid);
+	CHECK(waits == 2);
+}
+
+// Streams frames of writes the way UploadRing does, with the GPU a few frames behind.
+// Each frame's slices still hold that frame's bytes when the GPU completes it.
+static void TestUploadStream()
+{
+	const size_t    capacity    = 256 * 1024;
+	const uint64_t  latency     = 2;
+
+	struct Slice
+	{
+		size_t  offset;
+		size_t  size;
+	};
+
+	RingAllocator                   ring{ capacity, 16 };
+	std::vector<uint8_t>            buffer(capacity);
+	std::deque<std::vector<Slice>>  inFlight;
+	std::mt19937                    random{ 12 };
+	uint64_t                        completed   = 0;
+	size_t                          waits       = 0;
+	bool                            intact      = true;
+
+	auto Complete = [&]
+	{
+		const uint64_t frame = ++completed;
+
+		for (const auto& slice : inFlight.front())
+		{
+			for (size_t i = 0; i < slice.size; i++)
+				intact &= buffer[slice.offset + i] == uint8_t(frame);
+		}
+
+		inFlight.pop_front();
+		return frame;
+	};
+
+	for (uint64_t frame = 1; frame <= 500; frame++)
+	{
+		std::vector<Slice> slices;
+
+		for (size_t w = random() % 24; w > 0; w--)
+		{
+			const size_t size   = 1 + random() % 8192;
+			const size_t offset = ring.Allocate(size, Complete, &waits);
+
+			CHECK(offset != RingAllocator::invalid);
+
+			if (offset == RingAllocator::invalid)
+				continue;
+
+			std::fill_n(buffer.begin() + offset, size, uint8_t(frame));
+			slices.push_back({ offset, size });
+		}
+
+		ring.EndFrame(frame);
+		inFlight.push_back(std::move(slices));
+
+		// What a non blocking poll would find finished
+		while (frame > latency && completed < frame - latency)
+			ring.Retire(Complete());
+	}
+
+	while (!inFlight.empty())
+		ring.Retire(Complete());
+
+	CHECK(intact);
+	CHECK(waits > 0);
+	CHECK(ring.Used() == 0);
+}
+
+int main()
+{
+	TestAlignment();
+	TestFramesInFlight();
+	TestWrapAround();
+	TestRandomFrames();
+	TestWaiting();
+	TestUploadStream();
+
+	return CheckResult("RingAllocatorTests");
+}
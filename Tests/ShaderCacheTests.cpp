@@ -0,0 +1,348 @@
+#include "Check.hpp"
+
+#include "ShaderCache.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Stands in for D3DCompile. Lines reading include <name> pull in that file relative to
+// the source, the bytecode is the expanded text followed by the entry point and defines.
+// A source containing "error" fails to compile.
+class StubCompiler : public ShaderCompiler
+{
+public:
+	size_t compiles = 0;
+
+	bool Compile(const ShaderRequest& request, std::string_view source, std::vector<uint8_t>& bytecode,
+		std::vector<std::filesystem::path>& includes, std::string& errors) override
+	{
+		compiles++;
+
+		if (source.find("error") != std::string_view::npos)
+		{
+			errors = request.file.string() + ": error";
+			return false;
+		}
+
+		std::string output;
+
+		for (size_t begin = 0; begin < source.size();)
+		{
+			const size_t    end     = std::min(source.find('\n', begin), source.size());
+			const auto      line    = source.substr(begin, end - begin);
+
+			if (line.starts_with("include "))
+			{
+				const auto      path = request.file.parent_path() / std::string{ line.substr(8) };
+				std::ifstream   stream{ path, std::ios::binary };
+
+				output.append(std::istreambuf_iterator<char>{ stream }, std::istreambuf_iterator<char>{});
+				includes.push_back(path);
+			}
+			else
+				output.append(line);
+
+			output += '\n';
+			begin = end + 1;
+		}
+
+		output += request.entryPoint;
+
+		for (const auto& define : request.defines)
+			output += " " + define.name + "=" + define.value;
+
+		bytecode.assign(output.begin(), output.end());
+		return true;
+	}
+};
+
+// A directory of its own per test, removed again on exit
+struct TemporaryDirectory
+{
+	std::filesystem::path path;
+
+	explicit TemporaryDirectory(const char* name)
+		: path{ std::filesystem::temp_directory_path() / "ShaderCacheTests" / name }
+	{
+		std::filesystem::remove_all(path);
+		std::filesystem::create_directories(path);
+	}
+
+	~TemporaryDirectory()
+	{
+		std::error_code error;
+		std::filesystem::remove_all(path, error);
+	}
+};
+
+static void WriteText(const std::filesystem::path& path, const std::string_view text)
+{
+	std::ofstream stream{ path, std::ios::binary | std::ios::trunc };
+	stream.write(text.data(), std::streamsize(text.size()));
+}
+
+static std::string Text(const std::vector<uint8_t>& bytecode)
+{
+	return { bytecode.begin(), bytecode.end() };
+}
+
+// The cache directory is expected to hold exactly one entry
+static std::filesystem::path OnlyEntry(const std::filesystem::path& directory)
+{
+	std::filesystem::path   entry;
+	size_t                  count = 0;
+
+	for (const auto& file : std::filesystem::directory_iterator{ directory })
+	{
+		entry = file.path();
+		count++;
+	}
+
+	CHECK(count == 1);
+	return entry;
+}
+
+static void TestHitAndMiss()
+{
+	TemporaryDirectory  directory{ "HitAndMiss" };
+	StubCompiler        compiler;
+	ShaderCache         cache{ directory.path / "cache", compiler };
+
+	const ShaderRequest request{ directory.path / "shader.hlsl", "main", "vs_5_0", 0, {} };
+	WriteText(request.file, "body");
+
+	std::vector<uint8_t> first;
+	std::vector<uint8_t> second;
+
+	CHECK(cache.Load(request, first));
+	CHECK(cache.Misses() == 1 && cache.Hits() == 0 && compiler.compiles == 1);
+	CHECK(Text(first) == "body\nmain");
+
+	CHECK(cache.Load(request, second));
+	CHECK(cache.Misses() == 1 && cache.Hits() == 1 && compiler.compiles == 1);
+	CHECK(second == first);
+
+	// A new cache over the same directory, as on the next run
+	ShaderCache reopened{ directory.path / "cache", compiler };
+
+	CHECK(reopened.Load(request, second));
+	CHECK(reopened.Hits() == 1 && compiler.compiles == 1);
+	CHECK(second == first);
+
+	// Edited source, other entry point
+	WriteText(request.file, "edited");
+	CHECK(cache.Load(request, second));
+	CHECK(compiler.compiles == 2 && Text(second) == "edited\nmain");
+
+	ShaderRequest other = request;
+	other.entryPoint = "other";
+
+	CHECK(cache.Load(other, second));
+	CHECK(compiler.compiles == 3 && Text(second) == "edited\nother");
+}
+
+static void TestSourcePath()
+{
+	TemporaryDirectory  directory{ "SourcePath" };
+	StubCompiler        compiler;
+	ShaderCache         cache{ directory.path / "cache", compiler };
+
+	// Same text, but the includes resolve against different directories
+	std::filesystem::create_directories(directory.path / "a");
+	std::filesystem::create_directories(directory.path / "b");
+
+	WriteText(directory.path / "a" / "shader.hlsl", "include common.hlsli");
+	WriteText(directory.path / "b" / "shader.hlsl", "include common.hlsli");
+	WriteText(directory.path / "a" / "common.hlsli", "a");
+	WriteText(directory.path / "b" / "common.hlsli", "b");
+
+	const ShaderRequest first{ directory.path / "a" / "shader.hlsl", "main", "vs_5_0", 0, {} };
+	const ShaderRequest second{ directory.path / "b" / "shader.hlsl", "main", "vs_5_0", 0, {} };
+
+	CHECK(ShaderCache::Key(first, "source") != ShaderCache::Key(second, "source"));
+
+	std::vector<uint8_t> bytecode;
+
+	CHECK(cache.Load(first, bytecode) && Text(bytecode) == "a\nmain");
+	CHECK(cache.Load(second, bytecode) && Text(bytecode) == "b\nmain");
+	CHECK(cache.Misses() == 2 && cache.Hits() == 0);
+}
+
+static void TestChangedInclude()
+{
+	TemporaryDirectory  directory{ "ChangedInclude" };
+	StubCompiler        compiler;
+	ShaderCache         cache{ directory.path / "cache", compiler };
+
+	const ShaderRequest request{ directory.path / "shader.hlsl", "main", "ps_5_0", 0, {} };
+	WriteText(request.file, "include common.hlsli\nbody");
+	WriteText(directory.path / "common.hlsli", "old");
+
+	std::vector<uint8_t> bytecode;
+
+	CHECK(cache.Load(request, bytecode) && Text(bytecode) == "old\nbody\nmain");
+	CHECK(cache.Load(request, bytecode) && cache.Hits() == 1);
+
+	// The source is unchanged, only the include's hash tells
+	WriteText(directory.path / "common.hlsli", "new");
+
+	CHECK(cache.Load(request, bytecode) && Text(bytecode) == "new\nbody\nmain");
+	CHECK(cache.Misses() == 2 && compiler.compiles == 2);
+
+	CHECK(cache.Load(request, bytecode) && Text(bytecode) == "new\nbody\nmain");
+	CHECK(cache.Hits() == 2 && compiler.compiles == 2);
+
+	// A deleted include never matches
+	std::filesystem::remove(directory.path / "common.hlsli");
+
+	CHECK(cache.Load(request, bytecode));
+	CHECK(compiler.compiles == 3);
+}
+
+static void TestChangedDefine()
+{
+	TemporaryDirectory  directory{ "ChangedDefine" };
+	StubCompiler        compiler;
+	ShaderCache         cache{ directory.path / "cache", compiler };
+
+	ShaderRequest request{ directory.path / "shader.hlsl", "main", "vs_5_0", 0, { { "COMPACT", "1" } } };
+	WriteText(request.file, "body");
+
+	std::vector<uint8_t> bytecode;
+
+	CHECK(cache.Load(request, bytecode) && Text(bytecode) == "body\nmain COMPACT=1");
+
+	request.defines[0].value = "0";
+	CHECK(cache.Load(request, bytecode) && Text(bytecode) == "body\nmain COMPACT=0");
+	CHECK(compiler.compiles == 2);
+
+	// Name and value can't run together
+	request.defines = { { "COMPACT=", "" } };
+	CHECK(cache.Load(request, bytecode));
+	CHECK(compiler.compiles == 3);
+
+	// Both earlier variants are still on disk
+	request.defines = { { "COMPACT", "1" } };
+	CHECK(cache.Load(request, bytecode) && Text(bytecode) == "body\nmain COMPACT=1");
+
+	request.defines = { { "COMPACT", "0" } };
+	CHECK(cache.Load(request, bytecode) && Text(bytecode) == "body\nmain COMPACT=0");
+
+	CHECK(cache.Hits() == 2 && compiler.compiles == 3);
+}
+
+static void TestCorruptEntry()
+{
+	TemporaryDirectory  directory{ "CorruptEntry" };
+	StubCompiler        compiler;
+
+	const ShaderRequest request{ directory.path / "shader.hlsl", "main", "vs_5_0", 0, {} };
+	WriteText(request.file, "include common.hlsli\nbody");
+	WriteText(directory.path / "common.hlsli", "common");
+
+	const auto          cacheDirectory  = directory.path / "cache";
+	const std::string   expected        = "common\nbody\nmain";
+
+	std::vector<uint8_t> bytecode;
+	{
+		ShaderCache cache{ cacheDirectory, compiler };
+		CHECK(cache.Load(request, bytecode) && Text(bytecode) == expected);
+	}
+
+	const auto  entry   = OnlyEntry(cacheDirectory);
+	std::string valid;
+	{
+		std::ifstream stream{ entry, std::ios::binary };
+		valid.assign(std::istreambuf_iterator<char>{ stream }, std::istreambuf_iterator<char>{});
+	}
+
+	// Layout: magic 4, key 8, include count 4, then the include's path length 4
+	const size_t includeCountOffset = 12;
+	const size_t pathLengthOffset   = 16;
+	const size_t bytecodeSizeOffset = valid.size() - expected.size() - sizeof(uint64_t);
+
+	auto Patch = [&](const size_t offset, const auto value)
+	{
+		std::string patched = valid;
+		patched.replace(offset, sizeof(value), reinterpret_cast<const char*>(&value), sizeof(value));
+		return patched;
+	};
+
+	const std::string corrupt[] = {
+		"",
+		valid.substr(0, 3),
+		valid.substr(0, pathLengthOffset + 2),
+		valid.substr(0, valid.size() - 1),
+		valid + "x",
+		Patch(0, uint32_t(0)),
+		Patch(includeCountOffset, uint32_t(0xFFFFFFFF)),
+		Patch(pathLengthOffset, uint32_t(0xFFFFFFFF)),
+		Patch(bytecodeSizeOffset, uint64_t(0xFFFFFFFFFFFFFFFF)),
+		Patch(bytecodeSizeOffset, uint64_t(expected.size() - 1)),
+	};
+
+	size_t compiles = compiler.compiles;
+
+	for (const auto& content : corrupt)
+	{
+		WriteText(entry, content);
+
+		ShaderCache cache{ cacheDirectory, compiler };
+
+		// A miss, compiled again and the entry rewritten
+		CHECK(cache.Load(request, bytecode) && Text(bytecode) == expected);
+		CHECK(cache.Misses() == 1 && cache.Hits() == 0 && compiler.compiles == ++compiles);
+
+		CHECK(cache.Load(request, bytecode) && Text(bytecode) == expected);
+		CHECK(cache.Hits() == 1 && compiler.compiles == compiles);
+	}
+
+	// The untouched entry still reads back
+	WriteText(entry, valid);
+
+	ShaderCache cache{ cacheDirectory, compiler };
+	CHECK(cache.Load(request, bytecode) && Text(bytecode) == expected);
+	CHECK(cache.Hits() == 1 && compiler.compiles == compiles);
+}
+
+static void TestFailures()
+{
+	TemporaryDirectory  directory{ "Failures" };
+	StubCompiler        compiler;
+	ShaderCache         cache{ directory.path / "cache", compiler };
+
+	std::vector<uint8_t>    bytecode;
+	std::string             errors;
+
+	const ShaderRequest missing{ directory.path / "missing.hlsl", "main", "vs_5_0", 0, {} };
+	CHECK(!cache.Load(missing, bytecode, &errors));
+	CHECK(compiler.compiles == 0);
+
+	const ShaderRequest broken{ directory.path / "broken.hlsl", "main", "vs_5_0", 0, {} };
+	WriteText(broken.file, "error");
+
+	CHECK(!cache.Load(broken, bytecode, &errors));
+	CHECK(errors.find("error") != std::string::npos);
+
+	// Failures are not stored
+	CHECK(!cache.Load(broken, bytecode));
+	CHECK(compiler.compiles == 2);
+	CHECK(cache.Failures() == 3 && cache.Hits() == 0 && cache.Misses() == 0);
+	CHECK(!std::filesystem::exists(directory.path / "cache") || std::filesystem::is_empty(directory.path / "cache"));
+}
+
+int main()
+{
+	TestHitAndMiss();
+	TestSourcePath();
+	TestChangedInclude();
+	TestChangedDefine();
+	TestCorruptEntry();
+	TestFailures();
+
+	return CheckResult("ShaderCacheTests");
+}
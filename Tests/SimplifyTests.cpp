@@ -0,0 +1,253 @@
+#include "Check.hpp"
+#include "TestMeshes.hpp"
+
+#include "Simplify.hpp"
+#include "Threading.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <set>
+#include <utility>
+#include <vector>
+
+static float3 Normal(const TestMesh& mesh, const uint32_t* tri)
+{
+	return TriangleNormal(
+		LoadFloat3(mesh.positions.data() + 3 * tri[0]),
+		LoadFloat3(mesh.positions.data() + 3 * tri[1]),
+		LoadFloat3(mesh.positions.data() + 3 * tri[2]));
+}
+
+// Edges used by a single triangle, by vertex index
+static std::set<std::pair<uint32_t, uint32_t>> OpenEdges(const std::vector<uint32_t>& indices)
+{
+	std::multiset<std::pair<uint32_t, uint32_t>> edges;
+
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		for (size_t e = 0; e < 3; e++)
+		{
+			const uint32_t a = indices[i + e];
+			const uint32_t b = indices[i + (e + 1) % 3];
+
+			edges.insert({ std::min(a, b), std::max(a, b) });
+		}
+	}
+
+	std::set<std::pair<uint32_t, uint32_t>> open;
+	for (const auto& edge : edges)
+	{
+		if (edges.count(edge) == 1)
+			open.insert(edge);
+	}
+
+	return open;
+}
+
+// The grid with its middle column split, triangles right of it use copies of the
+// column's vertices at the same positions, like a uv seam
+static TestMesh MakeSeamGrid(const uint32_t size)
+{
+	auto mesh = MakeGrid(size);
+
+	const uint32_t column   = size / 2;
+	const uint32_t original = uint32_t(mesh.VertexCount());
+
+	for (uint32_t z = 0; z <= size; z++)
+	{
+		const uint32_t v = z * (size + 1) + column;
+		mesh.positions.insert(mesh.positions.end(), { mesh.positions[3 * v], mesh.positions[3 * v + 1], mesh.positions[3 * v + 2] });
+	}
+
+	for (size_t i = 0; i < mesh.indices.size(); i += 3)
+	{
+		uint32_t maxX = 0;
+		for (size_t k = 0; k < 3; k++)
+			maxX = std::max(maxX, mesh.indices[i + k] % (size + 1));
+
+		if (maxX <= column)
+			continue;
+
+		for (size_t k = 0; k < 3; k++)
+		{
+			if (mesh.indices[i + k] % (size + 1) == column)
+				mesh.indices[i + k] = original + mesh.indices[i + k] / (size + 1);
+		}
+	}
+
+	return mesh;
+}
+
+static void TestTargetReached()
+{
+	const auto grid = MakeGrid(32);
+
+	for (const size_t divisor : { 2, 4, 8 })
+	{
+		for (const bool preserveBorder : { true, false })
+		{
+			SimplifyOptions options;
+			options.targetIndexCount    = grid.indices.size() / divisor / 3 * 3;
+			options.preserveBorder      = preserveBorder;
+
+			const auto result = Simplify(grid.positions.data(), grid.VertexCount(), grid.indices.data(), grid.indices.size(), options);
+
+			CHECK(result.indices.size() % 3 == 0);
+			CHECK(!result.indices.empty() && result.indices.size() <= options.targetIndexCount);
+			CHECK(std::all_of(result.indices.begin(), result.indices.end(), [&](uint32_t v) { return v < grid.VertexCount(); }));
+			CHECK(result.error > 0.0f);
+		}
+	}
+
+	// Nothing to do
+	SimplifyOptions options;
+	options.targetIndexCount = grid.indices.size();
+
+	const auto unchanged = Simplify(grid.positions.data(), grid.VertexCount(), grid.indices.data(), grid.indices.size(), options);
+	CHECK(unchanged.indices == grid.indices && unchanged.error == 0.0f);
+
+	// An error budget of zero keeps the wave
+	options.targetIndexCount    = 0;
+	options.targetError         = 0.0f;
+
+	const auto exact = Simplify(grid.positions.data(), grid.VertexCount(), grid.indices.data(), grid.indices.size(), options);
+	CHECK(exact.error == 0.0f);
+}
+
+// Locked vertices never collapse, so every open edge, border or seam side, survives as is
+static void TestLockedBordersAndSeams()
+{
+	const auto mesh = MakeSeamGrid(24);
+	const auto open = OpenEdges(mesh.indices);
+
+	// The border and both sides of the seam
+	CHECK(open.size() == 4 * 24 + 2 * 24);
+
+	SimplifyOptions options;
+	options.targetIndexCount = mesh.indices.size() / 8 / 3 * 3;
+
+	const auto result = Simplify(mesh.positions.data(), mesh.VertexCount(), mesh.indices.data(), mesh.indices.size(), options);
+
+	CHECK(result.indices.size() < mesh.indices.size() / 2);
+	CHECK(OpenEdges(result.indices) == open);
+
+	// Without border locking only the seam holds
+	options.preserveBorder = false;
+
+	const auto free     = Simplify(mesh.positions.data(), mesh.VertexCount(), mesh.indices.data(), mesh.indices.size(), options);
+	const auto freeOpen = OpenEdges(free.indices);
+
+	for (const auto& edge : open)
+	{
+		const bool seam = (edge.first % 25 == 12 && edge.second % 25 == 12) || edge.first >= 25 * 25;
+
+		if (seam)
+			CHECK(freeOpen.count(edge) == 1);
+	}
+}
+
+static void TestNoFlips()
+{
+	// Every grid triangle faces the same way, the sphere's face outwards
+	const auto grid = MakeGrid(48);
+
+	SimplifyOptions options;
+	options.targetIndexCount = grid.indices.size() / 10 / 3 * 3;
+
+	const float side    = Normal(grid, grid.indices.data()).y;
+	const auto  reduced = Simplify(grid.positions.data(), grid.VertexCount(), grid.indices.data(), grid.indices.size(), options);
+
+	for (size_t i = 0; i < reduced.indices.size(); i += 3)
+		CHECK(Normal(grid, reduced.indices.data() + i).y * side > 0.0f);
+
+	const auto sphere = MakeSphere(32, 64);
+
+	options.targetIndexCount = sphere.indices.size() / 10 / 3 * 3;
+
+	const auto simplified = Simplify(sphere.positions.data(), sphere.VertexCount(), sphere.indices.data(), sphere.indices.size(), options);
+
+	CHECK(simplified.indices.size() <= options.targetIndexCount);
+
+	for (size_t i = 0; i < simplified.indices.size(); i += 3)
+	{
+		const uint32_t* tri     = simplified.indices.data() + i;
+		const float3    center  = LoadFloat3(sphere.positions.data() + 3 * tri[0]) + LoadFloat3(sphere.positions.data() + 3 * tri[1]) + LoadFloat3(sphere.positions.data() + 3 * tri[2]);
+
+		CHECK(Dot(Normal(sphere, tri), center) > 0.0f);
+	}
+}
+
+static void TestChain()
+{
+	const auto sphere   = MakeSphere(32, 64);
+	const auto chain    = BuildLODChain(sphere.positions.data(), sphere.VertexCount(), sphere.indices.data(), sphere.indices.size());
+
+	CHECK(chain.size() == LODSettings{}.maxLevels);
+	CHECK(chain[0].indices == sphere.indices && chain[0].error == 0.0f);
+
+	for (size_t level = 1; level < chain.size(); level++)
+	{
+		CHECK(chain[level].indices.size() < chain[level - 1].indices.size());
+		CHECK(chain[level].error >= chain[level - 1].error);
+	}
+
+	CHECK(chain.back().error > 0.0f);
+
+	// The same sphere as one shape of a larger buffer, behind unused vertices and a grid
+	const auto  grid    = MakeGrid(16);
+	const auto  offset  = uint32_t(2 * grid.VertexCount());
+
+	std::vector<float> positions(3 * grid.VertexCount(), 100.0f);
+	positions.insert(positions.end(), grid.positions.begin(), grid.positions.end());
+	positions.insert(positions.end(), sphere.positions.begin(), sphere.positions.end());
+
+	std::vector<std::vector<uint32_t>> shapes(2);
+
+	for (const uint32_t v : grid.indices)
+		shapes[0].push_back(v + uint32_t(grid.VertexCount()));
+
+	for (const uint32_t v : sphere.indices)
+		shapes[1].push_back(v + offset);
+
+	ThreadPool  threads{ 2 };
+	const auto  chains = BuildLODChains(threads, positions.data(), positions.size() / 3, shapes);
+
+	CHECK(chains.size() == 2 && chains[1].size() == chain.size());
+
+	for (size_t level = 0; level < std::min(chain.size(), chains[1].size()); level++)
+	{
+		std::vector<uint32_t> expected = chain[level].indices;
+		for (auto& v : expected)
+			v += offset;
+
+		CHECK(chains[1][level].indices == expected);
+		CHECK(chains[1][level].error == chain[level].error);
+	}
+
+	for (const auto& level : chains[0])
+	{
+		CHECK(std::all_of(level.indices.begin(), level.indices.end(),
+			[&](uint32_t v) { return v >= grid.VertexCount() && v < offset; }));
+	}
+}
+
+static void TestSelectLOD()
+{
+	const std::vector<LODLevel> lods = { { {}, 0.0f }, { {}, 0.01f }, { {}, 0.1f } };
+
+	// 1000 pixels per unit at distance 1
+	CHECK(SelectLOD(lods, 1.0f, 1000.0f, 1.0f) == 0);
+	CHECK(SelectLOD(lods, 10.0f, 1000.0f, 1.0f) == 1);
+	CHECK(SelectLOD(lods, 100.0f, 1000.0f, 1.0f) == 2);
+}
+
+int main()
+{
+	TestTargetReached();
+	TestLockedBordersAndSeams();
+	TestNoFlips();
+	TestChain();
+	TestSelectLOD();
+
+	return CheckResult("SimplifyTests");
+}
@@ -0,0 +1,176 @@
+#include "Check.hpp"
+
+#include "RecordingContext.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Setting what is bound again reaches the context once, draws always go through
+static void TestRedundantCalls()
+{
+	RecordingContext    context;
+	MockStateCache      state{ &context };
+
+	MockInputLayout     layout;
+	MockShader          vs, ps;
+	MockBuffer          indices;
+	MockView            target, depth;
+	MockView*           targets[]   = { &target };
+	const MockViewport  viewport    = { 0.0f, 0.0f, 640.0f, 480.0f, 0.0f, 1.0f };
+
+	for (int repeat = 0; repeat < 3; repeat++)
+	{
+		state.IASetInputLayout(&layout);
+		state.IASetPrimitiveTopology(4);
+		state.IASetIndexBuffer(&indices, 42, 0);
+		state.VSSetShader(&vs, nullptr, 0);
+		state.PSSetShader(&ps, nullptr, 0);
+		state.RSSetViewports(1, &viewport);
+		state.OMSetRenderTargets(1, targets, &depth);
+		state.DrawIndexed(3, 0, 0);
+	}
+
+	CHECK(context.calls.size() == 7 + 3);
+	CHECK(state.Stats().issued == 7);
+	CHECK(state.Stats().skipped == 2 * 7);
+
+	// A changed value and a changed array count are issued again
+	context.calls.clear();
+
+	MockShader otherPS;
+	state.PSSetShader(&otherPS, nullptr, 0);
+	state.RSSetViewports(0, nullptr);
+	state.IASetIndexBuffer(&indices, 42, 64);
+
+	CHECK(context.calls.size() == 3);
+
+	// Class instances are not tracked, such calls always reach the context
+	context.calls.clear();
+
+	void* instances[1] = {};
+	state.VSSetShader(&vs, instances, 1);
+	state.VSSetShader(&vs, instances, 1);
+	state.VSSetShader(&vs, nullptr, 0);
+
+	CHECK(context.calls.size() == 3);
+}
+
+// Slot ranges shrink to the slots that changed, nothing is issued if none did
+static void TestSlotTrimming()
+{
+	RecordingContext    context;
+	MockStateCache      state{ &context };
+
+	MockBuffer  a, b, c, d, e;
+	MockBuffer* buffers[]   = { &a, &b, &c, &d };
+	uint32_t    strides[]   = { 12, 16, 8, 4 };
+	uint32_t    offsets[]   = { 0, 0, 0, 0 };
+
+	state.IASetVertexBuffers(0, 4, buffers, strides, offsets);
+	CHECK(context.calls.back() == (RecordingContext::Call{ "IASetVertexBuffers", 0, 4 }));
+
+	buffers[2] = &e;
+	state.IASetVertexBuffers(0, 4, buffers, strides, offsets);
+	CHECK(context.calls.back() == (RecordingContext::Call{ "IASetVertexBuffers", 2, 1 }));
+
+	// Changes at both ends keep the unchanged slots between them
+	buffers[0] = &e;
+	strides[3] = 20;
+	state.IASetVertexBuffers(0, 4, buffers, strides, offsets);
+	CHECK(context.calls.back() == (RecordingContext::Call{ "IASetVertexBuffers", 0, 4 }));
+
+	const size_t issued = context.calls.size();
+	state.IASetVertexBuffers(0, 4, buffers, strides, offsets);
+	state.IASetVertexBuffers(1, 2, buffers + 1, strides + 1, offsets + 1);
+	CHECK(context.calls.size() == issued);
+
+	// Per stage constant buffers, a start slot carries over to the trimmed range
+	MockBuffer* constants[] = { &a, &b, &c };
+
+	state.VSSetConstantBuffers(2, 3, constants);
+	state.PSSetConstantBuffers(2, 3, constants);
+
+	constants[2] = &d;
+	state.VSSetConstantBuffers(2, 3, constants);
+
+	CHECK(context.calls.back() == (RecordingContext::Call{ "VSSetConstantBuffers", 4, 1 }));
+	CHECK(context.calls.size() == issued + 3);
+
+	// Slots beyond the API's count are dropped rather than written past the table
+	MockBuffer* many[40]    = {};
+	uint32_t    zeros[40]   = {};
+
+	many[39] = &a;
+	state.IASetVertexBuffers(0, 40, many, zeros, zeros);
+	CHECK(context.calls.back() == (RecordingContext::Call{ "IASetVertexBuffers", 0, 32 }));
+}
+
+// After Invalidate every kind of call is issued again, after ClearState unbinding is redundant
+static void TestInvalidate()
+{
+	RecordingContext    context;
+	MockStateCache      state{ &context };
+
+	MockInputLayout     layout;
+	MockShader          vs;
+	MockBuffer          buffer;
+	MockBuffer*         buffers[]   = { &buffer };
+	const uint32_t      strides[]   = { 12 };
+	const uint32_t      offsets[]   = { 0 };
+
+	auto Bind = [&]
+	{
+		state.IASetInputLayout(&layout);
+		state.VSSetShader(&vs, nullptr, 0);
+		state.IASetVertexBuffers(0, 1, buffers, strides, offsets);
+		state.VSSetConstantBuffers(0, 1, buffers);
+	};
+
+	Bind();
+	CHECK(context.calls.size() == 4);
+
+	Bind();
+	CHECK(context.calls.size() == 4);
+
+	state.Invalidate();
+	Bind();
+	CHECK(context.calls.size() == 8);
+
+	state.InvalidateConstantBuffers();
+	Bind();
+	CHECK(context.calls.size() == 9);
+	CHECK(context.calls.back().name == "VSSetConstantBuffers");
+
+	// Before anything is known, unbinding has to be issued
+	RecordingContext    fresh;
+	MockStateCache      unknown{ &fresh };
+
+	unknown.IASetInputLayout(nullptr);
+	CHECK(fresh.calls.size() == 1);
+
+	state.ClearState();
+	CHECK(context.calls.back().name == "ClearState");
+
+	const size_t    issued  = context.calls.size();
+	MockBuffer*     none[]  = { nullptr };
+	const uint32_t  zero[]  = { 0 };
+
+	state.IASetInputLayout(nullptr);
+	state.VSSetShader(nullptr, nullptr, 0);
+	state.IASetVertexBuffers(0, 1, none, zero, zero);
+	state.VSSetConstantBuffers(0, 1, none);
+	state.OMSetRenderTargets(0, nullptr, nullptr);
+	CHECK(context.calls.size() == issued);
+
+	Bind();
+	CHECK(context.calls.size() == issued + 4);
+}
+
+int main()
+{
+	TestRedundantCalls();
+	TestSlotTrimming();
+	TestInvalidate();
+
+	return CheckResult("StateCacheTests");
+}
@@ -0,0 +1,115 @@
+#include "Check.hpp"
+#include "TestMeshes.hpp"
+
+#include "Tangents.hpp"
+#include "Threading.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Same vertices, indices and tangent bits
+static bool SameMesh(const TangentMesh& a, const TangentMesh& b)
+{
+	return a.source == b.source && a.indices == b.indices && a.tangents.size() == b.tangents.size()
+		&& !std::memcmp(a.tangents.data(), b.tangents.data(), a.tangents.size() * sizeof(Tangent));
+}
+
+// Sums run in corner order, so the pool size must not change a single bit. The grid is
+// large enough that every pass splits into several jobs, its right half mirrors u.
+static void TestThreadCount()
+{
+	const auto grid = MakeGrid(128);
+
+	std::vector<float>      texcoords;
+	std::vector<uint32_t>   attributes(grid.indices.size());
+
+	for (size_t v = 0; v < grid.VertexCount(); v++)
+	{
+		const float x = grid.positions[3 * v + 0];
+		const float z = grid.positions[3 * v + 2];
+
+		texcoords.insert(texcoords.end(), { x < 0.0f ? x + 1.0f : 1.0f - x, 0.5f * z + 0.5f });
+	}
+
+	for (size_t c = 0; c < attributes.size(); c++)
+		attributes[c] = grid.indices[c];
+
+	const auto normals = GenerateNormals(grid.positions.data(), { grid.indices, attributes, {} });
+
+	ThreadPool single{ 0 };
+	ThreadPool workers{ 3 };
+
+	const auto reference = GenerateTangents(single, grid.positions.data(), texcoords.data(), normals);
+
+	CHECK(reference.indices.size() == grid.indices.size());
+	CHECK(reference.source.size() > normals.vertices.size());
+
+	for (size_t repeat = 0; repeat < 4; repeat++)
+		CHECK(SameMesh(GenerateTangents(workers, grid.positions.data(), texcoords.data(), normals), reference));
+
+	// Shapes in parallel, each spreading over the pool as well
+	const std::vector<NormalMesh> meshes = { normals, normals };
+	const auto parallel = GenerateTangents(workers, grid.positions.data(), texcoords.data(), meshes);
+
+	CHECK(parallel.size() == 2);
+
+	for (const auto& mesh : parallel)
+		CHECK(SameMesh(mesh, reference));
+}
+
+// Two quads in the xy plane sharing the x = 0 edge, u runs along +x on the left and
+// along -x on the right, v along +y on both
+static void TestMirrorSeam()
+{
+	const std::vector<float> positions = {
+		-1.0f, 0.0f, 0.0f,   0.0f, 0.0f, 0.0f,   1.0f, 0.0f, 0.0f,
+		-1.0f, 1.0f, 0.0f,   0.0f, 1.0f, 0.0f,   1.0f, 1.0f, 0.0f,
+	};
+
+	const std::vector<float> texcoords = {
+		0.0f, 0.0f,   1.0f, 0.0f,   0.0f, 0.0f,
+		0.0f, 1.0f,   1.0f, 1.0f,   0.0f, 1.0f,
+	};
+
+	const std::vector<uint32_t> indices = { 0, 3, 4,   0, 4, 1,   1, 4, 5,   1, 5, 2 };
+
+	// One texcoord per position, the seam vertices weld into a single normal vertex
+	const auto normals = GenerateNormals(positions.data(), { indices, indices, {} });
+	CHECK(normals.vertices.size() == 6);
+
+	ThreadPool threads{ 0 };
+	const auto mesh = GenerateTangents(threads, positions.data(), texcoords.data(), normals);
+
+	// Both seam vertices split into one vertex per side
+	CHECK(mesh.source.size() == 8);
+	CHECK(mesh.indices.size() == indices.size());
+
+	for (size_t c = 0; c < mesh.indices.size() && mesh.indices.size() == indices.size(); c++)
+	{
+		const bool      left        = c < 6;
+		const uint32_t  vertex      = mesh.indices[c];
+		const auto&     tangent     = mesh.tangents[vertex];
+		const float3    normal      = normals.vertices[mesh.source[vertex]].normal;
+		const float3    bitangent   = Cross(normal, tangent.direction) * tangent.sign;
+
+		CHECK(normals.vertices[mesh.source[vertex]].position == indices[c]);
+
+		// The tangent follows u, the bitangent follows v on both sides
+		CHECK(tangent.direction.x * (left ? 1.0f : -1.0f) > 0.999f);
+		CHECK(bitangent.y > 0.999f);
+		CHECK(tangent.sign == (left ? mesh.tangents[mesh.indices[0]].sign : -mesh.tangents[mesh.indices[0]].sign));
+	}
+
+	// The seam corners of the two sides land on different vertices
+	CHECK(mesh.indices[5] != mesh.indices[6]);
+	CHECK(mesh.indices[4] != mesh.indices[7]);
+}
+
+int main()
+{
+	TestThreadCount();
+	TestMirrorSeam();
+
+	return CheckResult("TangentsTests");
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Synthetic meshes and cameras for the headless tests and benchmarks
+
+struct TestMesh
+{
+	std::vector<float>      positions;      // xyz
+	std::vector<uint32_t>   indices;
+
+	size_t VertexCount() const noexcept { return positions.size() / 3; }
+};
+
+// size x size quads on the xz plane in [-1, 1], heights from a gentle wave so normals vary
+inline TestMesh MakeGrid(const uint32_t size)
+{
+	TestMesh mesh;
+
+	for (uint32_t z = 0; z <= size; z++)
+	{
+		for (uint32_t x = 0; x <= size; x++)
+		{
+			const float u = 2.0f * x / size - 1.0f;
+			const float v = 2.0f * z / size - 1.0f;
+
+			mesh.positions.insert(mesh.positions.end(), { u, 0.1f * std::sin(4.0f * u) * std::cos(4.0f * v), v });
+		}
+	}
+
+	for (uint32_t z = 0; z < size; z++)
+	{
+		for (uint32_t x = 0; x < size; x++)
+		{
+			const uint32_t a = z * (size + 1) + x;
+			const uint32_t b = a + 1;
+			const uint32_t c = a + size + 1;
+			const uint32_t d = c + 1;
+
+			mesh.indices.insert(mesh.indices.end(), { a, c, b, b, c, d });
+		}
+	}
+
+	return mesh;
+}
+
+// Closed unit sphere around the origin, a vertex at each pole and rings x segments
+// quads between them. Wound like the app's meshes, TriangleNormal points outwards.
+inline TestMesh MakeSphere(const uint32_t rings, const uint32_t segments)
+{
+	TestMesh mesh;
+	mesh.positions.reserve(3 * (size_t(rings - 1) * segments + 2));
+	mesh.indices.reserve(6 * size_t(rings - 1) * segments);
+
+	mesh.positions.insert(mesh.positions.end(), { 0.0f, 1.0f, 0.0f });
+
+	for (uint32_t ring = 1; ring < rings; ring++)
+	{
+		const float theta = 3.1415927f * ring / rings;
+
+		for (uint32_t segment = 0; segment < segments; segment++)
+		{
+			const float phi = 2.0f * 3.1415927f * segment / segments;
+
+			mesh.positions.insert(mesh.positions.end(), { std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) });
+		}
+	}
+
+	mesh.positions.insert(mesh.positions.end(), { 0.0f, -1.0f, 0.0f });
+
+	const uint32_t bottom = uint32_t(mesh.VertexCount() - 1);
+
+	auto Ring = [&](const uint32_t ring, const uint32_t segment) { return 1 + (ring - 1) * segments + segment % segments; };
+
+	for (uint32_t segment = 0; segment < segments; segment++)
+		mesh.indices.insert(mesh.indices.end(), { 0, Ring(1, segment), Ring(1, segment + 1) });
+
+	for (uint32_t ring = 1; ring + 1 < rings; ring++)
+	{
+		for (uint32_t segment = 0; segment < segments; segment++)
+		{
+			const uint32_t a = Ring(ring, segment);
+			const uint32_t b = Ring(ring, segment + 1);
+			const uint32_t c = Ring(ring + 1, segment);
+			const uint32_t d = Ring(ring + 1, segment + 1);
+
+			mesh.indices.insert(mesh.indices.end(), { a, c, b, b, c, d });
+		}
+	}
+
+	for (uint32_t segment = 0; segment < segments; segment++)
+		mesh.indices.insert(mesh.indices.end(), { bottom, Ring(rings - 1, segment + 1), Ring(rings - 1, segment) });
+
+	return mesh;
+}
+
+// Row-vector view-projection like Camera::GetPV, a left handed look-at and perspective
+// with D3D [0, w] depth, without DirectXMath
+inline void MakeViewProjection(const float eye[3], const float target[3], const float fovY, const float aspect, const float zNear, const float zFar, float (&pv)[4][4])
+{
+	auto Normalized = [](float x, float y, float z, float (&out)[3])
+	{
+		const float length = std::sqrt(x * x + y * y + z * z);
+		out[0] = x / length;
+		out[1] = y / length;
+		out[2] = z / length;
+	};
+
+	float z[3], x[3], y[3];
+	Normalized(target[0] - eye[0], target[1] - eye[1], target[2] - eye[2], z);
+	Normalized(z[2], 0.0f, -z[0], x);                      // up (0, 1, 0) cross z
+	Normalized(z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0], y);
+
+	auto Dot = [](const float (&a)[3], const float* b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; };
+
+	const float view[4][4] = {
+		{ x[0],         y[0],           z[0],           0.0f },
+		{ x[1],         y[1],           z[1],           0.0f },
+		{ x[2],         y[2],           z[2],           0.0f },
+		{ -Dot(x, eye), -Dot(y, eye),   -Dot(z, eye),   1.0f },
+	};
+
+	const float h = 1.0f / std::tan(0.5f * fovY);
+	const float w = h / aspect;
+	const float r = zFar / (zFar - zNear);
+
+	const float projection[4][4] = {
+		{ w,    0.0f,   0.0f,           0.0f },
+		{ 0.0f, h,      0.0f,           0.0f },
+		{ 0.0f, 0.0f,   r,              1.0f },
+		{ 0.0f, 0.0f,   -r * zNear,     0.0f },
+	};
+
+	for (int row = 0; row < 4; row++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			pv[row][column] = 0.0f;
+
+			for (int k = 0; k < 4; k++)
+				pv[row][column] += view[row][k] * projection[k][column];
+		}
+	}
+}
@@ -0,0 +1,218 @@
+#include "Check.hpp"
+
+#include "TransientTextures.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// DXGI_FORMAT_R16G16B16A16_FLOAT and DXGI_FORMAT_R8G8B8A8_UNORM, render target | shader resource
+static TextureKey Key(const uint32_t width, const uint32_t height, const uint32_t format = 10, const uint32_t bytesPerTexel = 8)
+{
+	TextureKey key;
+	key.width           = width;
+	key.height          = height;
+	key.format          = format;
+	key.bindFlags       = 0x28;
+	key.bytesPerTexel   = bytesPerTexel;
+
+	return key;
+}
+
+static bool Overlap(const TransientRequest& a, const TransientRequest& b)
+{
+	return a.firstPass <= b.lastPass && b.firstPass <= a.lastPass;
+}
+
+static void TestIntervals()
+{
+	const auto key = Key(256, 256);
+
+	// Disjoint ranges share, a pass that ends one range and starts the next does not
+	const TransientRequest requests[] = {
+		{ key, 0, 2 },
+		{ key, 3, 5 },
+		{ key, 5, 6 },
+		{ key, 7, 7 },
+	};
+
+	const auto plan = PlanAliasing(requests);
+
+	CHECK(plan.slots.size() == 2);
+	CHECK(plan.slotOf[0] == plan.slotOf[1]);
+	CHECK(plan.slotOf[1] != plan.slotOf[2]);
+	CHECK(plan.unaliasedBytes == 4 * key.Bytes());
+	CHECK(plan.aliasedBytes == 2 * key.Bytes());
+	CHECK(plan.peakLiveBytes == 2 * key.Bytes());
+
+	// Everything overlapping, one slot each
+	const TransientRequest overlapping[] = { { key, 0, 9 }, { key, 1, 8 }, { key, 2, 2 } };
+	const auto separate = PlanAliasing(overlapping);
+
+	CHECK(separate.slots.size() == 3);
+	CHECK(separate.aliasedBytes == separate.unaliasedBytes);
+
+	CHECK(PlanAliasing({}).slots.empty());
+}
+
+// Any difference in the descriptor keeps requests apart, however far apart their passes are
+static void TestDescriptors()
+{
+	auto sampled    = Key(256, 256);
+	auto volume     = Key(256, 256);
+	auto mips       = Key(256, 256);
+	auto depth      = Key(256, 256);
+
+	sampled.sampleCount = 4;
+	volume.depth        = 2;
+	mips.mipLevels      = 9;
+	depth.bindFlags     = 0x40;
+
+	const TextureKey keys[] = { Key(256, 256), Key(256, 128), Key(256, 256, 28, 4), sampled, volume, mips, depth };
+
+	std::vector<TransientRequest> requests;
+	for (uint32_t i = 0; i < std::size(keys); i++)
+		requests.push_back({ keys[i], 10 * i, 10 * i + 1 });
+
+	const auto plan = PlanAliasing(requests);
+
+	CHECK(plan.slots.size() == std::size(keys));
+
+	for (size_t r = 0; r < requests.size(); r++)
+		CHECK(plan.slots[plan.slotOf[r]] == requests[r].key);
+}
+
+// Random pass ranges over a few descriptors: shared slots never overlap, the slot count
+// per descriptor is the most requests live at once, and no aliasing gets below the peak
+static void TestRandomPlans()
+{
+	std::mt19937 random{ 21 };
+
+	const TextureKey keys[] = { Key(512, 512), Key(256, 256), Key(512, 512, 28, 4) };
+
+	for (int trial = 0; trial < 200; trial++)
+	{
+		std::vector<TransientRequest> requests(1 + random() % 60);
+
+		for (auto& request : requests)
+		{
+			request.key         = keys[random() % std::size(keys)];
+			request.firstPass   = random() % 40;
+			request.lastPass    = request.firstPass + random() % 8;
+		}
+
+		const auto plan = PlanAliasing(requests);
+
+		for (size_t a = 0; a < requests.size(); a++)
+		{
+			CHECK(plan.slots[plan.slotOf[a]] == requests[a].key);
+
+			for (size_t b = a + 1; b < requests.size(); b++)
+				CHECK(plan.slotOf[a] != plan.slotOf[b] || !Overlap(requests[a], requests[b]));
+		}
+
+		size_t peak = 0;
+
+		for (uint32_t pass = 0; pass < 48; pass++)
+		{
+			size_t live = 0;
+
+			for (const auto& key : keys)
+			{
+				size_t count = 0;
+				for (const auto& request : requests)
+					count += request.key == key && request.firstPass <= pass && pass <= request.lastPass;
+
+				live += count * key.Bytes();
+			}
+
+			peak = std::max(peak, live);
+		}
+
+		for (const auto& key : keys)
+		{
+			size_t mostLive = 0;
+
+			for (uint32_t pass = 0; pass < 48; pass++)
+			{
+				size_t count = 0;
+				for (const auto& request : requests)
+					count += request.key == key && request.firstPass <= pass && pass <= request.lastPass;
+
+				mostLive = std::max(mostLive, count);
+			}
+
+			CHECK(size_t(std::count(plan.slots.begin(), plan.slots.end(), key)) == mostLive);
+		}
+
+		CHECK(plan.peakLiveBytes == peak);
+		CHECK(plan.peakLiveBytes <= plan.aliasedBytes);
+		CHECK(plan.aliasedBytes <= plan.unaliasedBytes);
+	}
+}
+
+// Textures stay pooled while frames keep acquiring them and go once idle too long
+static void TestPool()
+{
+	const auto small    = Key(64, 64);
+	const auto large    = Key(128, 128);
+
+	const TransientRequest both[] = { { small, 0, 1 }, { small, 1, 2 }, { large, 0, 2 } };
+	const TransientRequest one[]  = { { small, 0, 0 } };
+
+	const auto bothPlan = PlanAliasing(both);
+	const auto onePlan  = PlanAliasing(one);
+
+	int                 nextTexture = 1;
+	std::vector<int>    released;
+	std::vector<int>    textures;
+
+	auto Create  = [&](const TextureKey&) { return nextTexture++; };
+	auto Release = [&](int texture) { released.push_back(texture); };
+
+	TransientPool<int> pool;
+
+	// Two slots of one descriptor in the same frame get two textures
+	pool.Acquire(bothPlan, textures, Create);
+	CHECK(textures.size() == 3);
+	CHECK(textures[bothPlan.slotOf[0]] != textures[bothPlan.slotOf[1]]);
+	CHECK(pool.Created() == 3);
+	CHECK(pool.PooledBytes() == 2 * small.Bytes() + large.Bytes());
+	pool.EndFrame(2, Release);
+
+	pool.Acquire(bothPlan, textures, Create);
+	CHECK(pool.Created() == 3);
+	CHECK(pool.Reused() == 3);
+	pool.EndFrame(2, Release);
+
+	// Only one small texture from now on, the others sit idle for two frames and then go
+	for (int frame = 0; frame < 2; frame++)
+	{
+		pool.Acquire(onePlan, textures, Create);
+		pool.EndFrame(2, Release);
+		CHECK(released.empty());
+	}
+
+	pool.Acquire(onePlan, textures, Create);
+	pool.EndFrame(2, Release);
+
+	CHECK(released.size() == 2);
+	CHECK(pool.Count() == 1);
+	CHECK(pool.PooledBytes() == small.Bytes());
+	CHECK(pool.Created() == 3);
+
+	pool.Clear(Release);
+	CHECK(released.size() == 3);
+	CHECK(pool.Count() == 0);
+}
+
+int main()
+{
+	TestIntervals();
+	TestDescriptors();
+	TestRandomPlans();
+	TestPool();
+
+	return CheckResult("TransientTexturesTests");
+}
@@ -0,0 +1,101 @@
+#include "Check.hpp"
+#include "TestMeshes.hpp"
+
+#include "Wireframe.hpp"
+
+#include <cstring>
+#include <vector>
+
+// Every index becomes a vertex holding its triangle's three vertices, base vertices applied
+static void TestExpand()
+{
+	const float         positions[]     = { 0.0f, 1.0f, 2.0f, 3.0f, 4.0f };
+	const uint32_t      indices[]       = { 0, 1, 2, 0, 2, 1 };
+	const IndexedRange  ranges[]        = { { 0, 3, 0 }, { 3, 3, 2 } };
+
+	const auto expanded = ExpandTriangles(positions, sizeof(float), indices, 6, ranges);
+
+	CHECK(expanded.size() == 6 * 3 * sizeof(float));
+
+	std::vector<float> values(expanded.size() / sizeof(float));
+	memcpy(values.data(), expanded.data(), expanded.size());
+
+	const std::vector<float> expected = {
+		0, 1, 2,  0, 1, 2,  0, 1, 2,
+		2, 4, 3,  2, 4, 3,  2, 4, 3 };
+
+	CHECK(values == expected);
+}
+
+// The expanded vertex shader path has to draw the same image as the geometry shader
+// path, for a mesh split into shapes with their own base vertex
+static void TestPathsMatch()
+{
+	const auto      mesh        = MakeGrid(32);
+	const uint32_t  half        = uint32_t(mesh.indices.size() / 2);
+	const uint32_t  baseVertex  = 100;
+
+	std::vector<uint32_t> indices = mesh.indices;
+	for (uint32_t i = half; i < indices.size(); i++)
+		indices[i] -= baseVertex;
+
+	const IndexedRange shapes[] = { { 0, half, 0 }, { half, uint32_t(indices.size()) - half, int32_t(baseVertex) } };
+
+	const auto expanded = ExpandTriangles(mesh.positions.data(), 3 * sizeof(float), indices.data(), indices.size(), shapes);
+
+	const float eye[3]      = { 0.3f, 1.5f, -1.8f };
+	const float target[3]   = { 0.0f, 0.0f, 0.0f };
+
+	float pv[4][4];
+	MakeViewProjection(eye, target, 3.1415927f / 3.0f, 1.0f, 0.1f, 10.0f, pv);
+
+	for (const uint32_t size : { 64u, 256u })
+	{
+		WireframeImage withGS{ size, size };
+		WireframeImage withoutGS{ size, size };
+
+		RenderWireframeGS(withGS, mesh.positions.data(), indices.data(), shapes, pv, float(size), float(size));
+		RenderWireframeExpanded(withoutGS, reinterpret_cast<const float*>(expanded.data()), shapes, pv, float(size), float(size));
+
+		const auto difference = CompareImages(withGS, withoutGS);
+
+		CHECK(difference.pixels > size * size / 8);
+		CHECK(difference.coverageMismatch == 0);
+		CHECK(difference.maxDifference == 0.0f);
+	}
+}
+
+// Nothing behind the camera is drawn by either path
+static void TestBehindCamera()
+{
+	const auto          mesh    = MakeGrid(8);
+	const IndexedRange  shape   = { 0, uint32_t(mesh.indices.size()), 0 };
+
+	const float eye[3]      = { 0.0f, 1.0f, -3.0f };
+	const float target[3]   = { 0.0f, 1.0f, -6.0f };
+
+	float pv[4][4];
+	MakeViewProjection(eye, target, 3.1415927f / 3.0f, 1.0f, 0.1f, 10.0f, pv);
+
+	const auto expanded = ExpandTriangles(mesh.positions.data(), 3 * sizeof(float), mesh.indices.data(), mesh.indices.size(), { &shape, 1 });
+
+	WireframeImage withGS{ 64, 64 };
+	WireframeImage withoutGS{ 64, 64 };
+
+	RenderWireframeGS(withGS, mesh.positions.data(), mesh.indices.data(), { &shape, 1 }, pv, 64.0f, 64.0f);
+	RenderWireframeExpanded(withoutGS, reinterpret_cast<const float*>(expanded.data()), { &shape, 1 }, pv, 64.0f, 64.0f);
+
+	const auto difference = CompareImages(withGS, withoutGS);
+
+	CHECK(difference.pixels == 0);
+	CHECK(difference.coverageMismatch == 0);
+}
+
+int main()
+{
+	TestExpand();
+	TestPathsMatch();
+	TestBehindCamera();
+
+	return CheckResult("WireframeTests");
+}